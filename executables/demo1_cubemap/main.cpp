@@ -14,6 +14,7 @@ using namespace gl;
 #include <memory>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
@@ -289,9 +290,9 @@ int main()
 
     Timer timer;
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
+    GLStateCache::enable(GL_DEPTH_TEST);
 
     std::vector<glm::vec3> rotations(5, glm::vec3(0.0f));
 
@@ -443,23 +444,23 @@ int main()
         {
             // render skybox last
             glDepthFunc(GL_LEQUAL);
-            glDisable(GL_CULL_FACE);
+            GLStateCache::disable(GL_CULL_FACE);
             skyboxSP.use();
             skyboxSP.updateUniforms();
             cube.draw();
-            glEnable(GL_CULL_FACE);
+            GLStateCache::enable(GL_CULL_FACE);
             glDepthFunc(GL_LEQUAL);
         }
 
         if (useFBO)
         {
             fbo.unbind(); // render to screen now
-            glDisable(GL_DEPTH_TEST);
+            GLStateCache::disable(GL_DEPTH_TEST);
             glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             fboSP.use();
             fboQuad.draw();
-            glEnable(GL_DEPTH_TEST);
+            GLStateCache::enable(GL_DEPTH_TEST);
         }
 
         timer.stop();
@@ -9,6 +9,7 @@ using namespace gl;
 #include <memory>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
@@ -89,9 +90,9 @@ int main()
 
     Timer timer;
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
+    GLStateCache::enable(GL_DEPTH_TEST);
 
     // render loop
     while (!glfwWindowShouldClose(window))
@@ -12,6 +12,7 @@ using namespace gl;
 #include <memory>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
@@ -202,9 +203,9 @@ int main()
     // regular stuff
     Timer timer;
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
+    GLStateCache::enable(GL_DEPTH_TEST);
 
     const float deltaAngle = 0.1f;
     bool rotate = true;
@@ -274,23 +275,23 @@ int main()
         if (useFBO)
         {
             fbo.unbind(); // render to screen now
-            glDisable(GL_DEPTH_TEST);
+            GLStateCache::disable(GL_DEPTH_TEST);
             glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             fboSP.use();
             fboQuad.draw();
-            glEnable(GL_DEPTH_TEST);
+            GLStateCache::enable(GL_DEPTH_TEST);
         }
 
         if (displayShadowMap)
         {
             fbo.unbind(); // render to screen now
-            glDisable(GL_DEPTH_TEST);
+            GLStateCache::disable(GL_DEPTH_TEST);
             glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             smfboSP.use();
             fboQuad.draw();
-            glEnable(GL_DEPTH_TEST);
+            GLStateCache::enable(GL_DEPTH_TEST);
         }
 
         timer.stop();
@@ -12,6 +12,7 @@ using namespace gl;
 #include <memory>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
@@ -127,7 +128,7 @@ int main()
 
     // IBL STUFF
     IBLCubemapMaker cubemapMaker(util::gs_resourcesPath / "Newport_Loft/Newport_Loft_Ref.hdr");
-    glViewport(0, 0, width, height);
+    GLStateCache::viewport(0, 0, width, height);
 
     Buffer lightingTextureBuffer(GL_SHADER_STORAGE_BUFFER);
     lightingTextureBuffer.setStorage(std::array<GLuint64, 3>{cubemapMaker.getIrradianceCubemap().getHandle(), cubemapMaker.getSpecularCubemap().getHandle(), cubemapMaker.getBRDFLUT().getHandle()}, GL_DYNAMIC_STORAGE_BIT);
@@ -144,9 +145,9 @@ int main()
 
     const glm::vec4 clearColor(0.2f, 0.2f, 0.2f, 1.0f);
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
+    GLStateCache::enable(GL_DEPTH_TEST);
 
     // render loop
     while (!glfwWindowShouldClose(window))
@@ -3,6 +3,9 @@
 #include "Rendering/Trackball.h"
 #include <glm/gtc/matrix_transform.inl>
 #include "Rendering/SparseVoxelOctree.h"
+#include "Rendering/SparseVoxelOctreeRenderer.h"
+#include "Rendering/SparseVoxelOctreeBuilder.h"
+#include "Rendering/SparseVoxelOctreeTracer.h"
 #include "IO/ModelImporter.h"
 using namespace gl;
 
@@ -11,10 +14,14 @@ using namespace gl;
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <chrono>
 #include <memory>
+#include <sstream>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
+#include "Utils/GPUProfiler.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
 #include "Rendering/Uniform.h"
@@ -27,7 +34,7 @@ using namespace gl;
 const unsigned int width = 800;
 const unsigned int height = 800;
 
-int main()
+int main(int argc, char* argv[])
 {
     // init glfw, open window, manage context
     GLFWwindow* window = util::setupGLFWwindow(width, height, "Demo 6 - Octree");
@@ -47,36 +54,23 @@ int main()
     // get list of OpenGL extensions (can be searched later if needed)
     std::vector<std::string> extensions = util::getGLExtenstions();
 
-    glViewportIndexedf(0, 0.f, 0.f, static_cast<float>(width), static_cast<float>(height));
+    GLStateCache::viewport(0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
 
     auto meshes = ModelImporter::loadAllMeshesFromFile("bunny.obj");
     const auto bunny = meshes.at(0);
     std::vector<std::shared_ptr<Mesh>> scene;
     scene.push_back(bunny);
 
-    SparseVoxelOctree svo(scene, 5);
+    // an octree baked with tool1_svo_bake can be passed as argument, it is loaded instead of built and stays static
+    const bool loadedOctree = argc > 1;
+    const size_t octreeDepth = 5;
+    const auto svo = loadedOctree ? std::make_unique<SparseVoxelOctree>(std::experimental::filesystem::path(argv[1])) : std::make_unique<SparseVoxelOctree>(scene, octreeDepth);
 
     Trackball cam(width, height, 5);
 
-    Shader vs("SparseVoxelOctree/sfq_rayDir.vert", GL_VERTEX_SHADER);
-    Shader fs("SparseVoxelOctree/TraceSparseVoxelOctree.frag", GL_FRAGMENT_SHADER);
-    ShaderProgram sp(vs, fs);
-    sp.use();
-
-    Quad q;
-
-    auto u_view = std::make_shared<Uniform<glm::mat4>>("viewMatrix", cam.getView());
-    auto u_projection = std::make_shared<Uniform<glm::mat4>>("projectionMatrix", glm::perspective(glm::radians(60.0f), width / static_cast<float>(height), 0.1f, 1000.0f));
-    auto u_camPos = std::make_shared<Uniform<glm::vec3>>("camPosition", cam.getPosition());
-    auto u_bmin = std::make_shared<Uniform<glm::vec3>>("bmin", svo.getBMin());
-    auto u_bmax = std::make_shared<Uniform<glm::vec3>>("bmax", svo.getBMax());
-    auto u_maxLevel = std::make_shared<Uniform<int>>("maxLevel", 10);
-    sp.addUniform(u_view);
-    sp.addUniform(u_projection);
-    sp.addUniform(u_camPos);
-    sp.addUniform(u_bmin);
-    sp.addUniform(u_bmax);
-    sp.addUniform(u_maxLevel);
+    SparseVoxelOctreeRenderer renderer(width, height);
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), width / static_cast<float>(height), 0.1f, 1000.0f);
+    bool beamOptimization = renderer.getBeamOptimization();
 
     glm::vec4 clear_color(0.1f);
 
@@ -84,6 +78,17 @@ int main()
 
     int maxLevelRender = 10; double keyTimeout = 0; //only for octree level debugging!
 
+    std::string verificationResult;
+    float cpuBuildMs = 0.0f;
+    bool animate = false;
+    bool incrementalUpdate = true;
+    bool continuousUpdate = !loadedOctree;
+    float colorTolerance = 0.0f;
+    std::string compressionResult;
+    bool pickVoxel = false;
+    std::unique_ptr<SparseVoxelOctreeTracer> tracer;    // CPU copy of the octree for picking, recreated when it changed
+    std::string tracerVerificationResult;
+
     // render loop
     while (!glfwWindowShouldClose(window))
     {
@@ -92,7 +97,7 @@ int main()
         glfwPollEvents();
         ImGui_ImplGlfwGL3_NewFrame();
 
-        sp.showReloadShaderGUI({ vs, fs });
+        renderer.showReloadShaderGUI();
 
         glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
 
@@ -112,24 +117,140 @@ int main()
             }
             keyTimeout = glfwGetTime();
         }
-        u_maxLevel->setContent(maxLevelRender);
+        renderer.setMaxLevel(maxLevelRender);
 
-        std::cout << "SVO update time: " << util::timeCall([&]() {svo.update();}) << "ms \n";
+        if (animate)
+        {
+            const float offset = 0.05f * glm::sin(static_cast<float>(glfwGetTime())) * (svo->getBMax().x - svo->getBMin().x);
+            bunny->setModelMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f, 0.0f)));
+        }
 
-        cam.update(window);
-        u_view->setContent(cam.getView());
-        u_camPos->setContent(cam.getPosition());
-        sp.use();
-        svo.bind();
+        if (continuousUpdate)
+        {
+            GPUProfileScope scope("svo update");
+            if (incrementalUpdate)
+                svo->update({ bunny });
+            else
+                svo->update();
+            tracer.reset();
+        }
 
-        q.draw();
+        cam.update(window);
+        renderer.setBeamOptimization(beamOptimization);
+        renderer.draw(*svo, cam.getView(), projection);
 
         timer.stop();
         timer.drawGuiWindow(window);
 
+        ImGui::Begin("GPU Profiler");
+        GPUProfiler::showGUIContent();
+        ImGui::End();
+
+        ImGui::Begin("Octree");
+        const SparseVoxelOctree::BuildMode buildMode = svo->getBuildMode();
+        ImGui::Text("Build mode: %s", buildMode == SparseVoxelOctree::BuildMode::loaded ? "loaded" : buildMode == SparseVoxelOctree::BuildMode::cpu ? "CPU" : "GPU");
+        if (!loadedOctree)
+        {
+            ImGui::Checkbox("Animate bunny", &animate);
+            ImGui::Checkbox("Update every frame", &continuousUpdate);
+            ImGui::Checkbox("Incremental update", &incrementalUpdate);
+            if (buildMode == SparseVoxelOctree::BuildMode::gpu)
+            {
+                // the raster voxelizer needs GL_NV_conservative_raster, the GPU profiler shows the time of both in "voxelization"
+                bool computeVoxelizer = svo->getVoxelizer() == SparseVoxelOctree::Voxelizer::compute;
+                if (ImGui::Checkbox("Compute voxelizer", &computeVoxelizer))
+                {
+                    try
+                    {
+                        svo->setVoxelizer(computeVoxelizer ? SparseVoxelOctree::Voxelizer::compute : SparseVoxelOctree::Voxelizer::raster);
+                        svo->update();
+                        tracer.reset();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::cout << e.what() << '\n';
+                    }
+                }
+            }
+            if (ImGui::Button("Verify against CPU builder"))
+            {
+                verificationResult = svo->verifyWithCPUBuilder().toString();
+                std::cout << verificationResult << '\n';
+            }
+            if (ImGui::Button("Time CPU builder"))
+            {
+                const SparseVoxelOctreeBuilder builder(svo->getBMin(), svo->getBMax(), octreeDepth);
+                const auto start = std::chrono::steady_clock::now();
+                builder.build(scene);
+                cpuBuildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+        if (ImGui::Button("Save to octree.svo"))
+            svo->saveToFile("octree.svo");
+        ImGui::SliderFloat("Color tolerance", &colorTolerance, 0.0f, 0.25f);
+        if (ImGui::Button("Compress to DAG"))
+        {
+            // the next update would rebuild the octree
+            continuousUpdate = false;
+            const size_t bytesPerNode = sizeof(GLint) + sizeof(GLuint);
+            const size_t nodesBefore = svo->getNodeCount();
+            svo->compress(colorTolerance);
+            tracer.reset();
+            const size_t nodesAfter = svo->getNodeCount();
+            std::stringstream ss;
+            ss << nodesBefore << " -> " << nodesAfter << " nodes, " << nodesBefore * bytesPerNode / 1024 << " -> " << nodesAfter * bytesPerNode / 1024 << " KiB";
+            compressionResult = ss.str();
+        }
+        ImGui::Checkbox("Beam optimization", &beamOptimization);
+        // compress drops the brick pool, so the checkbox follows the octree
+        bool brickPool = svo->hasBrickPool();
+        if (ImGui::Checkbox("Trilinear filtering with brick pool", &brickPool))
+        {
+            try
+            {
+                svo->setBrickPool(brickPool);
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << e.what() << '\n';
+            }
+            renderer.setBrickFiltering(svo->hasBrickPool());
+        }
+        ImGui::Checkbox("Pick voxel under cursor", &pickVoxel);
+        if (pickVoxel)
+        {
+            if (!tracer)
+                tracer = std::make_unique<SparseVoxelOctreeTracer>(svo->createTracer());
+            double cursorX, cursorY;
+            glfwGetCursorPos(window, &cursorX, &cursorY);
+            const glm::vec2 ndc(2.0f * static_cast<float>(cursorX) / width - 1.0f, 1.0f - 2.0f * static_cast<float>(cursorY) / height);
+            const glm::vec4 target = glm::inverse(projection * cam.getView()) * glm::vec4(ndc, 0.0f, 1.0f);
+            const SparseVoxelOctreeRay ray{ cam.getPosition(), glm::normalize(glm::vec3(target) / target.w - cam.getPosition()) };
+            const SparseVoxelOctreeHit hit = tracer->trace(ray, static_cast<size_t>(std::max(maxLevelRender, 0)));
+            if (hit.isHit())
+                ImGui::Text("Level %d voxel (%d, %d, %d) at distance %.3f", hit.level, hit.voxel.x, hit.voxel.y, hit.voxel.z, hit.distance);
+            else
+                ImGui::Text("No voxel under the cursor");
+        }
+        if (ImGui::Button("Verify CPU tracer"))
+        {
+            tracerVerificationResult = svo->verifyTracer(cam.getView(), projection, width, height).toString();
+            std::cout << tracerVerificationResult << '\n';
+        }
+        if (!tracerVerificationResult.empty())
+            ImGui::TextWrapped("%s", tracerVerificationResult.c_str());
+        if (!compressionResult.empty())
+            ImGui::Text("%s", compressionResult.c_str());
+        if (cpuBuildMs > 0.0f)
+            ImGui::Text("CPU build: %.3f ms", cpuBuildMs);
+        if (!verificationResult.empty())
+            ImGui::TextWrapped("%s", verificationResult.c_str());
+        ImGui::End();
+
         ImGui::Render();
         ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
+        GPUProfiler::newFrame();
     }
     std::cout << std::endl;
 
@@ -10,9 +10,11 @@ using namespace gl;
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
+#include "Rendering/ShaderVariants.h"
 #include "Rendering/Buffer.h"
 #include "Rendering/Uniform.h"
 #include "Rendering/Image.h"
@@ -75,25 +77,25 @@ int main()
     voxelGrid.initWithoutData3D(gridWidth, gridHeight, gridDepth, GL_RGBA32F);
     voxelGrid.clearTexture(GL_RGBA, GL_FLOAT, glm::vec4(-1.0f), 0);
 
-    Shader scatterLightShader("scatterLight.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions);
-    ShaderProgram sp({ scatterLightShader });
+    // the debug modes write positions, so the scattering volume keeps full precision here
+    std::vector<glsp::definition> scatterDefinitions = BufferBindings::g_definitions;
+    scatterDefinitions.push_back(glsp::definition("SCATTERING_FORMAT", "rgba32f"));
+    ShaderVariants scatterLightVariants({ { "scatterLight.comp", GL_COMPUTE_SHADER } }, { { "DEBUG_MODE", { 0, 1, 2, 3 } } }, scatterDefinitions);
+    int debugMode = 2;
 
-    Shader accumShader("accumulateVoxels.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions);
+    Shader accumShader("accumulateVoxels.comp", GL_COMPUTE_SHADER, scatterDefinitions);
     ShaderProgram accumSp({ accumShader });
 
-    auto u_voxelGridImg = std::make_shared<Uniform<GLuint64>>("voxelGrid", voxelGrid.generateImageHandle(GL_RGBA32F));
-    sp.addUniform(u_voxelGridImg);
-    accumSp.addUniform(u_voxelGridImg);
+    auto u_voxelGridImg = std::make_shared<Uniform<GLuint64>>("scatteringVolume", voxelGrid.generateImageHandle(GL_RGBA32F));
+    scatterLightVariants.addUniform(u_voxelGridImg);
 
     auto u_gridDim = std::make_shared<Uniform<glm::ivec3>>("gridDim", glm::ivec3(gridWidth, gridHeight, gridDepth));
-    sp.addUniform(u_gridDim);
+    scatterLightVariants.addUniform(u_gridDim);
     accumSp.addUniform(u_gridDim);
 
-    auto u_debugMode = std::make_shared<Uniform<int>>("debugMode", 2);
-    sp.addUniform(u_debugMode);
-
     auto u_maxRange = std::make_shared<Uniform<float>>("maxRange", 10.0f);
-    sp.addUniform(u_maxRange);
+    scatterLightVariants.addUniform(u_maxRange);
+    scatterLightVariants.precompileAll();
 
     Pilotview playerCamera(screenWidth, screenHeight);
     const glm::mat4 playerProj = glm::perspective(glm::radians(60.0f), screenWidth / static_cast<float>(screenHeight), screenNear, screenFar);
@@ -124,7 +126,7 @@ int main()
     int dbgcActive = 1;
 
     glClearColor(0.2f, 0.2f, 0.3f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_DEPTH_TEST);
     while (!glfwWindowShouldClose(window))
     {
         timer.start();
@@ -149,7 +151,7 @@ int main()
         voxelGrid.clearTexture(GL_RGBA, GL_FLOAT, glm::vec4(-1.0f), 0);
 
 		noise.getNoiseBuffer().setContentSubData(static_cast<float>(glfwGetTime()), offsetof(GpuNoiseInfo, time));
-        sp.use();
+        scatterLightVariants.get({ debugMode }).use();
         glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(groupSize))),
             static_cast<GLint>(std::ceil(gridHeight / static_cast<float>(groupSize))),
             static_cast<GLint>(std::ceil(gridDepth / static_cast<float>(groupSize))));
@@ -160,8 +162,7 @@ int main()
         glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
         //accumSp.use();
-        //glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(8))),
-        //    static_cast<GLint>(std::ceil(gridHeight / static_cast<float>(8))), 1);
+        //glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(4))), gridHeight, 1);
 
         //glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 
@@ -231,7 +232,7 @@ int main()
 			case 3:
 			{
 				vdbgr.drawGuiContent();
-				sp.showReloadShaderGUIContent({ scatterLightShader }, "Voxel");
+				scatterLightVariants.showReloadShaderGUIContent("Voxel");
 				//accumSp.showReloadShaderGUIContent({ accumShader }, "Accumulation");
 				break;
 			}
@@ -260,10 +261,10 @@ int main()
 			case 6:
 			{
 				ImGui::Text("Image content settings");
-				ImGui::RadioButton("Full volumetric values (outColor)", &u_debugMode->getContentRef(), 0);
-				ImGui::RadioButton("worldPos, density", &u_debugMode->getContentRef(), 1);
-				ImGui::RadioButton("worldPos, outColor.r", &u_debugMode->getContentRef(), 2);
-				ImGui::RadioButton("lighting, density", &u_debugMode->getContentRef(), 3);
+				ImGui::RadioButton("Full volumetric values (outColor)", &debugMode, 0);
+				ImGui::RadioButton("worldPos, density", &debugMode, 1);
+				ImGui::RadioButton("worldPos, outColor.r", &debugMode, 2);
+				ImGui::RadioButton("lighting, density", &debugMode, 3);
 				break;
 			}
 
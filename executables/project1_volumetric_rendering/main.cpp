@@ -12,18 +12,35 @@ using namespace gl;
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <optional>
+
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
+#include "Utils/GPUProfiler.h"
+#include "Utils/Tracer.h"
+#include "Utils/GLCallTracker.h"
+#include "Utils/Benchmark.h"
+#include "Utils/FrameCapture.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
+#include "Rendering/ShaderVariants.h"
+#include "Rendering/ShaderWatcher.h"
+#include "Rendering/FrameGraph.h"
 #include "Rendering/Buffer.h"
 #include "Rendering/Uniform.h"
 #include "Rendering/Image.h"
 #include "IO/ModelImporter.h"
 #include "Rendering/VoxelDebugRenderer.h"
 #include "Rendering/Pilotview.h"
+#include "Rendering/CameraPath.h"
 #include "Rendering/LightManager.h"
 #include "Rendering/Parameters.h"
+#include "Rendering/SparseVoxelOctree.h"
+#include "Rendering/SparseVoxelOctreeConeTracer.h"
 
 #include "IO/GuiFont.cpp"
 #include "imgui/imgui.h"
@@ -38,8 +55,11 @@ constexpr int gridHeight = 180;
 constexpr int gridDepth = 256;
 constexpr int groupSize = 4;
 constexpr int msaaSamples = 1;
+constexpr size_t octreeDepth = 8;
 
 constexpr bool renderimgui = true;
+constexpr int traceFrameCount = 60;
+constexpr int benchmarkFrameCount = 1000;
 
 struct PlayerCameraInfo
 {
@@ -58,8 +78,39 @@ struct FogInfo
     float pad1 = 0.0f;
 };
 
-int main()
+int main(int argc, char* argv[])
 {
+    // --headless renders without a window into an offscreen framebuffer, same as G2_HEADLESS=egl
+    // --benchmark [frames] flies the camera path of every scene and writes the frame times, as JSON with --json
+    // --capture [png|qoi|pam] additionally records every benchmark frame into capture_<scene>/
+    int benchmarkFrames = 0;
+    bool benchmarkJSON = false;
+    std::optional<ImageFormat> benchmarkCapture;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--headless")
+            util::setHeadless(true);
+        else if (arg == "--benchmark")
+        {
+            benchmarkFrames = benchmarkFrameCount;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                benchmarkFrames = std::stoi(argv[++i]);
+        }
+        else if (arg == "--json")
+            benchmarkJSON = true;
+        else if (arg == "--capture")
+        {
+            benchmarkCapture = ImageFormat::qoi;
+            const std::string format = i + 1 < argc ? argv[i + 1] : "";
+            if (format == "png" || format == "qoi" || format == "pam")
+            {
+                benchmarkCapture = format == "png" ? ImageFormat::png : format == "pam" ? ImageFormat::pam : ImageFormat::qoi;
+                i++;
+            }
+        }
+    }
+
     // init glfw, open window, manage context
     GLFWwindow* window = util::setupGLFWwindow(screenWidth, screenHeight, "Volumetric Lighting/Fog");
     glfwSwapInterval(0);
@@ -89,6 +140,7 @@ int main()
 
     int curScene = 0;
     std::array<const char*, 3> scenes = { "Sponza", "Breakfast Room", "San Miguel" };
+    std::array<const char*, 3> sceneFileNames = { "sponza", "breakfast_room", "san_miguel" };
 
     // F B O : H D R -> L D R
     auto hdrTex = std::make_shared<Texture>(GL_TEXTURE_2D_MULTISAMPLE);
@@ -130,20 +182,82 @@ int main()
 
 	// V O L U M E T R I C
 
-    Image voxelGrid(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR);
-    voxelGrid.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-    voxelGrid.initWithoutData3D(gridWidth, gridHeight, gridDepth, GL_RGBA32F);    
-    voxelGrid.clearTexture(GL_RGBA, GL_FLOAT, glm::vec4(-1.0f), 0);
-
     Shader scatterLightShader("scatterLight.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions);
     ShaderProgram sp({ scatterLightShader });
 
-    Shader accumShader("accumulateVoxels.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions);
-    ShaderProgram accumSp({ accumShader });
+    // one variant per storage format of the voxel grid, see VOXEL_GRID_FORMAT in accumulateVoxels.comp
+    ShaderVariants accumSp({ { "accumulateVoxels.comp", GL_COMPUTE_SHADER } }, { { "VOXEL_GRID_FORMAT", { 0, 1, 2 } } }, BufferBindings::g_definitions);
+    accumSp.precompileAll();
 
-    auto u_voxelGridImg = std::make_shared<Uniform<GLuint64>>("voxelGrid", voxelGrid.generateImageHandle(GL_RGBA32F));
-    sp.addUniform(u_voxelGridImg);
+    // scatterLight.comp writes the scattering of the current frame into one volume and reprojects the other one as its history
+    std::array<Image, 2> scatteringVolumes{ Image(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR), Image(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR) };
+    std::array<GLuint64, 2> scatteringImageHandles;
+    std::array<GLuint64, 2> scatteringTextureHandles;
+    for (size_t i = 0; i < scatteringVolumes.size(); i++)
+    {
+        scatteringVolumes.at(i).setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        scatteringVolumes.at(i).initWithoutData3D(gridWidth, gridHeight, gridDepth, GL_RGBA16F, false);
+        scatteringImageHandles.at(i) = scatteringVolumes.at(i).generateImageHandle(GL_RGBA16F);
+        scatteringTextureHandles.at(i) = scatteringVolumes.at(i).Texture::generateHandle();
+    }
+
+    // the integrated grid is sampled per pixel. RGBA16F halves the memory of RGBA32F, the light in R11F_G11F_B10F with the
+    // transmittance in a separate R8 grid takes 5 instead of 16 bytes per froxel
+    std::array<const char*, 3> voxelGridFormatNames = { "RGBA32F (236 MB)", "RGBA16F (118 MB)", "R11F_G11F_B10F + R8 (74 MB)" };
+    int voxelGridFormat = 1;
+    std::unique_ptr<Image> voxelGrid;
+    std::unique_ptr<Image> transmittanceGrid;
+    auto u_voxelGridImg = std::make_shared<Uniform<GLuint64>>("voxelGrid", 0);
+    auto u_voxelGridTex = std::make_shared<Uniform<GLuint64>>("voxelGrid", 0);
+    auto u_transmittanceGridImg = std::make_shared<Uniform<GLuint64>>("transmittanceGrid", 0);
+    auto u_transmittanceGridTex = std::make_shared<Uniform<GLuint64>>("transmittanceGrid", 0);
+    auto u_separateTransmittance = std::make_shared<Uniform<bool>>("separateTransmittance", false);
     accumSp.addUniform(u_voxelGridImg);
+    accumSp.addUniform(u_transmittanceGridImg);
+
+    const auto createVoxelGrid = [&]()
+    {
+        const GLenum internalFormat = std::array<GLenum, 3>{ GL_RGBA32F, GL_RGBA16F, GL_R11F_G11F_B10F }.at(voxelGridFormat);
+        // only the first level is ever sampled
+        voxelGrid = std::make_unique<Image>(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR);
+        voxelGrid->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        voxelGrid->initWithoutData3D(gridWidth, gridHeight, gridDepth, internalFormat, false);
+        u_voxelGridImg->setContent(voxelGrid->generateImageHandle(internalFormat));
+        u_voxelGridTex->setContent(voxelGrid->Texture::generateHandle());
+
+        transmittanceGrid.reset();
+        if (voxelGridFormat == 2)
+        {
+            transmittanceGrid = std::make_unique<Image>(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR);
+            transmittanceGrid->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+            transmittanceGrid->initWithoutData3D(gridWidth, gridHeight, gridDepth, GL_R8, false);
+            u_transmittanceGridImg->setContent(transmittanceGrid->generateImageHandle(GL_R8));
+            u_transmittanceGridTex->setContent(transmittanceGrid->Texture::generateHandle());
+        }
+        u_separateTransmittance->setContent(voxelGridFormat == 2);
+    };
+    createVoxelGrid();
+
+    auto u_scatteringImg = std::make_shared<Uniform<GLuint64>>("scatteringVolume", scatteringImageHandles.at(0));
+    sp.addUniform(u_scatteringImg);
+    accumSp.addUniform(u_scatteringImg);
+
+    // T E M P O R A L   R E P R O J E C T I O N
+    bool temporalReprojection = true;
+    float historyWeight = 0.9f;
+    bool historyValid = false;
+    uint32_t frameIndex = 0;
+    glm::mat4 previousView(1.0f);
+    auto u_scatteringHistory = std::make_shared<Uniform<GLuint64>>("scatteringHistory", scatteringTextureHandles.at(1));
+    auto u_historyWeight = std::make_shared<Uniform<float>>("historyWeight", 0.0f);
+    auto u_depthJitter = std::make_shared<Uniform<float>>("depthJitter", 0.0f);
+    auto u_previousView = std::make_shared<Uniform<glm::mat4>>("previousViewMatrix", glm::mat4(1.0f));
+    auto u_previousProj = std::make_shared<Uniform<glm::mat4>>("previousProjMatrix", glm::mat4(1.0f));
+    sp.addUniform(u_scatteringHistory);
+    sp.addUniform(u_historyWeight);
+    sp.addUniform(u_depthJitter);
+    sp.addUniform(u_previousView);
+    sp.addUniform(u_previousProj);
 
     auto u_gridDim = std::make_shared<Uniform<glm::ivec3>>("gridDim", glm::ivec3(gridWidth, gridHeight, gridDepth));
     sp.addUniform(u_gridDim);
@@ -192,32 +306,45 @@ int main()
 
 	// R E N D E R I N G
 
-	Shader modelVertexShader("modelVertVolumetricMD.vert", GL_VERTEX_SHADER, BufferBindings::g_definitions);
-    Shader modelGeometryShader("tangentSpace2.geom", GL_GEOMETRY_SHADER, BufferBindings::g_definitions);
-	Shader modelFragmentShader("modelFragVolumetricMDBump.frag", GL_FRAGMENT_SHADER, BufferBindings::g_definitions);
-    ShaderProgram modelSp({ modelVertexShader, modelGeometryShader, modelFragmentShader });
+    // one variant per material type, draws are bucketed by variant in ModelImporter::multiDrawCulled
+    ShaderVariants modelSp({ { "modelVertVolumetricMD.vert", GL_VERTEX_SHADER },
+                             { "tangentSpace2.geom", GL_GEOMETRY_SHADER },
+                             { "modelFragVolumetricMDBump.frag", GL_FRAGMENT_SHADER } },
+                           ModelImporter::getMaterialPermutationAxes(), BufferBindings::g_definitions);
 
-    auto u_voxelGridTex = std::make_shared<Uniform<GLuint64>>("voxelGrid", voxelGrid.generateHandle());
     auto u_screenRes = std::make_shared<Uniform<glm::vec2>>("screenRes", glm::vec2(screenWidth, screenHeight));
 
 	modelSp.addUniform(u_maxRange);
     modelSp.addUniform(u_voxelGridTex);
+    modelSp.addUniform(u_transmittanceGridTex);
+    modelSp.addUniform(u_separateTransmittance);
     modelSp.addUniform(u_screenRes);
     modelSp.addUniform(u_skyboxTexHandle);
     skyboxSP.addUniform(u_maxRange);
     skyboxSP.addUniform(u_voxelGridTex);
+    skyboxSP.addUniform(u_transmittanceGridTex);
+    skyboxSP.addUniform(u_separateTransmittance);
     skyboxSP.addUniform(u_screenRes);
 
+    // A M B I E N T : cone traced through an octree of the active scene instead of the constant ambient light
+    SparseVoxelOctreeConeTracer coneTracer(screenWidth, screenHeight);
+    // built on first use of a scene and kept, the build imports the scene again
+    std::array<std::unique_ptr<SparseVoxelOctree>, 3> svos;
+    bool coneTracedAmbient = true;
+    auto u_useAmbientTexture = std::make_shared<Uniform<bool>>("useAmbientTexture", coneTracedAmbient);
+    modelSp.addUniform(u_useAmbientTexture);
+    modelSp.addUniform(std::make_shared<Uniform<GLuint64>>("ambientTexture", coneTracer.getAmbientHandle()));
+
+	std::array<const char*, 3> sceneModelFiles = { "sponza/sponza.obj", "breakfast_room/breakfast_room.obj", "San_Miguel/san-miguel-low-poly.obj" };
 	std::vector<std::shared_ptr<ModelImporter>> sceneVec = {
-	    std::make_shared<ModelImporter>("sponza/sponza.obj"),
-	    std::make_shared<ModelImporter>("breakfast_room/breakfast_room.obj"),
-	    std::make_shared<ModelImporter>("San_Miguel/san-miguel-low-poly.obj")
+	    std::make_shared<ModelImporter>(sceneModelFiles.at(0)),
+	    std::make_shared<ModelImporter>(sceneModelFiles.at(1)),
+	    std::make_shared<ModelImporter>(sceneModelFiles.at(2))
 	};
 
-    // not needed for multidraw
-	// sceneVec.at(0)->registerUniforms(modelSp);
-    // sceneVec.at(1)->registerUniforms(modelSp);
-    // sceneVec.at(2)->registerUniforms(modelSp);
+    // only the draw id offset of the material buckets, the rest is not needed for multidraw
+    ModelImporter::registerUniforms(modelSp);
+    modelSp.precompileAll();
 
 	// lights (parameters intended for sponza)
 	std::vector<LightManager> lightMngrVec(3);
@@ -318,42 +445,63 @@ int main()
 
     glClearColor(0.2f, 0.2f, 0.3f, 1.0f);
 
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	GLStateCache::enable(GL_CULL_FACE);
+	GLStateCache::cullFace(GL_BACK);
 
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::enable(GL_DEPTH_TEST);
 
-	glEnable(GL_BLEND);
+	GLStateCache::enable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     std::array<bool, 3> rerenderSM{ true, true, true };
-	
-	while (!glfwWindowShouldClose(window))
-    {
-        timer.start();
-
-        glfwPollEvents();
-
-        playerCamera.update(window);
-        matrixSSBO.setContentSubData(playerCamera.getView(), offsetof(PlayerCameraInfo, playerViewMatrix));
-        matrixSSBO.setContentSubData(playerCamera.getPosition(), offsetof(PlayerCameraInfo, camPos));
 
-        if(rerenderSM.at(curScene))
-        {
-            lightMngrVec.at(curScene).renderShadowMapsCulled(*sceneVec.at(curScene));
-            rerenderSM.at(curScene) = false;
-        }
-
-        // render to fbo
-        hdrFBO.bind();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        //voxelGrid.clearTexture(GL_RGBA, GL_FLOAT, glm::vec4(-1.0f), 0);
+    // reloads shaders in the background whenever a shader file or one of its includes is saved
+    ShaderWatcher shaderWatcher;
+    shaderWatcher.watch(sp);
+    shaderWatcher.watch(skyboxSP);
+    shaderWatcher.watch(fboHDRtoLDRSP);
+    shaderWatcher.watch(fxaaSP);
+
+    // the frame graph derives the barriers between the passes from their declared accesses
+    FrameGraph frameGraph;
+    const auto fgScattering = frameGraph.importResource("scattering");
+    const auto fgVoxelGrid = frameGraph.importResource("voxel grid");
+    const auto fgHdr = frameGraph.importResource("hdr fbo");
+    const auto fgLdr = frameGraph.importResource("fxaa fbo");
+    const auto fgBackbuffer = frameGraph.importResource("backbuffer");
+
+    // the octree and the cone tracer use the shader storage bindings of the fog and the noise
+    const auto bindFogBuffers = [&]()
+    {
+        fogSSBO.bindBase(static_cast<BufferBindings::Binding>(2));
+        std::array<SimplexNoise*, 3>{ &sponzaNoise, &breakfastNoise, &miguelNoise }.at(curScene)->bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
+    };
 
-        sponzaNoise.getNoiseBuffer().setContentSubData(static_cast<float>(glfwGetTime()), offsetof(GpuNoiseInfo, time));
-		breakfastNoise.getNoiseBuffer().setContentSubData(static_cast<float>(glfwGetTime()), offsetof(GpuNoiseInfo, time));
-		miguelNoise.getNoiseBuffer().setContentSubData(static_cast<float>(glfwGetTime()), offsetof(GpuNoiseInfo, time));
+    // the build uses the shader storage bindings 0 to 6, i.e. the fog, the noise and the bounding boxes.
+    // The meshes of the importer share the buffers of the multi-draw, so the voxelizers get meshes with their own buffers
+    const auto buildOctree = [&]()
+    {
+        if (svos.at(curScene))
+            return;
+        svos.at(curScene) = std::make_unique<SparseVoxelOctree>(ModelImporter::loadAllMeshesFromFile(sceneModelFiles.at(curScene)), octreeDepth);
+        svos.at(curScene)->setBrickPool(true);
+        sceneVec.at(curScene)->bindGPUbuffers();
+        bindFogBuffers();
+    };
+    if (coneTracedAmbient)
+        buildOctree();
+
+    const auto fgAmbient = frameGraph.importResource("ambient");
+    frameGraph.addPass("cone traced ambient", [&]()
+    {
+        if (!coneTracedAmbient)
+            return;
+        coneTracer.update(*svos.at(curScene), *sceneVec.at(curScene), playerCamera.getView(), playerProj);
+        bindFogBuffers();
+    }).write(fgAmbient, ResourceAccess::imageLoadStore);
 
+    frameGraph.addPass("scatter light", [&]()
+    {
         sp.use();
         glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(groupSize))),
             static_cast<GLint>(std::ceil(gridHeight / static_cast<float>(groupSize))),
@@ -361,46 +509,297 @@ int main()
         //glDispatchComputeGroupSizeARB(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(groupSize))),
         //static_cast<GLint>(std::ceil(gridHeight / static_cast<float>(groupSize))),
         //static_cast<GLint>(std::ceil(gridDepth / static_cast<float>(groupSize))), groupSize, groupSize, groupSize);
+    }).write(fgScattering, ResourceAccess::imageLoadStore);
 
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    frameGraph.addPass("accumulate", [&]()
+    {
+        accumSp.get({ voxelGridFormat }).use();
+        glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(4))), gridHeight, 1);
+    }).read(fgScattering, ResourceAccess::imageLoadStore).write(fgVoxelGrid, ResourceAccess::imageLoadStore);
 
-        accumSp.use();
-        glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(8))),
-            static_cast<GLint>(std::ceil(gridHeight / static_cast<float>(8))), 1);
+    frameGraph.addPass("forward", [&]()
+    {
+        // render to fbo
+        hdrFBO.bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        //voxelGrid.clearTexture(GL_RGBA, GL_FLOAT, glm::vec4(-1.0f), 0);
 
         // render skybox first
-        glDepthMask(GL_FALSE);
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
+        GLStateCache::depthMask(GL_FALSE);
+        GLStateCache::disable(GL_DEPTH_TEST);
+        GLStateCache::disable(GL_CULL_FACE);
         skyboxSP.use();
         cube.draw();
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_TRUE);
+        GLStateCache::enable(GL_CULL_FACE);
+        GLStateCache::enable(GL_DEPTH_TEST);
+        GLStateCache::depthMask(GL_TRUE);
 
         sceneVec.at(curScene)->multiDrawCulled(modelSp, playerProj * playerCamera.getView()); //modelLoader.multiDraw(modelSp);
+    }).read(fgVoxelGrid, ResourceAccess::textureFetch).read(fgAmbient, ResourceAccess::textureFetch).write(fgHdr, ResourceAccess::framebuffer);
 
+    frameGraph.addPass("hdr to ldr", [&]()
+    {
         // render to fxaa fbo now
         hdrFBO.unbind();
         fxaaFBO.bind();
-        glDisable(GL_DEPTH_TEST);
+        GLStateCache::disable(GL_DEPTH_TEST);
         glClearColor(0.4f, 0.1f, 0.1f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         fboHDRtoLDRSP.use();
         fboQuad.draw();
-        glEnable(GL_DEPTH_TEST);
+        GLStateCache::enable(GL_DEPTH_TEST);
+    }).read(fgHdr, ResourceAccess::textureFetch).write(fgLdr, ResourceAccess::framebuffer);
 
+    frameGraph.addPass("fxaa", [&]()
+    {
         // render to screen now
         fxaaFBO.unbind();
-        glDisable(GL_DEPTH_TEST);
+        GLStateCache::disable(GL_DEPTH_TEST);
         glClearColor(0.4f, 0.1f, 0.1f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         fxaaSP.use();
         fboQuad.draw();
-        glEnable(GL_DEPTH_TEST);
-        
+        GLStateCache::enable(GL_DEPTH_TEST);
+    }).read(fgLdr, ResourceAccess::textureFetch).write(fgBackbuffer, ResourceAccess::framebuffer);
+
+    frameGraph.markOutput(fgBackbuffer);
+    frameGraph.compile();
+
+    const auto selectScene = [&](int scene)
+    {
+        curScene = scene;
+        // bind active GPU light buffer
+        lightMngrVec.at(curScene).bindLightBuffer();
+
+        // bind active buffers from the scene
+        sceneVec.at(curScene)->bindGPUbuffers();
+
+        // reset camera and upload it to gpu
+        playerCamera.setPosition(sceneParams.at(curScene).cameraPos);
+        playerCamera.setTheta(sceneParams.at(curScene).theta);
+        playerCamera.setPhi(sceneParams.at(curScene).phi);
+        playerCamera.setSensitivityFromBBox(sceneVec.at(curScene)->getOuterBoundingBox());
+
+        u_maxRange->setContent(sceneParams.at(curScene).maxRange);
+
+        fog = { sceneParams.at(curScene).fog.albedo, sceneParams.at(curScene).fog.anisotropy, sceneParams.at(curScene).fog.scattering, sceneParams.at(curScene).fog.absorption, sceneParams.at(curScene).fog.density };
+        fogSSBO.setContentSubData(fog, 0);
+
+        if (curScene == 1)
+        {
+            breakfastNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
+        }
+        else if (curScene == 0)
+        {
+            sponzaNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
+        }
+        else if (curScene == 2)
+        {
+            // use breakfast room noise here too for now
+            miguelNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
+            //playerCamera.reset();
+        }
+        else
+        {
+            playerCamera.reset();
+        }
+
+        matrixSSBO.setContentSubData(playerCamera.getView(), offsetof(PlayerCameraInfo, playerViewMatrix));
+        matrixSSBO.setContentSubData(playerCamera.getPosition(), offsetof(PlayerCameraInfo, camPos));
+
+        if (coneTracedAmbient)
+            buildOctree();
+
+        historyValid = false;
+    };
+
+    // P R E C I S I O N : accumulates the current scattering volume into an RGBA32F grid and compares the selected grid with it
+    struct GridError
+    {
+        float maxTransmittance;
+        float meanTransmittance;
+        float maxLight;
+        float meanLight;
+        float maxLightValue;    // largest integrated light of the reference, for scale
+    };
+    std::optional<GridError> gridError;
+    const auto compareWithFP32 = [&]()
+    {
+        Image reference(GL_TEXTURE_3D, GL_NEAREST, GL_NEAREST);
+        reference.initWithoutData3D(gridWidth, gridHeight, gridDepth, GL_RGBA32F, false);
+        const GLuint64 selectedHandle = u_voxelGridImg->getContent();
+        u_voxelGridImg->setContent(reference.generateImageHandle(GL_RGBA32F));
+        accumSp.get({ 0 }).use();
+        glDispatchCompute(static_cast<GLint>(std::ceil(gridWidth / static_cast<float>(4))), gridHeight, 1);
+        u_voxelGridImg->setContent(selectedHandle);
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+        // read back in slabs, the whole grid would be 236 MB per copy
+        constexpr int slabDepth = 16;
+        const size_t slabSize = static_cast<size_t>(gridWidth) * gridHeight * slabDepth;
+        std::vector<glm::vec4> expected(slabSize);
+        std::vector<glm::vec4> actual(slabSize);
+        std::vector<float> transmittance(slabSize);
+        GridError error = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int z = 0; z < gridDepth; z += slabDepth)
+        {
+            glGetTextureSubImage(reference.getName(), 0, 0, 0, z, gridWidth, gridHeight, slabDepth, GL_RGBA, GL_FLOAT,
+                static_cast<GLsizei>(slabSize * sizeof(glm::vec4)), expected.data());
+            glGetTextureSubImage(voxelGrid->getName(), 0, 0, 0, z, gridWidth, gridHeight, slabDepth, GL_RGBA, GL_FLOAT,
+                static_cast<GLsizei>(slabSize * sizeof(glm::vec4)), actual.data());
+            if (transmittanceGrid)
+            {
+                glGetTextureSubImage(transmittanceGrid->getName(), 0, 0, 0, z, gridWidth, gridHeight, slabDepth, GL_RED, GL_FLOAT,
+                    static_cast<GLsizei>(slabSize * sizeof(float)), transmittance.data());
+                for (size_t i = 0; i < slabSize; i++)
+                    actual.at(i).a = transmittance.at(i);
+            }
+            for (size_t i = 0; i < slabSize; i++)
+            {
+                const float transmittanceError = glm::abs(actual.at(i).a - expected.at(i).a);
+                const float lightError = glm::length(glm::vec3(actual.at(i)) - glm::vec3(expected.at(i)));
+                error.maxTransmittance = glm::max(error.maxTransmittance, transmittanceError);
+                error.meanTransmittance += transmittanceError;
+                error.maxLight = glm::max(error.maxLight, lightError);
+                error.meanLight += lightError;
+                error.maxLightValue = glm::max(error.maxLightValue, glm::length(glm::vec3(expected.at(i))));
+            }
+        }
+        const float froxelCount = static_cast<float>(gridWidth) * gridHeight * gridDepth;
+        error.meanTransmittance /= froxelCount;
+        error.meanLight /= froxelCount;
+        gridError = error;
+    };
+    bool compareRequested = false;
+
+    // camera paths are recorded with F9 (add keyframe) and F10 (save), scenes without a recorded path get a pan from the start pose
+    const auto cameraPathFile = [&](int scene)
+    {
+        return util::gs_resourcesPath / "camera_paths" / (std::string(sceneFileNames.at(scene)) + ".txt");
+    };
+    std::vector<CameraPath> cameraPaths;
+    for (int i = 0; i < static_cast<int>(scenes.size()); i++)
+    {
+        if (std::experimental::filesystem::exists(cameraPathFile(i)))
+            cameraPaths.push_back(CameraPath::loadFromFile(cameraPathFile(i)));
+        else
+        {
+            const glm::mat2x4 bbox = sceneVec.at(i)->getOuterBoundingBox();
+            const CameraPose start = { sceneParams.at(i).cameraPos, sceneParams.at(i).theta, sceneParams.at(i).phi };
+            cameraPaths.push_back(CameraPath::makePan(start, 0.25f * glm::length(bbox[1] - bbox[0])));
+        }
+    }
+    CameraPath recordedPath;
+    bool addKeyframeKeyWasDown = false;
+    bool savePathKeyWasDown = false;
+
+    std::optional<Benchmark> benchmark;
+    const auto startBenchmark = [&](int scene)
+    {
+        selectScene(scene);
+        benchmark.emplace(scenes.at(curScene), benchmarkFrames);
+        if (benchmarkCapture)
+            FrameCapture::startSequence(std::string("capture_") + sceneFileNames.at(curScene), *benchmarkCapture);
+    };
+    if (benchmarkFrames > 0)
+        startBenchmark(0);
+
+    // F12 records the next frames into a Chrome trace
+    Tracer::setThreadName("Main");
+    bool traceKeyWasDown = false;
+
+	while (!glfwWindowShouldClose(window))
+    {
+        // before the frame scope, so the last captured frame is complete when the trace gets written
+        Tracer::newFrame();
+        TRACE_SCOPE("frame");
+
+        const auto cpuStart = std::chrono::steady_clock::now();
+        timer.start();
+
+        glfwPollEvents();
+        shaderWatcher.swapReloadedShaders();
+
+        const bool traceKeyDown = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+        if (traceKeyDown && !traceKeyWasDown && !Tracer::isCapturing())
+            Tracer::captureFrames(traceFrameCount, "volumetric_trace.json");
+        traceKeyWasDown = traceKeyDown;
+
+        // the benchmark advances the simulation by a fixed step per frame so every run renders the same frames
+        float simulationTime = static_cast<float>(glfwGetTime());
+        if (benchmark)
+        {
+            const CameraPose pose = cameraPaths.at(curScene).evaluate(benchmark->getPathParameter());
+            playerCamera.setPose(pose.position, pose.theta, pose.phi);
+            simulationTime = static_cast<float>(benchmark->getSimulationTime());
+        }
+        else
+        {
+            playerCamera.update(window);
+
+            const bool addKeyframeKeyDown = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+            if (addKeyframeKeyDown && !addKeyframeKeyWasDown)
+                recordedPath.addKeyframe({ playerCamera.getPosition(), playerCamera.getTheta(), playerCamera.getPhi() });
+            addKeyframeKeyWasDown = addKeyframeKeyDown;
+
+            const bool savePathKeyDown = glfwGetKey(window, GLFW_KEY_F10) == GLFW_PRESS;
+            if (savePathKeyDown && !savePathKeyWasDown && recordedPath.getKeyframeCount() > 0)
+            {
+                std::experimental::filesystem::create_directories(cameraPathFile(curScene).parent_path());
+                recordedPath.saveToFile(cameraPathFile(curScene));
+                std::cout << "Saved camera path to " << cameraPathFile(curScene).string() << std::endl;
+                cameraPaths.at(curScene) = std::move(recordedPath);
+                recordedPath = CameraPath();
+            }
+            savePathKeyWasDown = savePathKeyDown;
+        }
+        matrixSSBO.setContentSubData(playerCamera.getView(), offsetof(PlayerCameraInfo, playerViewMatrix));
+        matrixSSBO.setContentSubData(playerCamera.getPosition(), offsetof(PlayerCameraInfo, camPos));
+
+        GPUProfiler::beginScope("shadows");
+        if(rerenderSM.at(curScene))
+        {
+            lightMngrVec.at(curScene).renderShadowMapsCulled(*sceneVec.at(curScene));
+            rerenderSM.at(curScene) = false;
+            // the scattering of the previous frame was lit by the old lights
+            historyValid = false;
+        }
+        GPUProfiler::endScope();
+
+        // the volumes swap every frame, the samples walk through the froxels in a van der Corput sequence of 8 depths
+        u_scatteringImg->setContent(scatteringImageHandles.at(frameIndex % 2));
+        u_scatteringHistory->setContent(scatteringTextureHandles.at((frameIndex + 1) % 2));
+        u_historyWeight->setContent(temporalReprojection && historyValid ? historyWeight : 0.0f);
+        if (temporalReprojection)
+        {
+            float jitter = 0.0f;
+            for (uint32_t i = frameIndex % 8, scale = 2; i > 0; i /= 2, scale *= 2)
+                jitter += static_cast<float>(i % 2) / scale;
+            u_depthJitter->setContent(jitter - 0.5f);
+        }
+        else
+            u_depthJitter->setContent(0.0f);
+        u_previousView->setContent(previousView);
+        u_previousProj->setContent(playerProj);
+
+        sponzaNoise.getNoiseBuffer().setContentSubData(simulationTime, offsetof(GpuNoiseInfo, time));
+		breakfastNoise.getNoiseBuffer().setContentSubData(simulationTime, offsetof(GpuNoiseInfo, time));
+		miguelNoise.getNoiseBuffer().setContentSubData(simulationTime, offsetof(GpuNoiseInfo, time));
+
+        frameGraph.execute();
+
+        // before the volumes swap, the comparison accumulates the scattering volume of this frame again
+        if (compareRequested)
+        {
+            compareWithFP32();
+            compareRequested = false;
+        }
+
+        previousView = playerCamera.getView();
+        historyValid = true;
+        frameIndex++;
+
         timer.stop();
 
         if constexpr (renderimgui)
@@ -436,6 +835,39 @@ int main()
 						fogSSBO.setContentSubData(fog.fogAbsorptionCoeff, offsetof(FogInfo, fogAbsorptionCoeff));
 					if (ImGui::SliderFloat("Density", &fog.fogDensity, 0.0f, 1.0f))
 						fogSSBO.setContentSubData(fog.fogDensity, offsetof(FogInfo, fogDensity));
+					ImGui::Separator();
+					ImGui::Text("Temporal Reprojection");
+					ImGui::Separator();
+					ImGui::Checkbox("Jitter and reproject", &temporalReprojection);
+					ImGui::SliderFloat("History weight", &historyWeight, 0.0f, 0.98f);
+					ImGui::Separator();
+					ImGui::Text("Voxel Grid");
+					ImGui::Separator();
+					if (ImGui::Combo("Format", &voxelGridFormat, voxelGridFormatNames.data(), static_cast<int>(voxelGridFormatNames.size())))
+					{
+						createVoxelGrid();
+						gridError.reset();
+					}
+					if (ImGui::Button("Compare with RGBA32F"))
+						compareRequested = true;
+					if (gridError)
+					{
+						ImGui::Text("Transmittance error: max %.5f, mean %.6f", gridError->maxTransmittance, gridError->meanTransmittance);
+						ImGui::Text("Light error: max %.5f, mean %.6f (max light %.3f)", gridError->maxLight, gridError->meanLight, gridError->maxLightValue);
+					}
+					ImGui::EndMenu();
+				}
+				if (ImGui::BeginMenu("Ambient"))
+				{
+					ImGui::Text("Cone traced ambient occlusion and indirect light");
+					ImGui::Separator();
+					if (ImGui::Checkbox("Cone traced ambient", &coneTracedAmbient))
+					{
+						if (coneTracedAmbient)
+							buildOctree();
+						u_useAmbientTexture->setContent(coneTracedAmbient);
+					}
+					coneTracer.showGUIContent();
 					ImGui::EndMenu();
 				}
 				if (ImGui::BeginMenu("Camera"))
@@ -450,14 +882,42 @@ int main()
 						matrixSSBO.setContentSubData(playerCamera.getView(), offsetof(PlayerCameraInfo, playerViewMatrix));
 						matrixSSBO.setContentSubData(playerCamera.getPosition(), offsetof(PlayerCameraInfo, camPos));
 					}
+					ImGui::Separator();
+					ImGui::Text("Camera path: %zu recorded keyframes", recordedPath.getKeyframeCount());
+					ImGui::Text("F9 adds a keyframe, F10 saves the path of this scene");
+					if (benchmark)
+						ImGui::Text("Benchmark: %s", benchmark->getName().c_str());
 					ImGui::EndMenu();
 				}
 				if (ImGui::BeginMenu("Shader"))
 				{
 					sp.showReloadShaderGUIContent({ scatterLightShader }, "Voxel");
-					accumSp.showReloadShaderGUIContent({ accumShader }, "Accumulation");
-					modelSp.showReloadShaderGUIContent({ modelVertexShader, modelFragmentShader }, "Forward Rendering");
+					accumSp.showReloadShaderGUIContent("Accumulation");
+					modelSp.showReloadShaderGUIContent("Forward Rendering");
 					fboHDRtoLDRSP.showReloadShaderGUIContent({ fboVS, fboHDRtoLDRFS }, "FBO: HDR to LDR");
+					shaderWatcher.showGUIContent();
+					ImGui::EndMenu();
+				}
+				if (ImGui::BeginMenu("Profiler"))
+				{
+					ImGui::Text("GPU time per pass");
+					ImGui::Separator();
+					GPUProfiler::showGUIContent();
+					ImGui::Separator();
+					if (Tracer::isCapturing())
+						ImGui::Text("Recording trace...");
+					else if (ImGui::Button("Capture trace (F12)"))
+						Tracer::captureFrames(traceFrameCount, "volumetric_trace.json");
+					ImGui::EndMenu();
+				}
+				if (ImGui::BeginMenu("Capture"))
+				{
+					FrameCapture::showGUIContent();
+					ImGui::EndMenu();
+				}
+				if (ImGui::BeginMenu("GL Calls"))
+				{
+					GLCallTracker::showGUIContent();
 					ImGui::EndMenu();
 				}
 				if (ImGui::BeginMenu("FBO"))
@@ -470,6 +930,10 @@ int main()
 						u_exposure->setContent(exposure);
 					if (ImGui::SliderInt("FXAA iterations", &fxaaIterations, 0, 8))
 						u_fxaaIterations->setContent(fxaaIterations);
+					ImGui::Separator();
+					GLStateCache::showGUIContent();
+					ImGui::Separator();
+					frameGraph.showGUIContent();
 					ImGui::EndMenu();
 				}
 				if (ImGui::BeginMenu("Scene"))
@@ -477,47 +941,10 @@ int main()
 					//list all scenes to select
 					for (int i = 0; i < static_cast<int>(scenes.size()); i++)
 					{
-						if (ImGui::Selectable(scenes[i], curScene == i))
+						if (ImGui::Selectable(scenes[i], curScene == i) && !benchmark)
 						{
-							curScene = i;
-							// bind active GPU light buffer
-							lightMngrVec.at(curScene).bindLightBuffer();
-
-							// bind active buffers from the scene
-							sceneVec.at(curScene)->bindGPUbuffers();
-
-							// reset camera and upload it to gpu
-							playerCamera.setPosition(sceneParams.at(curScene).cameraPos);
-							playerCamera.setTheta(sceneParams.at(curScene).theta);
-							playerCamera.setPhi(sceneParams.at(curScene).phi);
-							playerCamera.setSensitivityFromBBox(sceneVec.at(curScene)->getOuterBoundingBox());
-
-							u_maxRange->setContent(sceneParams.at(curScene).maxRange);
-
-							fog = { sceneParams.at(curScene).fog.albedo, sceneParams.at(curScene).fog.anisotropy, sceneParams.at(curScene).fog.scattering, sceneParams.at(curScene).fog.absorption, sceneParams.at(curScene).fog.density };
-							fogSSBO.setContentSubData(fog, 0);
-
-							if (curScene == 1)
-							{
-								breakfastNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
-							}
-							else if (curScene == 0)
-							{
-								sponzaNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
-							}
-							else if (curScene == 2)
-							{
-								// use breakfast room noise here too for now
-								miguelNoise.bindNoiseBuffer(static_cast<BufferBindings::Binding>(3));
-								//playerCamera.reset();
-							}
-							else
-							{
-								playerCamera.reset();
-							}
-
-							matrixSSBO.setContentSubData(playerCamera.getView(), offsetof(PlayerCameraInfo, playerViewMatrix));
-							matrixSSBO.setContentSubData(playerCamera.getPosition(), offsetof(PlayerCameraInfo, camPos));
+							selectScene(i);
+							recordedPath = CameraPath();
 						}
 					}
 					ImGui::EndMenu();
@@ -548,9 +975,36 @@ int main()
             ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
         }
 
+        FrameCapture::endFrame();
+        const float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+
         glfwSwapBuffers(window);
+        GLStateCache::newFrame();
+        GPUProfiler::newFrame();
+        GLCallTracker::newFrame();
+
+        if (benchmark)
+        {
+            benchmark->addFrame(cpuMs);
+            if (benchmark->isFinished())
+            {
+                const std::string file = std::string("benchmark_") + sceneFileNames.at(curScene) + (benchmarkJSON ? ".json" : ".csv");
+                benchmark->write(file);
+                std::cout << "Wrote benchmark results of " << benchmark->getName() << " to " << file << std::endl;
+
+                FrameCapture::stopSequence();
+                if (curScene + 1 < static_cast<int>(scenes.size()))
+                    startBenchmark(curScene + 1);
+                else
+                {
+                    benchmark.reset();
+                    glfwSetWindowShouldClose(window, GLFW_TRUE);
+                }
+            }
+        }
     }
 
+    FrameCapture::finish();
     ImGui_ImplGlfwGL3_Shutdown();
 
     // close window
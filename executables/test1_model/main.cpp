@@ -11,6 +11,7 @@ using namespace gl;
 #include <memory>
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include "Utils/Timer.h"
 #include "Rendering/Shader.h"
 #include "Rendering/ShaderProgram.h"
@@ -94,12 +95,12 @@ int main()
     auto voxelSizeUniform = std::make_shared<Uniform<float>>("voxelSize", 10.0f);
     lightDebugSP.addUniform(voxelSizeUniform);
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    GLStateCache::enable(GL_CULL_FACE);
+    GLStateCache::cullFace(GL_BACK);
 
-    glEnable(GL_DEPTH_TEST);
+    GLStateCache::enable(GL_DEPTH_TEST);
 
-    glEnable(GL_BLEND);
+    GLStateCache::enable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     glClearColor(0.2f, 0.2f, 0.3f, 1.0f);
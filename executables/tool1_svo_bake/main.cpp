@@ -0,0 +1,198 @@
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <experimental/filesystem>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Utils/UtilCollection.h"
+#include "IO/ModelImporter.h"
+#include "Rendering/Mesh.h"
+#include "Rendering/SparseVoxelOctree.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage: tool1_svo_bake <model> <output.svo> [options]\n"
+                  << "  <model>              model file in the resources folder, all of its meshes are voxelized\n"
+                  << "  --depth <n>          levels below the root, 1 to 10 (default 8)\n"
+                  << "  --cpu                build with the CPU builder instead of the GPU\n"
+                  << "  --voxelizer <name>   raster or compute, voxelizer of the GPU build (default raster if available)\n"
+                  << "  --benchmark-voxelizers  time full GPU updates with both voxelizers and verify them against the CPU builder\n"
+                  << "  --dag [tolerance]    merge identical subtrees, colors are quantized to the tolerance (default 0)\n"
+                  << "  --single-chunk       store all nodes in one chunk instead of one chunk per level\n"
+                  << "  --verify-trace       compare the CPU tracer with the shader and measure its ray throughput\n";
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const std::experimental::filesystem::path model = argv[1];
+    const std::experimental::filesystem::path output = argv[2];
+    size_t depth = 8;
+    SparseVoxelOctree::BuildMode mode = SparseVoxelOctree::BuildMode::automatic;
+    SparseVoxelOctree::Voxelizer voxelizer = SparseVoxelOctree::Voxelizer::automatic;
+    bool benchmarkVoxelizers = false;
+    bool dag = false;
+    float colorTolerance = 0.0f;
+    bool chunkPerLevel = true;
+    bool verifyTrace = false;
+    for (int i = 3; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--depth" && i + 1 < argc)
+            depth = std::stoul(argv[++i]);
+        else if (arg == "--cpu")
+            mode = SparseVoxelOctree::BuildMode::cpu;
+        else if (arg == "--voxelizer" && i + 1 < argc && (argv[i + 1] == std::string("raster") || argv[i + 1] == std::string("compute")))
+            voxelizer = argv[++i] == std::string("raster") ? SparseVoxelOctree::Voxelizer::raster : SparseVoxelOctree::Voxelizer::compute;
+        else if (arg == "--benchmark-voxelizers")
+            benchmarkVoxelizers = true;
+        else if (arg == "--dag")
+        {
+            dag = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                colorTolerance = std::stof(argv[++i]);
+        }
+        else if (arg == "--single-chunk")
+            chunkPerLevel = false;
+        else if (arg == "--verify-trace")
+            verifyTrace = true;
+        else
+        {
+            std::cout << "Unknown option " << arg << '\n';
+            printUsage();
+            return 1;
+        }
+    }
+
+    // the octree is built with the same code as at runtime, so a context is needed, but no window
+    util::setHeadless(true);
+    GLFWwindow* window = util::setupGLFWwindow(1, 1, "SVO bake");
+    util::initGL();
+    util::printOpenGLInfo();
+
+    try
+    {
+        const std::vector<std::shared_ptr<Mesh>> scene = ModelImporter::loadAllMeshesFromFile(model);
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            SparseVoxelOctree svo(scene, depth, mode, voxelizer);
+            const size_t bytesPerNode = sizeof(GLint) + sizeof(GLuint);
+            const size_t nodes = svo.getNodeCount();
+            const bool gpu = svo.getBuildMode() == SparseVoxelOctree::BuildMode::gpu;
+            const bool raster = svo.getVoxelizer() == SparseVoxelOctree::Voxelizer::raster;
+            std::cout << "Built octree of depth " << depth << " on the " << (gpu ? (raster ? "GPU (raster voxelizer)" : "GPU (compute voxelizer)") : "CPU")
+                      << " in " << millisecondsSince(start) << " ms: " << nodes << " nodes, " << nodes * bytesPerNode / 1024 << " KiB\n";
+
+            if (benchmarkVoxelizers && gpu)
+            {
+                // the buffers already fit the scene, so every update is a single full build and only the voxelizer differs
+                const SparseVoxelOctree::Voxelizer selected = svo.getVoxelizer();
+                const int updates = 10;
+                for (const auto candidate : { SparseVoxelOctree::Voxelizer::raster, SparseVoxelOctree::Voxelizer::compute })
+                {
+                    const char* name = candidate == SparseVoxelOctree::Voxelizer::raster ? "Raster" : "Compute";
+                    try
+                    {
+                        svo.setVoxelizer(candidate);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::cout << name << " voxelizer skipped: " << e.what() << '\n';
+                        continue;
+                    }
+                    svo.update();
+                    glFinish();
+                    start = std::chrono::steady_clock::now();
+                    for (int i = 0; i < updates; i++)
+                        svo.update();
+                    glFinish();
+                    const double updateMs = millisecondsSince(start) / updates;
+                    std::cout << name << " voxelizer: " << updateMs << " ms per full update, compared with the CPU builder: " << svo.verifyWithCPUBuilder().toString() << '\n';
+                }
+                svo.setVoxelizer(selected);
+                svo.update();
+            }
+
+            if (dag)
+            {
+                start = std::chrono::steady_clock::now();
+                svo.compress(colorTolerance);
+                const size_t dagNodes = svo.getNodeCount();
+                std::cout << "Compressed to a DAG in " << millisecondsSince(start) << " ms: " << dagNodes << " nodes, " << dagNodes * bytesPerNode / 1024 << " KiB\n";
+            }
+
+            if (verifyTrace)
+            {
+                // a view of the whole octree from outside
+                const glm::vec3 center = 0.5f * (svo.getBMin() + svo.getBMax());
+                const float size = svo.getBMax().x - svo.getBMin().x;
+                const glm::vec3 eye = center + glm::vec3(0.6f, 0.4f, 1.0f) * size;
+                const glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+                const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 1000.0f);
+                const int resolution = 512;
+                std::cout << "Tracer compared with the shader: " << svo.verifyTracer(view, projection, resolution, resolution).toString() << '\n';
+
+                const SparseVoxelOctreeTracer tracer = svo.createTracer();
+                const glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+                std::vector<SparseVoxelOctreeRay> rays;
+                rays.reserve(resolution * resolution);
+                for (int y = 0; y < resolution; y++)
+                {
+                    for (int x = 0; x < resolution; x++)
+                    {
+                        const glm::vec2 ndc = (glm::vec2(x, y) + 0.5f) / static_cast<float>(resolution) * 2.0f - 1.0f;
+                        const glm::vec4 target = inverseViewProjection * glm::vec4(ndc, 0.0f, 1.0f);
+                        rays.push_back({ eye, glm::normalize(glm::vec3(target) / target.w - eye) });
+                    }
+                }
+                std::vector<SparseVoxelOctreeHit> hits;
+                start = std::chrono::steady_clock::now();
+                tracer.trace(rays, hits);
+                const double traceMs = millisecondsSince(start);
+                std::cout << "Traced " << rays.size() << " rays on the CPU in " << traceMs << " ms (" << rays.size() / traceMs / 1000.0 << " million rays/s)\n";
+            }
+
+            svo.saveToFile(output, chunkPerLevel);
+            std::cout << "Wrote " << output.string() << " (" << std::experimental::filesystem::file_size(output) / 1024 << " KiB)\n";
+        }
+
+        // load it back the way the renderer does, as a check and to show the start up time
+        start = std::chrono::steady_clock::now();
+        {
+            const SparseVoxelOctree loaded(output);
+            glFinish();
+            std::cout << "Loaded " << loaded.getNodeCount() << " nodes back in " << millisecondsSince(start) << " ms\n";
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Baking failed: " << e.what() << '\n';
+        glfwDestroyWindow(window);
+        return 1;
+    }
+
+    glfwDestroyWindow(window);
+    return 0;
+}
@@ -12,6 +12,8 @@
 #include <experimental/filesystem>
 #include <map>
 #include <set>
+#include <string>
+#include <vector>
 
 #ifndef ERR_OUTPUT
 #include <iostream>
@@ -49,9 +51,13 @@ namespace glshader::process
         std::string contents;                               /* The fully processed shader code string. */
     };
 
+    /* Sets the OpenGL extension names that extension related #if statements are checked against.
+    Query them on the thread that owns the context, e.g. right after creating it, so shaders can be processed on any thread afterwards.
+    extensions -- All extension names of the context, replaces the ones set before. */
+    void set_extensions(const std::vector<std::string>& extensions);
+
     /* Loads and processes a shader file.
-    If being called while having a valid OpenGL context, all available extension names will be loaded and checked against when compiling.
-    Otherwise, extension related #if statements will always be evaluated as false.
+    Extension related #if statements are checked against the extensions passed to set_extensions, without any they are evaluated as false.
     file_path -- The source file to load.
     include_directories -- A list of include directories to search in when parsing includes.
     definitions -- A list of predefined definitions. */
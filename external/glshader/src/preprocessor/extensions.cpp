@@ -10,6 +10,11 @@ namespace glshader::process::impl::ext
         _extensions.emplace(extension);
     }
 
+    void clear_extensions()
+    {
+        _extensions.clear();
+    }
+
     bool extension_available(const std::string& extension)
     {
         return _extensions.count(extension) != 0;
@@ -6,6 +6,7 @@
 namespace glshader::process::impl::ext
 {
     void enable_extension(const char* extension);
+    void clear_extensions();
     bool extension_available(const std::string& extension);
     const std::set<std::string>& extensions() noexcept;
 }
\ No newline at end of file
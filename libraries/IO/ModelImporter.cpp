@@ -7,9 +7,61 @@
 #include "stb/stb_image.h"
 #include "Rendering/ShaderProgram.h"
 #include "Rendering/Binding.h"
+#include "Utils/GLStateCache.h"
+#include "Utils/Tracer.h"
 #include <execution>
 #include <algorithm>
 #include <unordered_set>
+#include <tuple>
+
+namespace
+{
+    // value of the OPACITY_MODE permutation axis for a material
+    int opacityMode(const PhongGPUMaterial& mat)
+    {
+        if (mat.opacity == -1.0f)
+            return 1;
+        if (mat.opacity == -2.0f)
+            return 2;
+        return 0;
+    }
+
+    bool isTransparent(const PhongGPUMaterial& mat)
+    {
+        return (mat.opacityTexture != -1 && mat.opacity != 1) || mat.opacity == -2.0f;
+    }
+
+    // average diffuse color of a material like getDiffColor in material.glsl: the mean of the diffuse texture if it has one, else the diffuse color
+    glm::vec3 materialAlbedo(const aiMaterial* mat, const std::experimental::filesystem::path& directory)
+    {
+        aiString reltexPath;
+        if (mat->GetTextureCount(aiTextureType_DIFFUSE) != 0 && mat->GetTexture(aiTextureType_DIFFUSE, 0, &reltexPath) == AI_SUCCESS)
+        {
+            const auto absTexPath = (directory / std::experimental::filesystem::path(reltexPath.C_Str())).string();
+            int width = 0;
+            int height = 0;
+            int channels = 0;
+            stbi_uc* data = stbi_load(absTexPath.c_str(), &width, &height, &channels, STBI_rgb);
+            if (data)
+            {
+                glm::dvec3 sum(0.0);
+                const size_t pixels = static_cast<size_t>(width) * height;
+                for (size_t i = 0; i < pixels; i++)
+                    sum += glm::dvec3(data[3 * i], data[3 * i + 1], data[3 * i + 2]);
+                stbi_image_free(data);
+                if (pixels > 0)
+                    return glm::vec3(sum / (255.0 * pixels));
+            }
+            std::cout << "WARNING: Could not load diffuse texture " << absTexPath << ", using the diffuse color as albedo\n";
+        }
+
+        aiColor3D diffcolor(1.0f, 1.0f, 1.0f);
+        mat->Get(AI_MATKEY_COLOR_DIFFUSE, diffcolor);
+        return glm::vec3(diffcolor.r, diffcolor.g, diffcolor.b);
+    }
+}
+
+std::shared_ptr<Uniform<int>> ModelImporter::s_drawIDOffsetUniform = std::make_shared<Uniform<int>>("drawIDOffset", 0);
 
 ModelImporter::ModelImporter(const std::experimental::filesystem::path& filename)
     : m_gpuMaterialBuffer(GL_SHADER_STORAGE_BUFFER), m_gpuMaterialIndicesBuffer(GL_SHADER_STORAGE_BUFFER), m_modelMatrixBuffer(GL_SHADER_STORAGE_BUFFER),
@@ -17,6 +69,7 @@ ModelImporter::ModelImporter(const std::experimental::filesystem::path& filename
     m_multiDrawNormalBuffer(GL_ARRAY_BUFFER), m_multiDrawTexCoordBuffer(GL_ARRAY_BUFFER), m_boundingBoxBuffer(GL_SHADER_STORAGE_BUFFER),
     m_cullingProgram({ Shader("frustumCulling.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions) })
 {
+    TRACE_SCOPE("ModelImporter::import");
 
     m_meshIndexUniform = std::make_shared<Uniform<int>>("meshIndex", -1);
     m_materialIndexUniform = std::make_shared<Uniform<int>>("materialIndex", -1);
@@ -246,25 +299,29 @@ ModelImporter::ModelImporter(const std::experimental::filesystem::path& filename
     m_gpuMaterialBuffer.setStorage(m_gpuMaterials, GL_DYNAMIC_STORAGE_BIT);
     m_gpuMaterialBuffer.bindBase(BufferBindings::Binding::materials);
 
-    m_modelMatrixBuffer.setStorage(m_modelMatrices, GL_DYNAMIC_STORAGE_BIT);
-    m_modelMatrixBuffer.bindBase(BufferBindings::Binding::modelMatrices);
+    // transparent meshes go last, inside both groups meshes are grouped by material variant
+    const auto sortKey = [this](const std::shared_ptr<Mesh>& mesh)
+    {
+        const PhongGPUMaterial& mat = m_gpuMaterials.at(mesh->getMaterialIndex());
+        return std::make_tuple(isTransparent(mat), mat.bumpType, opacityMode(mat));
+    };
+    std::stable_sort(m_meshes.begin(), m_meshes.end(), [&sortKey](const auto& a, const auto& b) { return sortKey(a) < sortKey(b); });
 
-	std::vector<std::shared_ptr<Mesh>> transparentMeshes;
-	for (int i = 0; i < m_meshes.size(); i++)
-	{
-        if (PhongGPUMaterial mat = m_gpuMaterials.at(m_meshes.at(i)->getMaterialIndex());
-        (mat.opacityTexture != -1 && mat.opacity != 1) || mat.opacity == -2.0f)
-        {
-            transparentMeshes.push_back(m_meshes.at(i));
-            m_meshes.erase(m_meshes.begin() + i--);
-        }
-    }
-    m_meshes.insert(m_meshes.end(), transparentMeshes.begin(), transparentMeshes.end());
+    // model matrices are indexed by draw id, so they have to follow the sorted mesh order
+    m_modelMatrices.clear();
+    m_modelMatrices.reserve(m_meshes.size());
 
     unsigned start = 0;
     unsigned baseVertexOffset = 0;
     for (const auto& mesh : m_meshes)
     {
+        const PhongGPUMaterial& mat = m_gpuMaterials.at(mesh->getMaterialIndex());
+        const std::vector<int> variant = { mat.bumpType, opacityMode(mat) };
+        if (m_drawBuckets.empty() || m_drawBuckets.back().variant != variant)
+            m_drawBuckets.push_back({ variant, static_cast<unsigned>(m_modelMatrices.size()), 0U });
+        m_drawBuckets.back().count++;
+
+        m_modelMatrices.push_back(mesh->getModelMatrix());
         m_gpuMaterialIndices.push_back(mesh->getMaterialIndex());
         m_boundingBoxes.emplace_back(mesh->getBoundingBox());
 
@@ -285,6 +342,9 @@ ModelImporter::ModelImporter(const std::experimental::filesystem::path& filename
         glm::mat2x4(glm::vec4(std::numeric_limits<float>::max()), glm::vec4(std::numeric_limits<float>::lowest())),
         [](glm::mat2x4 b1, glm::mat2x4 b2) {return glm::mat2x4(glm::min(b1[0], b2[0]), glm::max(b1[1], b2[1])); });
 
+    m_modelMatrixBuffer.setStorage(m_modelMatrices, GL_DYNAMIC_STORAGE_BIT);
+    m_modelMatrixBuffer.bindBase(BufferBindings::Binding::modelMatrices);
+
     m_gpuMaterialIndices.shrink_to_fit();
     m_boundingBoxes.shrink_to_fit();
     m_allTheIndices.shrink_to_fit();
@@ -348,9 +408,18 @@ std::vector<std::shared_ptr<Mesh>> ModelImporter::loadAllMeshesFromFile(const st
     {
         const auto numMeshes = scene->mNumMeshes;
         meshes.reserve(numMeshes);
+        // one albedo per material, textures are only averaged once
+        std::vector<glm::vec3> albedos;
+        albedos.reserve(scene->mNumMaterials);
+        for (unsigned i = 0; i < scene->mNumMaterials; i++)
+            albedos.push_back(materialAlbedo(scene->mMaterials[i], path.parent_path()));
+
         for (unsigned i = 0; i < numMeshes; i++)
         {
             meshes.emplace_back(std::make_shared<Mesh>(scene->mMeshes[i]));
+            const unsigned material = scene->mMeshes[i]->mMaterialIndex;
+            if (material < albedos.size())
+                meshes.back()->setAlbedo(albedos[material]);
         }
     }
 
@@ -379,6 +448,16 @@ void ModelImporter::registerUniforms(ShaderProgram& sp) const
     }
 }
 
+void ModelImporter::registerUniforms(ShaderVariants& variants)
+{
+    variants.addUniform(s_drawIDOffsetUniform);
+}
+
+std::vector<PermutationAxis> ModelImporter::getMaterialPermutationAxes()
+{
+    return { { "BUMP_TYPE", { 0, 1, 2 } }, { "OPACITY_MODE", { 0, 1, 2 } } };
+}
+
 void ModelImporter::resetIndirectDrawParams()
 {
     m_indirectDrawBuffer.setContentToContainerSubData(m_indirectDrawParams, 0);
@@ -408,18 +487,19 @@ void ModelImporter::multiDraw(const ShaderProgram& sp) const
     //m_materialIndexUniform->setContent(m_meshes.at(0)->getMaterialID());
     sp.use();
     m_multiDrawVao.bind();
-    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectDrawBuffer.getHandle());
+    GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectDrawBuffer.getHandle());
     glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(m_indirectDrawParams.size()), 0);
     //glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_counts.data(), GL_UNSIGNED_INT, reinterpret_cast<const GLvoid* const*>(m_starts.data()), static_cast<GLsizei>(m_counts.size()), m_baseVertexOffsets.data());
 }
 
 void ModelImporter::multiDrawCulled(const ShaderProgram& sp, const glm::mat4& viewProjection) const
 {
+    TRACE_SCOPE("ModelImporter::multiDrawCulled");
     // C U L L I N G
     m_viewProjUniform->setContent(viewProjection);
     m_cullingProgram.use();
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_indirectDrawBuffer.getHandle());
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_indirectDrawBuffer.getHandle());
     m_boundingBoxBuffer.bindBase(static_cast<BufferBindings::Binding>(6));
     m_modelMatrixBuffer.bindBase(BufferBindings::Binding::modelMatrices);
 
@@ -429,12 +509,38 @@ void ModelImporter::multiDrawCulled(const ShaderProgram& sp, const glm::mat4& vi
     // D R A W
     sp.use();
     m_multiDrawVao.bind();
-    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectDrawBuffer.getHandle());
+    GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectDrawBuffer.getHandle());
     glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(m_indirectDrawParams.size()), 0);
 }
 
+void ModelImporter::multiDrawCulled(ShaderVariants& variants, const glm::mat4& viewProjection) const
+{
+    TRACE_SCOPE("ModelImporter::multiDrawCulled");
+    // C U L L I N G
+    m_viewProjUniform->setContent(viewProjection);
+    m_cullingProgram.use();
+
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_indirectDrawBuffer.getHandle());
+    m_boundingBoxBuffer.bindBase(static_cast<BufferBindings::Binding>(6));
+    m_modelMatrixBuffer.bindBase(BufferBindings::Binding::modelMatrices);
+
+    glDispatchCompute(static_cast<GLuint>(glm::ceil(m_indirectDrawParams.size() / 64.0f)), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // D R A W, one multi-draw per material variant
+    m_multiDrawVao.bind();
+    GLStateCache::bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectDrawBuffer.getHandle());
+    for (const auto& bucket : m_drawBuckets)
+    {
+        s_drawIDOffsetUniform->setContent(static_cast<int>(bucket.first));
+        variants.get(bucket.variant).use();
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(bucket.first * sizeof(Indirect)), static_cast<GLsizei>(bucket.count), 0);
+    }
+}
+
 void ModelImporter::drawCulled(const ShaderProgram& sp, const glm::mat4& view, float angle, float ratio, float near, float far) const
 {
+    TRACE_SCOPE("ModelImporter::drawCulled");
     const glm::vec3 p = glm::inverse(view)[3];
     const glm::vec3 z = glm::normalize(glm::inverse(view)[2]);
 
@@ -13,6 +13,7 @@
 #include "Rendering/Uniform.h"
 #include "Rendering/Camera.h"
 #include "Rendering/ShaderProgram.h"
+#include "Rendering/ShaderVariants.h"
 
 class ShaderProgram;
 
@@ -40,11 +41,26 @@ struct Indirect
     unsigned baseInstance;
 };
 
+/**
+ * \brief consecutive range of draws that share the same material shader variant
+ */
+struct MaterialDrawBucket
+{
+    std::vector<int> variant;   // axis values, see ModelImporter::getMaterialPermutationAxes()
+    unsigned first;             // index of the first draw command
+    unsigned count;             // number of draw commands
+};
+
 class ModelImporter
 {
 public:
     static std::vector<std::shared_ptr<Mesh>> loadAllMeshesFromFile(const std::experimental::filesystem::path& filename);
 
+    /**
+     * \brief returns the permutation axes (BUMP_TYPE, OPACITY_MODE) used by multiDrawCulled with ShaderVariants
+     */
+    static std::vector<PermutationAxis> getMaterialPermutationAxes();
+
     explicit ModelImporter(const std::experimental::filesystem::path& filename);
 
     std::vector<std::shared_ptr<Mesh>> getMeshes() const;
@@ -57,7 +73,20 @@ public:
     void multiDraw(const ShaderProgram& sp) const;
     void multiDrawCulled(const ShaderProgram & sp, const glm::mat4 & viewProjection) const;
 
+    /**
+     * \brief culls all meshes, then issues one multi-draw per material bucket with the matching shader variant
+     * \param variants shader variants with the axes from getMaterialPermutationAxes()
+     * \param viewProjection view projection matrix used for culling
+     */
+    void multiDrawCulled(ShaderVariants& variants, const glm::mat4& viewProjection) const;
+
     void registerUniforms(ShaderProgram& sp) const;
+
+    /**
+     * \brief registers the draw id offset uniform that multiDrawCulled sets for each material bucket, shared by all models
+     */
+    static void registerUniforms(ShaderVariants& variants);
+
     void resetIndirectDrawParams();
 
     glm::mat2x4 getOuterBoundingBox() const;
@@ -78,6 +107,7 @@ private:
 
     std::shared_ptr<Uniform<int>> m_meshIndexUniform;
     std::shared_ptr<Uniform<int>> m_materialIndexUniform;
+    static std::shared_ptr<Uniform<int>> s_drawIDOffsetUniform;
 
     // multi-draw buffers
     std::vector<unsigned> m_allTheIndices;
@@ -86,6 +116,7 @@ private:
     std::vector<glm::vec3> m_allTheTexCoords;
 
     std::vector<Indirect> m_indirectDrawParams;
+    std::vector<MaterialDrawBucket> m_drawBuckets;
     Buffer m_indirectDrawBuffer;
 
     Buffer m_multiDrawIndexBuffer;
@@ -10,7 +10,14 @@ namespace BufferBindings
         lights = 8,
         materials = 9,
         modelMatrices = 10,
-        materialIndices = 11
+        materialIndices = 11,
+
+        // scratch bindings of the SparseVoxelOctree updates, apart from the ones above so the renderer keeps its buffers bound
+        brickGroups = 12,
+        voxelizeVertices = 13,
+        voxelizeIndices = 14,
+        voxelizeTileArgs = 15,
+        voxelizeTiles = 16
     };
 
     enum class VertexAttributeLocation : int
@@ -20,18 +27,17 @@ namespace BufferBindings
         texCoords = 2
     };
 
-    enum class Subroutine : int
-    {
-        multiDraw = 0,
-        normalDraw = 1
-    };
-
     inline std::vector<glsp::definition> g_definitions = {
         glsp::definition("CAMERA_BINDING", static_cast<int>(Binding::cameraParameters)),
         glsp::definition("LIGHTS_BINDING", static_cast<int>(Binding::lights)),
         glsp::definition("MATERIAL_BINDING", static_cast<int>(Binding::materials)),
         glsp::definition("MODELMATRICES_BINDING", static_cast<int>(Binding::modelMatrices)),
         glsp::definition("MATERIAL_INDICES_BINDING", static_cast<int>(Binding::materialIndices)),
+        glsp::definition("BRICK_GROUPS_BINDING", static_cast<int>(Binding::brickGroups)),
+        glsp::definition("VOXELIZE_VERTICES_BINDING", static_cast<int>(Binding::voxelizeVertices)),
+        glsp::definition("VOXELIZE_INDICES_BINDING", static_cast<int>(Binding::voxelizeIndices)),
+        glsp::definition("VOXELIZE_TILE_ARGS_BINDING", static_cast<int>(Binding::voxelizeTileArgs)),
+        glsp::definition("VOXELIZE_TILES_BINDING", static_cast<int>(Binding::voxelizeTiles)),
 
 
         glsp::definition("VERTEX_LAYOUT", static_cast<int>(VertexAttributeLocation::vertices)),
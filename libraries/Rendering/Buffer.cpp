@@ -1,6 +1,7 @@
 #include "Buffer.h"
 
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 #include <iostream>
 
 Buffer::Buffer(GLenum target) : m_target(target)
@@ -12,7 +13,7 @@ Buffer::~Buffer()
 {
     if (glfwGetCurrentContext() != nullptr)
     {
-        glDeleteBuffers(1, &m_bufferHandle);
+        GLStateCache::deleteBuffer(m_bufferHandle);
     }
     if constexpr (util::debugmode)
     {
@@ -38,12 +39,12 @@ size_t Buffer::getTypeSize() const
 
 void Buffer::bindBase(unsigned int binding) const
 {
-    glBindBufferBase(m_target, binding, m_bufferHandle);
+    GLStateCache::bindBufferBase(m_target, binding, m_bufferHandle);
 }
 
 void Buffer::bindBase(BufferBindings::Binding binding) const
 {
-    glBindBufferBase(m_target, static_cast<int>(binding), m_bufferHandle);
+    GLStateCache::bindBufferBase(m_target, static_cast<GLuint>(binding), m_bufferHandle);
 }
 
 void Buffer::unmapBuffer() const
@@ -53,6 +53,14 @@ public:
 	template<typename T, typename = std::void_t<decltype(std::data(std::declval<T>())), typename T::value_type>>
 	void setStorage(const T& container, BufferStorageMask flags);
 
+    /**
+     * \brief uses glBufferStorage without initial data, buffer will be immutable
+     * \tparam T type of the data elements
+     * \param count number of elements
+     * \param flags buffer flags
+     */
+    template<typename T>
+    void setStorageWithoutData(size_t count, BufferStorageMask flags);
 
     /**
      * \brief maps the buffer, writes data, unmaps the buffer
@@ -123,6 +131,19 @@ void Buffer::setStorage(const T& container, BufferStorageMask flags)
     util::getGLerror(__LINE__, __FUNCTION__);
 }
 
+template<typename T>
+void Buffer::setStorageWithoutData(size_t count, BufferStorageMask flags)
+{
+    util::getGLerror(__LINE__, __FUNCTION__);
+    m_bufferFlags = flags;
+    if (m_isImmutable)
+        throw std::runtime_error("Buffer is immutable, cannot reallocate buffer data");
+    glNamedBufferStorage(m_bufferHandle, count * sizeof(T), nullptr, flags);
+    m_isImmutable = true;
+    m_typeSize = sizeof(T);
+    util::getGLerror(__LINE__, __FUNCTION__);
+}
+
 /*
 *  Non-Initializing template functions
 */
@@ -153,7 +174,7 @@ void Buffer::setContentToContainerSubData(const T& container, size_t startOffset
             throw std::runtime_error("Buffer lacks GL_DYNAMIC_STORAGE_BIT flag for using SubData");
         }
     }
-    glNamedBufferSubData(m_bufferHandle, startOffset, sizeof(T::value_type), container.data());
+    glNamedBufferSubData(m_bufferHandle, startOffset, container.size() * sizeof(typename T::value_type), container.data());
 }
 
 
@@ -101,6 +101,16 @@ void Camera::setPhi(float phi)
 	m_phi = phi;
 }
 
+float Camera::getTheta() const
+{
+    return m_theta;
+}
+
+float Camera::getPhi() const
+{
+    return m_phi;
+}
+
 void Camera::setSensitivity(float sensitivity)
 {
     m_sensitivity = sensitivity;
@@ -62,6 +62,8 @@ public:
     void setPosition(glm::vec3 pos);
 	void setTheta(float theta);
 	void setPhi(float phi);
+    float getTheta() const;
+    float getPhi() const;
     void setSensitivity(float sensitivity);
     void setSensitivityFromBBox(glm::mat2x4 bbox);
 
@@ -0,0 +1,120 @@
+#include "CameraPath.h"
+
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+    template <typename T>
+    T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+    {
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+    }
+
+    // phi wraps around at 2 pi, take the equivalent angle closest to the reference so the camera does not spin
+    float unwrapAngle(float angle, float reference)
+    {
+        const float twoPi = glm::two_pi<float>();
+        while (angle - reference > glm::pi<float>())
+            angle -= twoPi;
+        while (angle - reference < -glm::pi<float>())
+            angle += twoPi;
+        return angle;
+    }
+}
+
+CameraPath::CameraPath(std::vector<CameraPose> keyframes) : m_keyframes(std::move(keyframes))
+{
+}
+
+CameraPath CameraPath::loadFromFile(const std::experimental::filesystem::path& file)
+{
+    std::ifstream in(file);
+    if (!in)
+        throw std::runtime_error("Could not open camera path " + file.string());
+
+    std::vector<CameraPose> keyframes;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream values(line);
+        CameraPose pose;
+        if (!(values >> pose.position.x >> pose.position.y >> pose.position.z >> pose.theta >> pose.phi))
+            throw std::runtime_error("Invalid keyframe in camera path " + file.string() + ": " + line);
+        keyframes.push_back(pose);
+    }
+    if (keyframes.empty())
+        throw std::runtime_error("Camera path " + file.string() + " contains no keyframes");
+
+    return CameraPath(std::move(keyframes));
+}
+
+CameraPath CameraPath::makePan(const CameraPose& start, float distance)
+{
+    const glm::vec3 dir = glm::normalize(glm::vec3(sin(start.theta) * sin(start.phi), -cos(start.theta), sin(start.theta) * cos(start.phi)));
+    std::vector<CameraPose> keyframes;
+    const std::array<float, 5> pan = { 0.0f, 0.4f, 0.0f, -0.4f, 0.0f };
+    for (size_t i = 0; i < pan.size(); i++)
+    {
+        const float f = static_cast<float>(i) / (pan.size() - 1);
+        keyframes.push_back({ start.position + dir * distance * f, start.theta, start.phi + pan[i] });
+    }
+    return CameraPath(std::move(keyframes));
+}
+
+void CameraPath::saveToFile(const std::experimental::filesystem::path& file) const
+{
+    std::ofstream out(file);
+    if (!out)
+        throw std::runtime_error("Could not write camera path " + file.string());
+
+    out << "# x y z theta phi\n";
+    for (const auto& pose : m_keyframes)
+        out << pose.position.x << ' ' << pose.position.y << ' ' << pose.position.z << ' ' << pose.theta << ' ' << pose.phi << '\n';
+}
+
+void CameraPath::addKeyframe(const CameraPose& pose)
+{
+    m_keyframes.push_back(pose);
+}
+
+CameraPose CameraPath::evaluate(float t) const
+{
+    if (m_keyframes.empty())
+        throw std::runtime_error("Camera path has no keyframes");
+    if (m_keyframes.size() == 1)
+        return m_keyframes.front();
+
+    const int last = static_cast<int>(m_keyframes.size()) - 1;
+    const float position = glm::clamp(t, 0.0f, 1.0f) * last;
+    const int segment = glm::min(static_cast<int>(position), last - 1);
+    const float local = position - segment;
+
+    // the end points are repeated as outer control points
+    const auto& k0 = m_keyframes[glm::max(segment - 1, 0)];
+    const auto& k1 = m_keyframes[segment];
+    const auto& k2 = m_keyframes[segment + 1];
+    const auto& k3 = m_keyframes[glm::min(segment + 2, last)];
+
+    CameraPose pose;
+    pose.position = catmullRom(k0.position, k1.position, k2.position, k3.position, local);
+    // same limits as the mouse control, the spline may overshoot
+    pose.theta = glm::clamp(catmullRom(k0.theta, k1.theta, k2.theta, k3.theta, local), 0.01f, glm::pi<float>() - 0.01f);
+    const float phi2 = unwrapAngle(k2.phi, k1.phi);
+    pose.phi = catmullRom(unwrapAngle(k0.phi, k1.phi), k1.phi, phi2, unwrapAngle(k3.phi, phi2), local);
+    return pose;
+}
+
+size_t CameraPath::getKeyframeCount() const
+{
+    return m_keyframes.size();
+}
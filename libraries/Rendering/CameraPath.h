@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <experimental/filesystem>
+
+#include <glm/glm.hpp>
+
+/**
+ * \brief camera position and view direction in the angles used by Camera
+ */
+struct CameraPose
+{
+    glm::vec3 position;
+    float theta;
+    float phi;
+};
+
+/**
+ * \brief smooth camera path through keyframes (Catmull-Rom), used for reproducible benchmark runs.
+ * Files contain one keyframe per line: "x y z theta phi", lines starting with # are ignored
+ */
+class CameraPath
+{
+public:
+    CameraPath() = default;
+    explicit CameraPath(std::vector<CameraPose> keyframes);
+
+    /**
+     * \brief loads a path, throws if the file can not be read or contains no keyframes
+     */
+    static CameraPath loadFromFile(const std::experimental::filesystem::path& file);
+
+    /**
+     * \brief creates a path that moves forward from a pose while panning left and right
+     * \param start first pose of the path
+     * \param distance distance moved along the view direction
+     */
+    static CameraPath makePan(const CameraPose& start, float distance);
+
+    void saveToFile(const std::experimental::filesystem::path& file) const;
+
+    void addKeyframe(const CameraPose& pose);
+
+    /**
+     * \brief evaluates the path
+     * \param t 0 at the first keyframe, 1 at the last one
+     * \return the interpolated pose
+     */
+    CameraPose evaluate(float t) const;
+
+    size_t getKeyframeCount() const;
+
+private:
+    std::vector<CameraPose> m_keyframes;
+};
@@ -1,6 +1,7 @@
 #include "FrameBuffer.h"
 #include <GLFW/glfw3.h>
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 
 FrameBuffer::FrameBuffer(const std::vector<std::shared_ptr<Texture>>& rendertargets, const bool useDepthStencil, const GLenum renderbufferFormat, int samples)
 {
@@ -55,19 +56,19 @@ FrameBuffer::~FrameBuffer()
 {
     if (glfwGetCurrentContext() != nullptr)
     {
-        glDeleteFramebuffers(1, &m_name);
+        GLStateCache::deleteFramebuffer(m_name);
     }
     util::getGLerror(__LINE__, __FUNCTION__);
 }
 
 void FrameBuffer::bind() const
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_name);
+    GLStateCache::bindFramebuffer(m_name);
 }
 
 void FrameBuffer::unbind() const
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindFramebuffer(0);
 }
 
 GLuint FrameBuffer::getName() const
@@ -0,0 +1,353 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <glbinding-aux/Meta.h>
+
+#include "imgui/imgui.h"
+#include "Utils/GPUProfiler.h"
+#include "Utils/Tracer.h"
+
+bool TransientTextureDesc::operator==(const TransientTextureDesc& other) const
+{
+    return target == other.target && width == other.width && height == other.height && depth == other.depth
+        && internalFormat == other.internalFormat;
+}
+
+bool TransientBufferDesc::operator==(const TransientBufferDesc& other) const
+{
+    return target == other.target && size == other.size && flags == other.flags;
+}
+
+FrameGraph::PassBuilder::PassBuilder(FrameGraph& graph, const size_t pass) : m_graph(graph), m_pass(pass)
+{
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::read(const ResourceHandle resource, const ResourceAccess access)
+{
+    if (resource >= m_graph.m_resources.size())
+        throw std::runtime_error("Frame graph pass reads an unknown resource");
+    m_graph.m_passes.at(m_pass).reads.push_back({ resource, access });
+    m_graph.m_compiled = false;
+    return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::write(const ResourceHandle resource, const ResourceAccess access)
+{
+    if (resource >= m_graph.m_resources.size())
+        throw std::runtime_error("Frame graph pass writes an unknown resource");
+    m_graph.m_passes.at(m_pass).writes.push_back({ resource, access });
+    m_graph.m_compiled = false;
+    return *this;
+}
+
+FrameGraph::ResourceHandle FrameGraph::importResource(std::string name)
+{
+    m_resources.push_back({ std::move(name), ResourceType::imported });
+    m_compiled = false;
+    return m_resources.size() - 1;
+}
+
+FrameGraph::ResourceHandle FrameGraph::createTexture(std::string name, const TransientTextureDesc& desc)
+{
+    Resource resource{ std::move(name), ResourceType::texture };
+    resource.textureDesc = desc;
+    m_resources.push_back(resource);
+    m_compiled = false;
+    return m_resources.size() - 1;
+}
+
+FrameGraph::ResourceHandle FrameGraph::createBuffer(std::string name, const TransientBufferDesc& desc)
+{
+    Resource resource{ std::move(name), ResourceType::buffer };
+    resource.bufferDesc = desc;
+    m_resources.push_back(resource);
+    m_compiled = false;
+    return m_resources.size() - 1;
+}
+
+FrameGraph::PassBuilder FrameGraph::addPass(std::string name, std::function<void()> execute)
+{
+    m_passes.push_back({ std::move(name), std::move(execute) });
+    m_compiled = false;
+    return PassBuilder(*this, m_passes.size() - 1);
+}
+
+void FrameGraph::markOutput(const ResourceHandle resource)
+{
+    if (resource >= m_resources.size())
+        throw std::runtime_error("Frame graph output is an unknown resource");
+    m_outputs.push_back(resource);
+    m_compiled = false;
+}
+
+void FrameGraph::compile()
+{
+    cullPasses();
+    deriveBarriers();
+    assignPhysicalResources();
+    m_compiled = true;
+}
+
+void FrameGraph::execute() const
+{
+    if (!m_compiled)
+        throw std::runtime_error("Frame graph has to be compiled before it is executed");
+
+    for (const auto& pass : m_passes)
+    {
+        if (pass.culled)
+            continue;
+        TRACE_SCOPE(pass.name.c_str());
+        GPUProfileScope scope(pass.name);
+        if (pass.barriers != MemoryBarrierMask::GL_NONE_BIT)
+            glMemoryBarrier(pass.barriers);
+        pass.execute();
+    }
+}
+
+Texture& FrameGraph::getTexture(const ResourceHandle resource) const
+{
+    const auto& r = m_resources.at(resource);
+    if (r.type != ResourceType::texture || !m_compiled || r.physical >= m_texturePool.size())
+        throw std::runtime_error("Frame graph resource " + r.name + " has no texture assigned");
+    return *m_texturePool.at(r.physical).object;
+}
+
+Buffer& FrameGraph::getBuffer(const ResourceHandle resource) const
+{
+    const auto& r = m_resources.at(resource);
+    if (r.type != ResourceType::buffer || !m_compiled || r.physical >= m_bufferPool.size())
+        throw std::runtime_error("Frame graph resource " + r.name + " has no buffer assigned");
+    return *m_bufferPool.at(r.physical).object;
+}
+
+void FrameGraph::showGUIContent() const
+{
+    const auto alivePasses = std::count_if(m_passes.begin(), m_passes.end(), [](const Pass& p) { return !p.culled; });
+    ImGui::Text("Frame graph: %d of %d passes", static_cast<int>(alivePasses), static_cast<int>(m_passes.size()));
+    for (const auto& pass : m_passes)
+    {
+        if (pass.culled)
+        {
+            ImGui::TextDisabled("  %s (culled)", pass.name.c_str());
+            continue;
+        }
+        ImGui::Text("  %s", pass.name.c_str());
+        if (pass.barriers != MemoryBarrierMask::GL_NONE_BIT)
+            ImGui::TextDisabled("    barrier: %s", glbinding::aux::Meta::getString(pass.barriers).c_str());
+    }
+    ImGui::Text("Transient textures: %d in %d objects", static_cast<int>(m_transientTextureCount), static_cast<int>(m_texturePool.size()));
+    ImGui::Text("Transient buffers: %d in %d objects", static_cast<int>(m_transientBufferCount), static_cast<int>(m_bufferPool.size()));
+}
+
+MemoryBarrierMask FrameGraph::getBarrierBit(const ResourceAccess access)
+{
+    switch (access)
+    {
+    case ResourceAccess::imageLoadStore: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    case ResourceAccess::shaderStorage: return GL_SHADER_STORAGE_BARRIER_BIT;
+    case ResourceAccess::atomicCounter: return GL_ATOMIC_COUNTER_BARRIER_BIT;
+    case ResourceAccess::textureFetch: return GL_TEXTURE_FETCH_BARRIER_BIT;
+    case ResourceAccess::uniformBuffer: return GL_UNIFORM_BARRIER_BIT;
+    case ResourceAccess::indirectCommand: return GL_COMMAND_BARRIER_BIT;
+    case ResourceAccess::vertexAttribute: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+    case ResourceAccess::elementArray: return GL_ELEMENT_ARRAY_BARRIER_BIT;
+    case ResourceAccess::bufferUpdate: return GL_BUFFER_UPDATE_BARRIER_BIT;
+    case ResourceAccess::textureUpdate: return GL_TEXTURE_UPDATE_BARRIER_BIT;
+    case ResourceAccess::pixelBuffer: return GL_PIXEL_BUFFER_BARRIER_BIT;
+    case ResourceAccess::framebuffer: return GL_FRAMEBUFFER_BARRIER_BIT;
+    default: throw std::runtime_error("Unknown resource access");
+    }
+}
+
+bool FrameGraph::isIncoherent(const ResourceAccess access)
+{
+    // only shader writes through images, SSBOs and atomic counters need a barrier before they are visible
+    return access == ResourceAccess::imageLoadStore || access == ResourceAccess::shaderStorage || access == ResourceAccess::atomicCounter;
+}
+
+void FrameGraph::cullPasses()
+{
+    // a pass is alive while one of the resources it writes is read or an output, a resource is needed while an alive pass reads it
+    std::vector<int> passRefs(m_passes.size(), 0);
+    std::vector<int> resourceRefs(m_resources.size(), 0);
+    std::vector<std::vector<size_t>> writers(m_resources.size());
+
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        m_passes[i].culled = false;
+        passRefs[i] = static_cast<int>(m_passes[i].writes.size());
+        for (const auto& write : m_passes[i].writes)
+            writers[write.resource].push_back(i);
+        for (const auto& read : m_passes[i].reads)
+            resourceRefs[read.resource]++;
+    }
+    for (const auto output : m_outputs)
+        resourceRefs[output]++;
+
+    std::vector<ResourceHandle> unreferenced;
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        if (resourceRefs[r] == 0)
+            unreferenced.push_back(r);
+    }
+
+    while (!unreferenced.empty())
+    {
+        const ResourceHandle resource = unreferenced.back();
+        unreferenced.pop_back();
+        for (const size_t pass : writers[resource])
+        {
+            if (passRefs[pass] == 0 || --passRefs[pass] > 0)
+                continue;
+            m_passes[pass].culled = true;
+            for (const auto& read : m_passes[pass].reads)
+            {
+                if (--resourceRefs[read.resource] == 0)
+                    unreferenced.push_back(read.resource);
+            }
+        }
+    }
+
+    // passes without any writes have no visible effect
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].writes.empty())
+            m_passes[i].culled = true;
+    }
+}
+
+void FrameGraph::deriveBarriers()
+{
+    struct ResourceState
+    {
+        bool incoherentWrite = false;
+        MemoryBarrierMask visible = MemoryBarrierMask::GL_NONE_BIT;    // barrier bits issued since the last write
+    };
+    std::vector<ResourceState> states(m_resources.size());
+
+    // the first iteration only carries the writes at the end of a frame over to the start of the next one
+    for (int frame = 0; frame < 2; frame++)
+    {
+        // transient contents do not survive the frame
+        for (size_t r = 0; r < m_resources.size(); r++)
+        {
+            if (m_resources[r].type != ResourceType::imported)
+                states[r] = ResourceState();
+        }
+
+        for (auto& pass : m_passes)
+        {
+            if (pass.culled)
+                continue;
+
+            MemoryBarrierMask barriers = MemoryBarrierMask::GL_NONE_BIT;
+            const auto require = [&states, &barriers](const Access& a)
+            {
+                const auto& state = states[a.resource];
+                const MemoryBarrierMask bit = getBarrierBit(a.access);
+                if (state.incoherentWrite && (state.visible & bit) == MemoryBarrierMask::GL_NONE_BIT)
+                    barriers |= bit;
+            };
+            for (const auto& read : pass.reads)
+                require(read);
+            for (const auto& write : pass.writes)
+                require(write);
+            pass.barriers = barriers;
+
+            // a barrier applies to all resources, not only the ones of this pass
+            if (barriers != MemoryBarrierMask::GL_NONE_BIT)
+            {
+                for (auto& state : states)
+                {
+                    if (state.incoherentWrite)
+                        state.visible |= barriers;
+                }
+            }
+
+            for (const auto& write : pass.writes)
+                states[write.resource] = { isIncoherent(write.access), MemoryBarrierMask::GL_NONE_BIT };
+        }
+    }
+}
+
+void FrameGraph::assignPhysicalResources()
+{
+    constexpr size_t unused = std::numeric_limits<size_t>::max();
+    std::vector<size_t> firstUse(m_resources.size(), unused);
+    std::vector<size_t> lastUse(m_resources.size(), 0);
+
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].culled)
+            continue;
+        const auto use = [&](const Access& a)
+        {
+            firstUse[a.resource] = std::min(firstUse[a.resource], i);
+            lastUse[a.resource] = std::max(lastUse[a.resource], i);
+        };
+        std::for_each(m_passes[i].reads.begin(), m_passes[i].reads.end(), use);
+        std::for_each(m_passes[i].writes.begin(), m_passes[i].writes.end(), use);
+    }
+
+    std::vector<ResourceHandle> transients;
+    for (size_t r = 0; r < m_resources.size(); r++)
+    {
+        m_resources[r].physical = unused;
+        if (m_resources[r].type != ResourceType::imported && firstUse[r] != unused)
+            transients.push_back(r);
+    }
+    std::sort(transients.begin(), transients.end(), [&firstUse](ResourceHandle a, ResourceHandle b) { return firstUse[a] < firstUse[b]; });
+
+    // greedy: reuse the first pooled object with the same description whose previous user is done.
+    // OpenGL has no placement of textures in shared memory, so aliasing means sharing whole objects
+    std::vector<size_t> textureBusyUntil(m_texturePool.size(), unused);
+    std::vector<size_t> bufferBusyUntil(m_bufferPool.size(), unused);
+    const auto acquire = [](auto& pool, std::vector<size_t>& busyUntil, const auto& desc, size_t first, size_t last, const auto& create)
+    {
+        for (size_t p = 0; p < pool.size(); p++)
+        {
+            if (pool[p].desc == desc && (busyUntil[p] == unused || busyUntil[p] < first))
+            {
+                busyUntil[p] = last;
+                return p;
+            }
+        }
+        pool.push_back({ desc, create(desc) });
+        busyUntil.push_back(last);
+        return pool.size() - 1;
+    };
+
+    m_transientTextureCount = 0;
+    m_transientBufferCount = 0;
+    for (const ResourceHandle r : transients)
+    {
+        auto& resource = m_resources[r];
+        if (resource.type == ResourceType::texture)
+        {
+            resource.physical = acquire(m_texturePool, textureBusyUntil, resource.textureDesc, firstUse[r], lastUse[r], [](const TransientTextureDesc& desc)
+            {
+                auto texture = std::make_unique<Texture>(desc.target, GL_LINEAR, GL_LINEAR);
+                if (desc.target == GL_TEXTURE_3D)
+                    texture->initWithoutData3D(desc.width, desc.height, desc.depth, desc.internalFormat);
+                else
+                    texture->initWithoutData(desc.width, desc.height, desc.internalFormat);
+                return texture;
+            });
+            m_transientTextureCount++;
+        }
+        else
+        {
+            resource.physical = acquire(m_bufferPool, bufferBusyUntil, resource.bufferDesc, firstUse[r], lastUse[r], [](const TransientBufferDesc& desc)
+            {
+                auto buffer = std::make_unique<Buffer>(desc.target);
+                buffer->setStorage(std::vector<char>(desc.size), desc.flags);
+                return buffer;
+            });
+            m_transientBufferCount++;
+        }
+    }
+}
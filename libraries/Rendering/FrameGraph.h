@@ -0,0 +1,209 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include "Texture.h"
+#include "Buffer.h"
+
+/**
+ * \brief how a pass accesses a resource, decides which barrier bits a later pass needs
+ */
+enum class ResourceAccess
+{
+    imageLoadStore,     // image load/store (incoherent)
+    shaderStorage,      // shader storage buffer (incoherent)
+    atomicCounter,      // atomic counter buffer (incoherent)
+    textureFetch,       // sampler access
+    uniformBuffer,
+    indirectCommand,    // draw/dispatch indirect parameters
+    vertexAttribute,
+    elementArray,
+    bufferUpdate,       // glBufferSubData, glGetBufferSubData, copies
+    textureUpdate,      // glTexSubImage, glGetTexImage
+    pixelBuffer,        // pixel pack/unpack buffer
+    framebuffer         // render target attachment
+};
+
+/**
+ * \brief description of a texture owned by the frame graph, equal descriptions may share one texture object
+ */
+struct TransientTextureDesc
+{
+    GLenum target = GL_TEXTURE_2D;
+    int width = 1;
+    int height = 1;
+    int depth = 1;
+    GLenum internalFormat = GL_RGBA8;
+
+    bool operator==(const TransientTextureDesc& other) const;
+};
+
+/**
+ * \brief description of a buffer owned by the frame graph, equal descriptions may share one buffer object
+ */
+struct TransientBufferDesc
+{
+    GLenum target = GL_SHADER_STORAGE_BUFFER;
+    size_t size = 0;
+    BufferStorageMask flags = GL_DYNAMIC_STORAGE_BIT;
+
+    bool operator==(const TransientBufferDesc& other) const;
+};
+
+/**
+ * \brief orders the passes of a frame by the resources they read and write.
+ * compile() removes passes that do not contribute to an output, derives the glMemoryBarrier bits
+ * each pass needs and lets transient resources with disjoint lifetimes share one GL object.
+ * Passes run in the order they were added, the graph only has to be compiled again if passes or resources change.
+ */
+class FrameGraph
+{
+public:
+    using ResourceHandle = size_t;
+
+    /**
+     * \brief declares the resource accesses of a pass
+     */
+    class PassBuilder
+    {
+    public:
+        PassBuilder& read(ResourceHandle resource, ResourceAccess access);
+        PassBuilder& write(ResourceHandle resource, ResourceAccess access);
+
+    private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph& graph, size_t pass);
+
+        FrameGraph& m_graph;
+        size_t m_pass;
+    };
+
+    FrameGraph() = default;
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    /**
+     * \brief registers a resource that lives outside of the graph (e.g. the default framebuffer, persistent textures)
+     * \param name debug name in the GUI
+     * \return handle to declare accesses with
+     */
+    ResourceHandle importResource(std::string name);
+
+    /**
+     * \brief registers a texture that only lives within a frame, it is created by compile()
+     * \param name debug name in the GUI
+     * \param desc texture description
+     * \return handle to declare accesses with
+     */
+    ResourceHandle createTexture(std::string name, const TransientTextureDesc& desc);
+
+    /**
+     * \brief registers a buffer that only lives within a frame, it is created by compile()
+     * \param name debug name in the GUI
+     * \param desc buffer description
+     * \return handle to declare accesses with
+     */
+    ResourceHandle createBuffer(std::string name, const TransientBufferDesc& desc);
+
+    /**
+     * \brief adds a pass, passes are executed in the order they are added
+     * \param name debug name in the GUI
+     * \param execute records the GL commands of the pass
+     * \return builder to declare the resource accesses of the pass
+     */
+    PassBuilder addPass(std::string name, std::function<void()> execute);
+
+    /**
+     * \brief marks a resource as result of the frame, passes not contributing to any output are culled
+     */
+    void markOutput(ResourceHandle resource);
+
+    /**
+     * \brief culls passes, derives barriers and assigns GL objects to transient resources
+     */
+    void compile();
+
+    /**
+     * \brief runs all passes that were not culled, issues the derived barriers before each pass
+     */
+    void execute() const;
+
+    /**
+     * \brief returns the texture assigned to a transient texture, only valid after compile()
+     */
+    Texture& getTexture(ResourceHandle resource) const;
+
+    /**
+     * \brief returns the buffer assigned to a transient buffer, only valid after compile()
+     */
+    Buffer& getBuffer(ResourceHandle resource) const;
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    void showGUIContent() const;
+
+private:
+    enum class ResourceType
+    {
+        imported,
+        texture,
+        buffer
+    };
+
+    struct Resource
+    {
+        std::string name;
+        ResourceType type;
+        TransientTextureDesc textureDesc;
+        TransientBufferDesc bufferDesc;
+        size_t physical = 0;            // index into the texture or buffer pool
+    };
+
+    struct Access
+    {
+        ResourceHandle resource;
+        ResourceAccess access;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Access> reads;
+        std::vector<Access> writes;
+        bool culled = false;
+        MemoryBarrierMask barriers = MemoryBarrierMask::GL_NONE_BIT;
+    };
+
+    template <typename Desc, typename Object>
+    struct PhysicalResource
+    {
+        Desc desc;
+        std::unique_ptr<Object> object;
+    };
+
+    static MemoryBarrierMask getBarrierBit(ResourceAccess access);
+    static bool isIncoherent(ResourceAccess access);
+
+    void cullPasses();
+    void deriveBarriers();
+    void assignPhysicalResources();
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<ResourceHandle> m_outputs;
+
+    // kept across compiles, so recompiling does not recreate GL objects
+    std::vector<PhysicalResource<TransientTextureDesc, Texture>> m_texturePool;
+    std::vector<PhysicalResource<TransientBufferDesc, Buffer>> m_bufferPool;
+    size_t m_transientTextureCount = 0;
+    size_t m_transientBufferCount = 0;
+    bool m_compiled = false;
+};
@@ -4,6 +4,7 @@
 #include "ShaderProgram.h"
 #include "Cubemap.h"
 #include "Quad.h"
+#include "Utils/GLStateCache.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& filename)
@@ -40,7 +41,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
     glGenFramebuffers(1, &captureFBO);
     glGenRenderbuffers(1, &captureRBO);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::bindFramebuffer(captureFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
@@ -62,8 +63,8 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
     m_viewUniform = std::make_shared<Uniform<glm::mat4>>("view", glm::mat4(1.0f));
     IBLtoCubeSP.addUniform(m_viewUniform);
 
-    glViewport(0, 0, 512, 512);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::viewport(0, 0, 512, 512);
+    GLStateCache::bindFramebuffer(captureFBO);
     for (unsigned int i = 0; i < 6; ++i)
     {
         m_viewUniform->setContent(captureViews.at(i));
@@ -74,7 +75,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
 
         m_cube.draw();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindFramebuffer(0);
 
     /////// Intermediate Step
     // Setup to draw the cubemap in draw()
@@ -95,15 +96,15 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
     m_irradianceCubemap.initWithoutData(32, 32, GL_RGB16F, GL_RGB, GL_FLOAT);
     m_irradianceCubemap.generateHandle();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::bindFramebuffer(captureFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
 
     irradiancePS.addUniform(m_projUniform);
     irradiancePS.addUniform(m_viewUniform);
     irradiancePS.updateUniforms();
-    glViewport(0, 0, 32, 32);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::viewport(0, 0, 32, 32);
+    GLStateCache::bindFramebuffer(captureFBO);
     for (unsigned int i = 0; i < 6; ++i)
     {
         m_viewUniform->setContent(captureViews.at(i));
@@ -113,7 +114,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
 
         m_cube.draw();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindFramebuffer(0);
 
     // uncomment this to render the blurry irradiance map instead of the environment map
     //m_iblSkyboxTextureBuffer.setContentSubData(m_irradianceCubemap.getHandle(), 0);
@@ -139,7 +140,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
     auto roughnessUniform = std::make_shared<Uniform<float>>("roughness", roughness);
     specularSP.addUniform(roughnessUniform);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::bindFramebuffer(captureFBO);
     for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
     {
         // reisze framebuffer according to mip-level size.
@@ -147,7 +148,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
         const auto mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
         glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
+        GLStateCache::viewport(0, 0, mipWidth, mipHeight);
 
         roughness = static_cast<float>(mip) / static_cast<float>(maxMipLevels - 1);
         roughnessUniform->setContent(roughness);
@@ -162,7 +163,7 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
             m_cube.draw();
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindFramebuffer(0);
     //m_iblSkyboxTextureBuffer.setContentSubData(m_specularCubemap.getHandle(), 0);
 
     /////////////////////////////////////////////
@@ -173,19 +174,19 @@ IBLCubemapMaker::IBLCubemapMaker(const std::experimental::filesystem::path& file
     m_brdfLUT.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
     m_brdfLUT.generateHandle();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLStateCache::bindFramebuffer(captureFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_brdfLUT.getName(), 0);
 
     ShaderProgram brdfLutSP("texSFQ.vert", "brdfLUT.frag");
     Quad quad;
-    glViewport(0, 0, 512, 512);
+    GLStateCache::viewport(0, 0, 512, 512);
     brdfLutSP.use();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     quad.draw();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLStateCache::bindFramebuffer(0);
 }
 
 Cubemap IBLCubemapMaker::getEnvironmentCubemap() const
@@ -212,12 +213,12 @@ void IBLCubemapMaker::draw(glm::mat4 view, glm::mat4 proj)
 {
     m_iblSkyboxSP.showReloadShaderGUI({ m_skyBoxVS, m_skyBoxFS }, "Skybox rendering");
     glDepthFunc(GL_LEQUAL);
-    glDisable(GL_CULL_FACE);
+    GLStateCache::disable(GL_CULL_FACE);
     m_iblSkyboxSP.use();
     m_viewUniform->setContent(view);
     m_projUniform->setContent(proj);
     m_iblSkyboxSP.updateUniforms();
     m_cube.draw();
-    glEnable(GL_CULL_FACE);
+    GLStateCache::enable(GL_CULL_FACE);
     glDepthFunc(GL_LEQUAL);
 }
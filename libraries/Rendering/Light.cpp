@@ -5,6 +5,7 @@
 #include <sstream>
 #include "Cubemap.h"
 #include "IO/ModelImporter.h"
+#include "Utils/GLStateCache.h"
 #include <glm/gtx/component_wise.inl>
 
 using namespace gl;
@@ -12,7 +13,7 @@ using namespace gl;
 Light::Light(glm::vec3 color, glm::vec3 direction, float smFar ,glm::ivec2 shadowMapRes) // DIRECTIONAL
 : m_type(LightType::directional), m_shadowMapRes(shadowMapRes), m_smFar(smFar),
 m_shadowTexture(std::make_shared<Texture>(GL_TEXTURE_2D, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)), m_shadowMapFBO(GL_DEPTH_ATTACHMENT, *m_shadowTexture),
-m_genShadowMapProgram("lightTransform.vert", "smAlpha.frag", BufferBindings::g_definitions)
+m_genShadowMapVariants({ { "lightTransform.vert", GL_VERTEX_SHADER }, { "smAlpha.frag", GL_FRAGMENT_SHADER } }, { { "MULTIDRAW", { 0, 1 } } }, BufferBindings::g_definitions)
 {
     checkParameters();
 
@@ -25,8 +26,9 @@ m_genShadowMapProgram("lightTransform.vert", "smAlpha.frag", BufferBindings::g_d
     m_modelUniform = std::make_shared<Uniform<glm::mat4>>("ModelMatrix", glm::mat4(1.0f));
     m_lightSpaceUniform = std::make_shared<Uniform<glm::mat4>>("lightSpaceMatrix", glm::mat4(1.0f));
 
-    m_genShadowMapProgram.addUniform(m_modelUniform);
-    m_genShadowMapProgram.addUniform(m_lightSpaceUniform);
+    m_genShadowMapVariants.addUniform(m_modelUniform);
+    m_genShadowMapVariants.addUniform(m_lightSpaceUniform);
+    m_genShadowMapVariants.precompileAll();
 
     // init gpu struct
     m_gpuLight.type = static_cast<int>(m_type);
@@ -40,10 +42,10 @@ m_genShadowMapProgram("lightTransform.vert", "smAlpha.frag", BufferBindings::g_d
 Light::Light(glm::vec3 color, glm::vec3 position, float constant, float linear, float quadratic, float smFar, glm::ivec2 shadowMapRes) // POINT
 : m_type(LightType::point), m_shadowMapRes(shadowMapRes), m_smFar(smFar),
 m_shadowTexture(std::make_shared<Cubemap>(GL_LINEAR, GL_LINEAR)), m_shadowMapFBO(GL_DEPTH_ATTACHMENT, *m_shadowTexture),
-m_genShadowMapProgram({
-    Shader("transform.vert", GL_VERTEX_SHADER, BufferBindings::g_definitions),
-    Shader("omnidirectional.geom", GL_GEOMETRY_SHADER, BufferBindings::g_definitions),
-    Shader("omnidirectional.frag", GL_FRAGMENT_SHADER, BufferBindings::g_definitions) })
+m_genShadowMapVariants({
+    { "transform.vert", GL_VERTEX_SHADER },
+    { "omnidirectional.geom", GL_GEOMETRY_SHADER },
+    { "omnidirectional.frag", GL_FRAGMENT_SHADER } }, { { "MULTIDRAW", { 0, 1 } } }, BufferBindings::g_definitions)
 {
     checkParameters();
 
@@ -57,9 +59,10 @@ m_genShadowMapProgram({
     m_modelUniform = std::make_shared<Uniform<glm::mat4>>("ModelMatrix", glm::mat4(1.0f));
     m_lightSpaceUniform = std::make_shared<Uniform<glm::mat4>>("lightSpaceMatrix", glm::mat4(1.0f));
 
-    m_genShadowMapProgram.addUniform(m_modelUniform);
-    m_genShadowMapProgram.addUniform(m_lightSpaceUniform);
-    m_genShadowMapProgram.addUniform(m_lightPosUniform);
+    m_genShadowMapVariants.addUniform(m_modelUniform);
+    m_genShadowMapVariants.addUniform(m_lightSpaceUniform);
+    m_genShadowMapVariants.addUniform(m_lightPosUniform);
+    m_genShadowMapVariants.precompileAll();
 
     // init gpu struct
     m_gpuLight.type = static_cast<int>(m_type);
@@ -78,7 +81,7 @@ m_genShadowMapProgram({
 Light::Light(glm::vec3 color, glm::vec3 position, glm::vec3 direction, float constant, float linear, float quadratic, float cutOff, float outerCutOff, float smFar, glm::ivec2 shadowMapRes) // SPOT
     : m_type(LightType::spot), m_shadowMapRes(shadowMapRes), m_smFar(smFar),
     m_shadowTexture(std::make_shared<Texture>(GL_TEXTURE_2D, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)), m_shadowMapFBO(GL_DEPTH_ATTACHMENT, *m_shadowTexture),
-   m_genShadowMapProgram("lightTransform.vert", "smAlpha.frag", BufferBindings::g_definitions)
+   m_genShadowMapVariants({ { "lightTransform.vert", GL_VERTEX_SHADER }, { "smAlpha.frag", GL_FRAGMENT_SHADER } }, { { "MULTIDRAW", { 0, 1 } } }, BufferBindings::g_definitions)
 {
     checkParameters();
 
@@ -91,8 +94,9 @@ Light::Light(glm::vec3 color, glm::vec3 position, glm::vec3 direction, float con
     m_modelUniform = std::make_shared<Uniform<glm::mat4>>("ModelMatrix", glm::mat4(1.0f));
     m_lightSpaceUniform = std::make_shared<Uniform<glm::mat4>>("lightSpaceMatrix", glm::mat4(1.0f));
 
-    m_genShadowMapProgram.addUniform(m_modelUniform);
-    m_genShadowMapProgram.addUniform(m_lightSpaceUniform);
+    m_genShadowMapVariants.addUniform(m_modelUniform);
+    m_genShadowMapVariants.addUniform(m_lightSpaceUniform);
+    m_genShadowMapVariants.precompileAll();
 
     // init gpu struct
     m_gpuLight.type = static_cast<int>(m_type);
@@ -116,28 +120,25 @@ void Light::renderShadowMap(const std::vector<std::shared_ptr<Mesh>>& meshes)
 
     recalculateLightSpaceMatrix();
 
-    //store old viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    //store old viewport (tracked by the state cache, no glGet)
+    const auto viewport = GLStateCache::getViewport();
 
     //set sm settings
-    m_genShadowMapProgram.use();
-    glViewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
+    const ShaderProgram& sp = m_genShadowMapVariants.get({ 0 });
+    sp.use();
+    GLStateCache::viewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
     m_shadowMapFBO.bind();
     glClear(GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);
+    GLStateCache::cullFace(GL_FRONT);
 
     if (m_type == LightType::point && m_lightPosUniform->getContent() != m_gpuLight.position)
         m_lightPosUniform->setContent(m_gpuLight.position);
 
-    GLuint srIndex[] = { 1 };
-    glUniformSubroutinesuiv(GL_VERTEX_SHADER, 1, srIndex);
-
     //render scene
-    std::for_each(meshes.begin(), meshes.end(), [this](auto& mesh)
+    std::for_each(meshes.begin(), meshes.end(), [this, &sp](auto& mesh)
     {
         m_modelUniform->setContent(mesh->getModelMatrix());
-        m_genShadowMapProgram.updateUniforms();
+        sp.updateUniforms();
         mesh->draw();
     });
 
@@ -145,8 +146,8 @@ void Light::renderShadowMap(const std::vector<std::shared_ptr<Mesh>>& meshes)
 
     //restore previous rendering settings
     m_shadowMapFBO.unbind();
-    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-    glCullFace(GL_BACK);
+    GLStateCache::viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::cullFace(GL_BACK);
 }
 
 void Light::renderShadowMap(const ModelImporter& mi)
@@ -156,29 +157,29 @@ void Light::renderShadowMap(const ModelImporter& mi)
 
     recalculateLightSpaceMatrix();
 
-    //store old viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    //store old viewport (tracked by the state cache, no glGet)
+    const auto viewport = GLStateCache::getViewport();
 
     //set sm settings
-    m_genShadowMapProgram.use();
-    glViewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
+    const ShaderProgram& sp = m_genShadowMapVariants.get({ 1 });
+    sp.use();
+    GLStateCache::viewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
     m_shadowMapFBO.bind();
     glClear(GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);
+    GLStateCache::cullFace(GL_FRONT);
 
     if (m_type == LightType::point && m_lightPosUniform->getContent() != m_gpuLight.position)
         m_lightPosUniform->setContent(m_gpuLight.position);
 
     //render scene
-    mi.multiDraw(m_genShadowMapProgram);
+    mi.multiDraw(sp);
 
     m_shadowTexture->generateMipmap();
 
     //restore previous rendering settings
     m_shadowMapFBO.unbind();
-    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-    glCullFace(GL_BACK);
+    GLStateCache::viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::cullFace(GL_BACK);
 }
 
 void Light::renderShadowMapCulled(const ModelImporter& mi)
@@ -194,29 +195,29 @@ void Light::renderShadowMapCulled(const ModelImporter& mi)
 
     recalculateLightSpaceMatrix();
 
-    //store old viewport
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    //store old viewport (tracked by the state cache, no glGet)
+    const auto viewport = GLStateCache::getViewport();
 
     //set sm settings
-    m_genShadowMapProgram.use();
-    glViewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
+    const ShaderProgram& sp = m_genShadowMapVariants.get({ 1 });
+    sp.use();
+    GLStateCache::viewport(0, 0, m_shadowMapRes.x, m_shadowMapRes.y);
     m_shadowMapFBO.bind();
     glClear(GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);
+    GLStateCache::cullFace(GL_FRONT);
 
     if (m_type == LightType::point && m_lightPosUniform->getContent() != m_gpuLight.position)
         m_lightPosUniform->setContent(m_gpuLight.position);
 
     //render scene
-    mi.multiDrawCulled(m_genShadowMapProgram, m_gpuLight.lightSpaceMatrix);
+    mi.multiDrawCulled(sp, m_gpuLight.lightSpaceMatrix);
 
     m_shadowTexture->generateMipmap();
 
     //restore previous rendering settings
     m_shadowMapFBO.unbind();
-    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-    glCullFace(GL_BACK);
+    GLStateCache::viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    GLStateCache::cullFace(GL_BACK);
 }
 
 void Light::recalculateLightSpaceMatrix()
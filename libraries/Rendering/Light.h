@@ -6,6 +6,7 @@
 #include "Buffer.h"
 #include "Texture.h"
 #include "ShaderProgram.h"
+#include "ShaderVariants.h"
 #include "Mesh.h"
 #include "FrameBuffer.h"
 
@@ -102,7 +103,7 @@ private:
 
     std::shared_ptr<Texture> m_shadowTexture;
     FrameBuffer m_shadowMapFBO;
-    ShaderProgram m_genShadowMapProgram;
+    ShaderVariants m_genShadowMapVariants; // MULTIDRAW: model matrix from uniform (0) or from the model matrix buffer (1)
 
     std::optional<glm::mat2x4> m_outerSceneBoundingBox;
 
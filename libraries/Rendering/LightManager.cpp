@@ -1,5 +1,6 @@
 #include "LightManager.h"
 #include "imgui/imgui.h"
+#include "Utils/Tracer.h"
 #include <execution>
 
 // Light Manager
@@ -81,6 +82,7 @@ void LightManager::renderShadowMaps(const ModelImporter& mi)
 
 void LightManager::renderShadowMapsCulled(const ModelImporter& scene)
 {
+    TRACE_SCOPE("LightManager::renderShadowMapsCulled");
     std::for_each(m_lightList.begin(), m_lightList.end(), [&scene](auto& light)
     {
         light->renderShadowMapCulled(scene);
@@ -117,6 +117,16 @@ void Mesh::setMaterialID(const unsigned materialID)
     m_materialID = materialID;
 }
 
+void Mesh::setAlbedo(const glm::vec3& albedo)
+{
+    m_albedo = albedo;
+}
+
+const glm::vec3& Mesh::getAlbedo() const
+{
+    return m_albedo;
+}
+
 const std::vector<glm::vec3>& Mesh::getVertices() const
 {
     if (m_vertices.empty())
@@ -169,6 +179,16 @@ const glm::mat2x3& Mesh::calculateBoundingBox()
     return m_boundingBox;
 }
 
+const Buffer& Mesh::getVertexBuffer() const
+{
+    return m_vertexBuffer;
+}
+
+const Buffer& Mesh::getIndexBuffer() const
+{
+    return m_indexBuffer;
+}
+
 void Mesh::setEnabledForRendering(bool enable)
 {
     m_enabledForRendering = enable;
@@ -84,6 +84,20 @@ public:
      */
     void setMaterialID(const unsigned materialID);
 
+    /**
+     * \brief sets the average diffuse color of the material, used as voxel color by the octree voxelizers
+     * \param albedo linear RGB, white by default
+     */
+    void setAlbedo(const glm::vec3& albedo);
+    const glm::vec3& getAlbedo() const;
+
+    /**
+     * \brief returns the GPU buffers of the vertices (tightly packed vec3) and indices, e.g. to read them in compute shaders.
+     * They are empty if the mesh was created without its own buffers
+     */
+    const Buffer& getVertexBuffer() const;
+    const Buffer& getIndexBuffer() const;
+
     void setEnabledForRendering(bool enable);
     bool isEnabledForRendering() const;
 
@@ -101,6 +115,8 @@ private:
 
     unsigned m_materialID = 1U;
 
+    glm::vec3 m_albedo = glm::vec3(1.0f);
+
     Buffer m_vertexBuffer;
     Buffer m_normalBuffer;
     Buffer m_texCoordBuffer;
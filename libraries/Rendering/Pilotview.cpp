@@ -19,6 +19,21 @@ void Pilotview::reset()
     m_phi = glm::pi<float>();
 }
 
+void Pilotview::setPose(glm::vec3 pos, float theta, float phi)
+{
+    m_pos = pos;
+    m_theta = theta;
+    m_phi = phi;
+
+    m_dir.x = sin(m_theta) * sin(m_phi);
+    m_dir.y = -cos(m_theta);
+    m_dir.z = sin(m_theta) * cos(m_phi);
+    m_dir = glm::normalize(m_dir);
+
+    m_center = m_pos + m_dir;
+    m_viewMatrix = lookAt(m_pos, m_center, m_up);
+}
+
 void Pilotview::setDirection(glm::vec3 dir)
 {
     m_dir = dir;
@@ -14,6 +14,14 @@ public:
 
     void reset() override;
 
+    /**
+     * \brief places the camera without any input, e.g. for camera paths
+     * \param pos camera position
+     * \param theta polar angle of the view direction
+     * \param phi azimuth of the view direction
+     */
+    void setPose(glm::vec3 pos, float theta, float phi);
+
     void setDirection(glm::vec3 dir);
     glm::vec3 getDirection() const override;
 
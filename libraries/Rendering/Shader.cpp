@@ -3,6 +3,7 @@
 #include <array>
 #include <iostream>
 #include <string>
+#include <mutex>
 
 #include "Utils/UtilCollection.h"
 #include "glbinding-aux/Meta.h"
@@ -20,14 +21,30 @@ Shader::Shader(const std::experimental::filesystem::path& path, GLenum shaderTyp
 }
 
 void Shader::init() const
+{
+    compile(preprocess());
+}
+
+glsp::processed_file Shader::preprocess() const
 {
     if (m_path.empty())
     {
         throw std::runtime_error("No path given");
     }
-    // load shader file and use it
-    auto shaderCode = loadShaderFile(std::experimental::filesystem::path(util::gs_shaderPath) / m_path);
-    std::array<const GLchar*, 1> codeArray{shaderCode.c_str()};
+
+    // glsp keeps global state, so only one preprocessor may run at a time
+    static std::mutex preprocessMutex;
+    std::lock_guard<std::mutex> lock(preprocessMutex);
+
+    const auto fileName = std::experimental::filesystem::path(util::gs_shaderPath) / m_path;
+    auto file = glsp::preprocess_file(fileName, { util::gs_shaderPath }, m_definitions);
+    std::cout << "Loaded " << glbinding::aux::Meta::getString(m_shaderType) << " from " << fileName << std::endl;
+    return file;
+}
+
+void Shader::compile(const glsp::processed_file& file) const
+{
+    std::array<const GLchar*, 1> codeArray{file.contents.c_str()};
     glShaderSource(m_shaderHandle, 1, codeArray.data(), nullptr);
 
     // compile shader
@@ -51,6 +68,29 @@ void Shader::init() const
         throw std::runtime_error("Shader compilation failed");
     }
     util::getGLerror(__LINE__, __FUNCTION__);
+
+    m_dependencies = file.dependencies;
+    m_dependencies.insert(file.file_path);
+}
+
+Shader Shader::createFromSource(const glsp::processed_file& file) const
+{
+    Shader shader(*this);
+    shader.m_shaderHandle = glCreateShader(m_shaderType);
+    if (0 == shader.m_shaderHandle)
+    {
+        throw std::runtime_error("Error creating shader.");
+    }
+    try
+    {
+        shader.compile(file);
+    }
+    catch (std::runtime_error&)
+    {
+        glDeleteShader(shader.m_shaderHandle);
+        throw;
+    }
+    return shader;
 }
 
 GLuint Shader::getHandle() const
@@ -63,9 +103,7 @@ GLenum Shader::getShaderType() const
     return m_shaderType;
 }
 
-std::string Shader::loadShaderFile(const std::experimental::filesystem::path& fileName) const
+const std::set<std::experimental::filesystem::path>& Shader::getDependencies() const
 {
-    auto file = glsp::preprocess_file(fileName, { util::gs_shaderPath }, m_definitions);
-    std::cout << "Loaded " << glbinding::aux::Meta::getString(m_shaderType) << " from " << fileName << std::endl;;
-    return file.contents;
+    return m_dependencies;
 }
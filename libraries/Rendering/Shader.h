@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <set>
 #include <filesystem>
 
 #include <glbinding/gl/gl.h>
@@ -14,6 +15,25 @@ public:
     
     void init() const;
 
+    /**
+     * \brief runs the preprocessor on the shader file. Does not use any OpenGL state and can be called from a worker thread
+     * \return preprocessed source and the files it was included from
+     */
+    glsp::processed_file preprocess() const;
+
+    /**
+     * \brief compiles already preprocessed source into this shader
+     * \param file result of preprocess()
+     */
+    void compile(const glsp::processed_file& file) const;
+
+    /**
+     * \brief creates a new shader object with the same type, path and definitions from already preprocessed source
+     * \param file result of preprocess()
+     * \return the newly compiled shader, this shader stays untouched
+     */
+    Shader createFromSource(const glsp::processed_file& file) const;
+
     /**
      * \brief returns the shader handle
      * \return shader handle
@@ -26,12 +46,17 @@ public:
      */
     GLenum getShaderType() const;
 
+    /**
+     * \brief returns all files the shader was built from in the last compilation, including the shader file itself
+     * \return set of file paths
+     */
+    const std::set<std::experimental::filesystem::path>& getDependencies() const;
+
 private:
     GLuint m_shaderHandle;
     GLenum m_shaderType;
     std::experimental::filesystem::path m_path;
 
     std::vector<glsp::definition> m_definitions;
-
-    std::string loadShaderFile(const std::experimental::filesystem::path& fileName) const;
+    mutable std::set<std::experimental::filesystem::path> m_dependencies;
 };
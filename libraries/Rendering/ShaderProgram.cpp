@@ -5,6 +5,8 @@
 #include <typeinfo>
 #include <glm/gtc/type_ptr.hpp>
 #include <glbinding-aux/Meta.h>
+#include "Utils/GLStateCache.h"
+#include "Utils/Tracer.h"
 
 ShaderProgram::ShaderProgram(const std::experimental::filesystem::path& vspath, const std::experimental::filesystem::path& fspath, const std::vector<glsp::definition>& definitions)
     : m_initWithShaders(true)
@@ -60,11 +62,23 @@ void ShaderProgram::changeShader(const Shader& shader)
         glDetachShader(m_shaderProgramHandle, shader.getHandle());
         glAttachShader(m_shaderProgramHandle, search->second.getHandle());
         linkProgram();
+        throw;
     }
     // insert new shader into map when everything worked
     m_shaderMap.insert_or_assign(shader.getShaderType(), shader);
 }
 
+void ShaderProgram::reloadShader(const Shader& shader)
+{
+    changeShader(shader);
+    forceUpdateUniforms();
+}
+
+const std::unordered_map<GLenum, Shader>& ShaderProgram::getShaders() const
+{
+    return m_shaderMap;
+}
+
 ShaderProgram::~ShaderProgram()
 {
     if (glfwGetCurrentContext() != nullptr)
@@ -74,7 +88,7 @@ ShaderProgram::~ShaderProgram()
         glDeleteShader(shaderPair.second.getHandle());
 
         // delete porgram
-        glDeleteProgram(m_shaderProgramHandle);
+        GLStateCache::deleteProgram(m_shaderProgramHandle);
     }
     util::getGLerror(__LINE__, __FUNCTION__);
 }
@@ -141,12 +155,13 @@ GLuint ShaderProgram::getShaderProgramHandle() const
 
 void ShaderProgram::use() const
 {
-    glUseProgram(m_shaderProgramHandle);
+    GLStateCache::useProgram(m_shaderProgramHandle);
     updateUniforms();
 }
 
 void ShaderProgram::updateUniforms() const
 {
+    TRACE_SCOPE("ShaderProgram::updateUniforms");
     for (auto&& n : m_anyUniforms)
     {
         // case int
@@ -353,8 +368,11 @@ void ShaderProgram::showReloadShaderGUIContent(const std::vector<Shader>& shader
 		{
 			try
 			{
-				shader.init();
-				changeShader(shader);
+				// the shader object of the program, the given one may have been replaced and deleted by a ShaderWatcher
+				const auto search = m_shaderMap.find(shader.getShaderType());
+				const Shader current = search != m_shaderMap.end() ? search->second : shader;
+				current.init();
+				changeShader(current);
 				use();
 				forceUpdateUniforms();
 			}
@@ -55,6 +55,18 @@ public:
      */
     void changeShader(const Shader& shader);
 
+    /**
+     * \brief swaps in an already compiled shader and restores all uniforms, which are reset by relinking
+     * \param shader new shader to be used
+     */
+    void reloadShader(const Shader& shader);
+
+    /**
+     * \brief returns the shaders of this program
+     * \return map from shader type to shader
+     */
+    const std::unordered_map<GLenum, Shader>& getShaders() const;
+
     /**
      * \brief adds an unifrom to the container of uniforms
      * \tparam UniformType the type of the uniform to be added
@@ -0,0 +1,131 @@
+#include "ShaderVariants.h"
+
+#include "imgui/imgui.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+ShaderVariants::ShaderVariants(const std::vector<ShaderStage>& stages, const std::vector<PermutationAxis>& axes, const std::vector<glsp::definition>& definitions)
+    : m_stages(stages), m_axes(axes), m_definitions(definitions)
+{
+    if (m_stages.empty())
+        throw std::runtime_error("ShaderVariants need at least one shader stage");
+
+    for (const auto& axis : m_axes)
+    {
+        if (axis.values.empty())
+            throw std::runtime_error("Permutation axis " + axis.name + " has no values");
+    }
+}
+
+ShaderProgram& ShaderVariants::get(const std::vector<int>& axisValues)
+{
+    const uint64_t key = makeKey(axisValues);
+    auto search = m_programs.find(key);
+    if (search == m_programs.end())
+    {
+        auto program = compile(axisValues);
+        for (const auto& registration : m_uniformRegistrations)
+            registration(*program);
+        search = m_programs.emplace(key, std::move(program)).first;
+    }
+    return *search->second;
+}
+
+void ShaderVariants::precompileAll()
+{
+    uint64_t variantCount = 1;
+    for (const auto& axis : m_axes)
+        variantCount *= axis.values.size();
+
+    for (uint64_t key = 0; key < variantCount; ++key)
+        get(makeValues(key));
+}
+
+void ShaderVariants::reload()
+{
+    m_programs.clear();
+}
+
+const std::vector<PermutationAxis>& ShaderVariants::getAxes() const
+{
+    return m_axes;
+}
+
+size_t ShaderVariants::getCompiledCount() const
+{
+    return m_programs.size();
+}
+
+void ShaderVariants::showReloadShaderGUIContent(std::string_view name)
+{
+    ImGui::Text("%s (%zu variants compiled)", name.data(), m_programs.size());
+    std::stringstream ss;
+    ss << "Reload: " << name.data();
+    if (ImGui::Button(ss.str().c_str()))
+    {
+        // compile everything that was in use before, keep the old programs if anything fails
+        std::unordered_map<uint64_t, std::unique_ptr<ShaderProgram>> reloaded;
+        try
+        {
+            for (const auto& program : m_programs)
+            {
+                auto newProgram = compile(makeValues(program.first));
+                for (const auto& registration : m_uniformRegistrations)
+                    registration(*newProgram);
+                reloaded.emplace(program.first, std::move(newProgram));
+            }
+            m_programs = std::move(reloaded);
+        }
+        catch (std::runtime_error& err)
+        {
+            std::cout << "Shader variants could not be reloaded, keeping the old ones" << std::endl;
+            std::cout << err.what() << std::endl;
+        }
+    }
+}
+
+uint64_t ShaderVariants::makeKey(const std::vector<int>& axisValues) const
+{
+    if (axisValues.size() != m_axes.size())
+        throw std::runtime_error("Number of axis values does not match the number of permutation axes");
+
+    // mixed-radix index of the value positions, first axis is the least significant digit
+    uint64_t key = 0;
+    uint64_t stride = 1;
+    for (size_t i = 0; i < m_axes.size(); ++i)
+    {
+        const auto& values = m_axes[i].values;
+        const auto pos = std::find(values.begin(), values.end(), axisValues[i]);
+        if (pos == values.end())
+            throw std::runtime_error("Value " + std::to_string(axisValues[i]) + " is not part of permutation axis " + m_axes[i].name);
+        key += stride * static_cast<uint64_t>(std::distance(values.begin(), pos));
+        stride *= values.size();
+    }
+    return key;
+}
+
+std::vector<int> ShaderVariants::makeValues(uint64_t key) const
+{
+    std::vector<int> axisValues(m_axes.size());
+    for (size_t i = 0; i < m_axes.size(); ++i)
+    {
+        axisValues[i] = m_axes[i].values[key % m_axes[i].values.size()];
+        key /= m_axes[i].values.size();
+    }
+    return axisValues;
+}
+
+std::unique_ptr<ShaderProgram> ShaderVariants::compile(const std::vector<int>& axisValues) const
+{
+    std::vector<glsp::definition> definitions = m_definitions;
+    for (size_t i = 0; i < m_axes.size(); ++i)
+        definitions.emplace_back(m_axes[i].name, axisValues[i]);
+
+    std::vector<Shader> shaders;
+    shaders.reserve(m_stages.size());
+    for (const auto& stage : m_stages)
+        shaders.emplace_back(stage.path, stage.type, definitions);
+
+    return std::make_unique<ShaderProgram>(shaders);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include "Shader.h"
+#include "ShaderProgram.h"
+#include "glshader/include/glsp/glsp.hpp"
+
+/**
+ * \brief one permutation axis of a ShaderVariants set, becomes a #define in every stage
+ */
+struct PermutationAxis
+{
+    std::string name;           // definition name used in the shader, e.g. "BUMP_TYPE"
+    std::vector<int> values;    // all values this axis can take
+};
+
+/**
+ * \brief a shader stage of a ShaderVariants set
+ */
+struct ShaderStage
+{
+    std::experimental::filesystem::path path;
+    GLenum type;
+};
+
+/**
+ * \brief set of programs compiled from the same sources with different compile-time definitions.
+ * Values that are constant per draw (material type, debug mode, draw mode) are baked into the
+ * shader instead of being branched on at runtime. Variants are compiled on first use and cached.
+ */
+class ShaderVariants
+{
+public:
+    ShaderVariants(const std::vector<ShaderStage>& stages, const std::vector<PermutationAxis>& axes, const std::vector<glsp::definition>& definitions = {});
+
+    /**
+     * \brief returns the program for the given axis values, compiles it if it does not exist yet
+     * \param axisValues one value per axis, in the order the axes were declared
+     * \return the program of this variant
+     */
+    ShaderProgram& get(const std::vector<int>& axisValues);
+
+    /**
+     * \brief compiles every combination of axis values ahead of time to avoid hitches on first use
+     */
+    void precompileAll();
+
+    /**
+     * \brief registers an uniform with all existing and all future variants.
+     * Variants in which the uniform was optimized out are skipped.
+     * \tparam UniformType the type of the uniform to be added
+     * \param uniform the uniform itself
+     */
+    template <typename UniformType>
+    void addUniform(std::shared_ptr<Uniform<UniformType>> uniform);
+
+    /**
+     * \brief drops all compiled variants, they will be recompiled from the current sources on next use
+     */
+    void reload();
+
+    /**
+     * \brief returns the axes of this variant set
+     */
+    const std::vector<PermutationAxis>& getAxes() const;
+
+    /**
+     * \brief returns the number of variants that have been compiled so far
+     */
+    size_t getCompiledCount() const;
+
+    /**
+     * \brief returns "reload shaders" gui content to use with imgui
+     * \param name debug name in the GUI
+     */
+    void showReloadShaderGUIContent(std::string_view name = "Generic ShaderVariants");
+
+private:
+    uint64_t makeKey(const std::vector<int>& axisValues) const;
+    std::vector<int> makeValues(uint64_t key) const;
+    std::unique_ptr<ShaderProgram> compile(const std::vector<int>& axisValues) const;
+
+    std::vector<ShaderStage> m_stages;
+    std::vector<PermutationAxis> m_axes;
+    std::vector<glsp::definition> m_definitions;
+
+    std::unordered_map<uint64_t, std::unique_ptr<ShaderProgram>> m_programs;
+    std::vector<std::function<void(ShaderProgram&)>> m_uniformRegistrations;
+};
+
+template <typename UniformType>
+void ShaderVariants::addUniform(std::shared_ptr<Uniform<UniformType>> uniform)
+{
+    auto registration = [uniform](ShaderProgram& sp)
+    {
+        try
+        {
+            sp.addUniform(uniform);
+        }
+        catch (std::runtime_error&)
+        {
+            // not every variant uses every uniform
+        }
+    };
+
+    for (auto& program : m_programs)
+        registration(*program.second);
+
+    m_uniformRegistrations.push_back(registration);
+}
@@ -0,0 +1,256 @@
+#include "ShaderWatcher.h"
+
+#include <iostream>
+#include <optional>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "imgui/imgui.h"
+#include "Utils/Tracer.h"
+
+ShaderWatcher::ShaderWatcher() : m_running(true)
+{
+#ifdef __linux__
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0)
+    {
+        throw std::runtime_error("Error creating inotify instance for the shader watcher.");
+    }
+    m_watchThread = std::thread(&ShaderWatcher::watchLoop, this);
+#else
+    std::cout << "WARNING: Shader hot-reload is only supported on linux" << std::endl;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    m_running = false;
+    if (m_watchThread.joinable())
+        m_watchThread.join();
+#ifdef __linux__
+    if (m_inotifyFd >= 0)
+        close(m_inotifyFd);
+#endif
+}
+
+void ShaderWatcher::watch(ShaderProgram& program)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& shaderPair : program.getShaders())
+    {
+        const size_t id = m_nextID++;
+        m_shaders.emplace(id, WatchedShader{ &program, shaderPair.second });
+        setDependencies(id, shaderPair.second.getDependencies());
+    }
+}
+
+void ShaderWatcher::unwatch(const ShaderProgram& program)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_shaders.begin(); it != m_shaders.end();)
+    {
+        if (it->second.program == &program)
+        {
+            const size_t id = it->first;
+            removeDependencies(id);
+            m_reloadedShaders.erase(std::remove_if(m_reloadedShaders.begin(), m_reloadedShaders.end(),
+                [id](const ReloadedShader& r) { return r.id == id; }), m_reloadedShaders.end());
+            it = m_shaders.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void ShaderWatcher::swapReloadedShaders()
+{
+    TRACE_SCOPE("ShaderWatcher::swapReloadedShaders");
+    std::vector<ReloadedShader> reloadedShaders;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        reloadedShaders.swap(m_reloadedShaders);
+    }
+
+    for (const auto& reloaded : reloadedShaders)
+    {
+        ShaderProgram* program;
+        std::optional<Shader> oldShader;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto search = m_shaders.find(reloaded.id);
+            if (search == m_shaders.end())
+                continue;
+            program = search->second.program;
+            oldShader = search->second.shader;
+        }
+
+        try
+        {
+            // compile into a new shader object, the old one stays attached if anything fails
+            const Shader newShader = oldShader->createFromSource(reloaded.file);
+            const GLuint replacedHandle = program->getShaders().at(newShader.getShaderType()).getHandle();
+            try
+            {
+                program->reloadShader(newShader);
+            }
+            catch (std::runtime_error&)
+            {
+                glDeleteShader(newShader.getHandle());
+                throw;
+            }
+            // the relinked program does not need the replaced object anymore
+            glDeleteShader(replacedHandle);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shaders.at(reloaded.id).shader = newShader;
+            m_lastLatencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - reloaded.changeTime).count();
+            m_reloadCount++;
+        }
+        catch (std::runtime_error& err)
+        {
+            std::cout << "Shader could not be reloaded, keeping the old one" << std::endl;
+            std::cout << err.what() << std::endl;
+            m_failCount++;
+        }
+    }
+}
+
+void ShaderWatcher::showGUIContent() const
+{
+    ImGui::Text("Shader hot-reload: %d reloaded, %d failed", m_reloadCount, m_failCount);
+    ImGui::Text("Last change to swap: %.1f ms", m_lastLatencyMs);
+}
+
+void ShaderWatcher::watchLoop()
+{
+#ifdef __linux__
+    Tracer::setThreadName("Shader watcher");
+
+    // inotify is not recursive, so every directory gets its own watch
+    std::unordered_map<int, std::experimental::filesystem::path> watchedDirectories;
+    const auto addDirectory = [this, &watchedDirectories](const std::experimental::filesystem::path& directory)
+    {
+        const int wd = inotify_add_watch(m_inotifyFd, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0)
+            watchedDirectories.emplace(wd, directory);
+        else
+            std::cout << "WARNING: Could not watch shader directory " << directory << std::endl;
+    };
+    addDirectory(util::gs_shaderPath);
+    for (const auto& entry : std::experimental::filesystem::recursive_directory_iterator(util::gs_shaderPath))
+    {
+        if (std::experimental::filesystem::is_directory(entry.status()))
+            addDirectory(entry.path());
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    std::set<std::string> changedFiles;
+    std::chrono::steady_clock::time_point changeTime;
+
+    while (m_running)
+    {
+        // idle with a long timeout, but only wait a few ms for the rest of an editor's save burst
+        pollfd pfd{ m_inotifyFd, POLLIN, 0 };
+        const int timeoutMs = changedFiles.empty() ? 100 : 10;
+        if (poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN))
+        {
+            const ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                const auto directory = watchedDirectories.find(event->wd);
+                if (event->len > 0 && directory != watchedDirectories.end())
+                {
+                    if (changedFiles.empty())
+                        changeTime = std::chrono::steady_clock::now();
+                    changedFiles.insert(normalizePath(directory->second / event->name));
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+        else if (!changedFiles.empty())
+        {
+            reloadChangedFiles(changedFiles, changeTime);
+            changedFiles.clear();
+        }
+    }
+#endif
+}
+
+void ShaderWatcher::reloadChangedFiles(const std::set<std::string>& changedFiles, std::chrono::steady_clock::time_point changeTime)
+{
+    TRACE_SCOPE("ShaderWatcher::reloadChangedFiles");
+    // collect all shaders that include one of the changed files
+    std::vector<std::pair<size_t, Shader>> affectedShaders;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::set<size_t> ids;
+        for (const auto& file : changedFiles)
+        {
+            if (const auto search = m_dependents.find(file); search != m_dependents.end())
+                ids.insert(search->second.begin(), search->second.end());
+        }
+        for (const size_t id : ids)
+            affectedShaders.emplace_back(id, m_shaders.at(id).shader);
+    }
+
+    // preprocess without holding the lock, the render thread only has to compile
+    for (const auto& [id, shader] : affectedShaders)
+    {
+        glsp::processed_file file;
+        try
+        {
+            file = shader.preprocess();
+        }
+        catch (std::exception& err)
+        {
+            std::cout << "Shader could not be preprocessed" << std::endl;
+            std::cout << err.what() << std::endl;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_shaders.count(id) == 0)
+            continue;
+
+        // includes might have changed
+        std::set<std::experimental::filesystem::path> dependencies = file.dependencies;
+        dependencies.insert(file.file_path);
+        setDependencies(id, dependencies);
+
+        m_reloadedShaders.push_back({ id, std::move(file), changeTime });
+    }
+}
+
+void ShaderWatcher::setDependencies(size_t id, const std::set<std::experimental::filesystem::path>& dependencies)
+{
+    removeDependencies(id);
+    for (const auto& dependency : dependencies)
+        m_dependents[normalizePath(dependency)].insert(id);
+}
+
+void ShaderWatcher::removeDependencies(size_t id)
+{
+    for (auto it = m_dependents.begin(); it != m_dependents.end();)
+    {
+        it->second.erase(id);
+        if (it->second.empty())
+            it = m_dependents.erase(it);
+        else
+            ++it;
+    }
+}
+
+std::string ShaderWatcher::normalizePath(const std::experimental::filesystem::path& path)
+{
+    std::error_code ec;
+    const auto canonicalPath = std::experimental::filesystem::canonical(path, ec);
+    return ec ? path.string() : canonicalPath.string();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderProgram.h"
+
+/**
+ * \brief watches the shader directory and reloads shaders when one of their files changes.
+ * Changed files are mapped to the shaders that include them, those are preprocessed on a worker thread.
+ * Compiling and swapping happens in swapReloadedShaders(), which has to be called on the render thread.
+ * File watching is only available on linux (inotify), on other platforms nothing gets reloaded.
+ */
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    /**
+     * \brief watches all shaders of a program, the program has to outlive the watcher or be unwatched
+     * \param program the program to be reloaded on changes
+     */
+    void watch(ShaderProgram& program);
+
+    /**
+     * \brief stops watching a program
+     * \param program a previously watched program
+     */
+    void unwatch(const ShaderProgram& program);
+
+    /**
+     * \brief compiles all shaders that were preprocessed since the last call and swaps them into their programs.
+     * Call this at a frame boundary on the render thread
+     */
+    void swapReloadedShaders();
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    void showGUIContent() const;
+
+private:
+    struct WatchedShader
+    {
+        ShaderProgram* program;
+        Shader shader;
+    };
+
+    struct ReloadedShader
+    {
+        size_t id;
+        glsp::processed_file file;
+        std::chrono::steady_clock::time_point changeTime;
+    };
+
+    void watchLoop();
+    void reloadChangedFiles(const std::set<std::string>& changedFiles, std::chrono::steady_clock::time_point changeTime);
+    void setDependencies(size_t id, const std::set<std::experimental::filesystem::path>& dependencies);
+    void removeDependencies(size_t id);
+
+    static std::string normalizePath(const std::experimental::filesystem::path& path);
+
+    std::mutex m_mutex;
+    std::unordered_map<size_t, WatchedShader> m_shaders;
+    std::unordered_map<std::string, std::set<size_t>> m_dependents; // file -> shaders that include it
+    std::vector<ReloadedShader> m_reloadedShaders;
+    size_t m_nextID = 0;
+
+    int m_inotifyFd = -1;
+    std::atomic<bool> m_running;
+    std::thread m_watchThread;
+
+    float m_lastLatencyMs = 0.0f;
+    int m_reloadCount = 0;
+    int m_failCount = 0;
+};
@@ -1,33 +1,57 @@
 #include "SparseVoxelOctree.h"
+#include "FrameBuffer.h"
+#include "Quad.h"
+#include "Texture.h"
+#include "Utils/GLStateCache.h"
+#include "Utils/GPUProfiler.h"
+#include "Utils/Tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
 
 #include <glm/gtx/component_wise.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-SparseVoxelOctree::SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& scene, const size_t depth)
-    : m_N(static_cast<size_t>(glm::pow(2, depth))), m_depth(depth), m_scene(scene)
+namespace
 {
+    // 65535 work groups per dimension are guaranteed, larger dispatches are wrapped into rows.
+    // The shaders index with gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x and skip the rest of the last row
+    void dispatchComputeWrapped(size_t workGroups)
+    {
+        const size_t rowSize = std::min<size_t>(std::max<size_t>(workGroups, 1), 65535);
+        glDispatchCompute(static_cast<GLuint>(rowSize), static_cast<GLuint>((workGroups + rowSize - 1) / rowSize), 1);
+    }
+}
+
+SparseVoxelOctree::SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& scene, const size_t depth, BuildMode mode, Voxelizer voxelizer)
+    : m_N(static_cast<size_t>(glm::pow(2, depth))), m_depth(depth), m_buildMode(mode), m_scene(scene)
+{
+    // the raster voxelization relies on conservative rasterization, without it the compute voxelizer is used
+    const auto extensions = util::getGLExtenstions();
+    m_conservativeRaster = std::find(extensions.begin(), extensions.end(), "GL_NV_conservative_raster") != extensions.end();
+    if (m_buildMode == BuildMode::automatic)
+        m_buildMode = BuildMode::gpu;
+    if (voxelizer == Voxelizer::automatic)
+    {
+        voxelizer = m_conservativeRaster ? Voxelizer::raster : Voxelizer::compute;
+        if (!m_conservativeRaster && m_buildMode == BuildMode::gpu)
+            std::cout << "GL_NV_conservative_raster not available, voxelizing with compute shaders\n";
+    }
+    setVoxelizer(voxelizer);
 
     ////////////////////////////////////////////////////////////////////////////////////
     // Init buffers, textures, atomic counters, etc.
+    // the fragment list and the node pool start small, the first update counts the fragments and nodes and grows them
 
-    size_t triCount = 0;
-    std::for_each(scene.begin(), scene.end(), [&triCount](auto& mesh) {triCount += mesh->getIndices().size(); });
-    triCount /= 3;
-
-    //clear voxel fragment list
-    m_voxelFragmentList.setStorage(std::vector<glm::vec4>(triCount * 4, glm::vec4(0.f)), GL_DYNAMIC_STORAGE_BIT);
-
-    //clear voxel color list
-    m_voxelFragmentColor.setStorage(std::vector<glm::vec4>(triCount * 4, glm::vec4(0.f)), GL_DYNAMIC_STORAGE_BIT);
-
-    const int powN3 = static_cast<int>(std::pow(m_N, 3));
-    //clear node pool
-    m_nodePool.setStorage(std::vector<GLint>(powN3, -1), GL_DYNAMIC_STORAGE_BIT);
-
-    //clear node colors
-    m_nodeColor.setStorage(std::vector<glm::vec4>(powN3 * 2, glm::vec4(0.f)), GL_DYNAMIC_STORAGE_BIT);
+    allocateVoxelFragments(64);
+    reserveNodes(64);
+    reserveNodeData(64);
 
     //clear voxel counter
     m_voxelCounter.setStorage(std::vector<GLuint>{ 0u }, GL_DYNAMIC_STORAGE_BIT);
@@ -35,6 +59,18 @@ SparseVoxelOctree::SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& s
     //clear node counter
     m_nodeCounter.setStorage(std::vector<GLuint>{ 1u }, GL_DYNAMIC_STORAGE_BIT);
 
+    //level 1 always is the single group of children of the root, the other levels are written by PrepareIndirect.comp
+    std::vector<glm::uvec4> levelArgs(m_depth + 1, glm::uvec4(0u, 1u, 1u, 0u));
+    levelArgs[1] = glm::uvec4(1u, 1u, 1u, 8u);
+    m_levelArgs.setStorage(levelArgs, GL_DYNAMIC_STORAGE_BIT);
+
+    m_fragmentRanges.setStorage(std::vector<glm::uvec2>(scene.size() + 2, glm::uvec2(0u)), GL_DYNAMIC_STORAGE_BIT);
+
+    m_voxelizeTileArgs.setStorage(std::vector<glm::uvec4>{ glm::uvec4(0u, 1u, 1u, 0u) }, GL_DYNAMIC_STORAGE_BIT);
+
+    m_counterReadback.setStorageWithoutData<GLuint>(2, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+    m_counters = m_counterReadback.mapBufferContent<GLuint>(2 * sizeof(GLuint), 0, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+
     m_bmin = glm::vec3(std::numeric_limits<float>::max());
     m_bmax = glm::vec3(std::numeric_limits<float>::lowest());
     std::for_each(scene.begin(), scene.end(), [&](auto& mesh)
@@ -61,157 +97,837 @@ SparseVoxelOctree::SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& s
 
     const auto u_res = std::make_shared<Uniform<glm::uvec3>>("res", glm::uvec3(m_N, m_N, m_N));
     m_voxelGenShader.addUniform(u_res);
+    m_voxelizeTrianglesShader.addUniform(u_res);
+    m_voxelizeTilesShader.addUniform(u_res);
+
+    m_levelUniform = std::make_shared<Uniform<int>>("level", 0);
+    m_nodeCreationShader.addUniform(m_levelUniform);
+    m_mipMapShader.addUniform(m_levelUniform);
+    m_prepareIndirectShader.addUniform(m_levelUniform);
+    m_flagShader.addUniform(m_levelUniform);
+    m_fragmentNodeCreationShader.addUniform(m_levelUniform);
+    m_fragmentMipMapShader.addUniform(m_levelUniform);
 
-    m_startIndexUniform = std::make_shared<Uniform<int>>("startIndex", 0);
-    m_nodeCreationShader.addUniform(m_startIndexUniform);
-    m_mipMapShader.addUniform(m_startIndexUniform);
+    m_meshUniform = std::make_shared<Uniform<int>>("mesh", s_allFragments);
+    m_prepareIndirectShader.addUniform(m_meshUniform);
 
     m_modelMatrixUniform = std::make_shared<Uniform<glm::mat4>>("modelMatrix", glm::mat4(1.0f));
     m_voxelGenShader.addUniform(m_modelMatrixUniform);
 
+    m_voxelMatrixUniform = std::make_shared<Uniform<glm::mat4>>("voxelMatrix", glm::mat4(1.0f));
+    m_voxelizeTrianglesShader.addUniform(m_voxelMatrixUniform);
+    m_voxelizeTilesShader.addUniform(m_voxelMatrixUniform);
+
+    m_albedoUniform = std::make_shared<Uniform<glm::vec3>>("albedo", glm::vec3(1.0f));
+    m_voxelGenShader.addUniform(m_albedoUniform);
+    m_voxelizeTrianglesShader.addUniform(m_albedoUniform);
+    m_voxelizeTilesShader.addUniform(m_albedoUniform);
+
     ///////////////////////////////////////////////////////////////////////////////////
     update();
     ///////////////////////////////////////////////////////////////////////////////////
 }
 
+SparseVoxelOctree::SparseVoxelOctree(const std::experimental::filesystem::path& file)
+    : m_buildMode(BuildMode::loaded)
+{
+    TRACE_SCOPE("SparseVoxelOctree::load");
+    const SparseVoxelOctreeFile octreeFile(file);
+    const SparseVoxelOctreeFileHeader& header = octreeFile.getHeader();
+    m_depth = header.depth;
+    m_N = int64_t(1) << m_depth;
+    m_bmin = header.bmin;
+    m_bmax = header.bmax;
+    m_levelStartIndices = octreeFile.getLevelStartIndices();
+
+    // a loaded octree does not change, so the buffers get no headroom
+    reserveNodes(header.nodeCount, 1.0f);
+    reserveNodeData(header.nodeCount);
+    streamUpload(octreeFile);
+}
+
+SparseVoxelOctree::~SparseVoxelOctree()
+{
+    if (m_counterFence && glfwGetCurrentContext() != nullptr)
+        glDeleteSync(m_counterFence);
+}
+
 void SparseVoxelOctree::bind() const
 {
-    m_nodePool.bindBase(static_cast<BufferBindings::Binding>(2));
-    m_nodeColor.bindBase(static_cast<BufferBindings::Binding>(3));
+    m_nodePool->bindBase(static_cast<BufferBindings::Binding>(2));
+    m_nodeColor->bindBase(static_cast<BufferBindings::Binding>(3));
 }
 
 void SparseVoxelOctree::update()
 {
-    double t1 = 0.f;
-    GLuint voxelCount, nodeCount;
+    TRACE_SCOPE("SparseVoxelOctree::update");
+    if (m_buildMode == BuildMode::loaded)
+        throw std::runtime_error("Octrees loaded from a file can not be updated");
+    if (m_buildMode == BuildMode::cpu)
+        updateCPU();
+    else
+        updateGPU();
+    if (m_brickPoolEnabled)
+        updateBricks();
+}
+
+void SparseVoxelOctree::update(const std::vector<std::shared_ptr<Mesh>>& changedMeshes)
+{
+    TRACE_SCOPE("SparseVoxelOctree::update");
+    if (m_buildMode == BuildMode::loaded)
+        throw std::runtime_error("Octrees loaded from a file can not be updated");
+    std::vector<size_t> meshes;
+    for (const auto& mesh : changedMeshes)
+    {
+        const auto search = std::find(m_scene.begin(), m_scene.end(), mesh);
+        if (search == m_scene.end())
+            throw std::runtime_error("Changed mesh is not part of the octree scene");
+        meshes.push_back(static_cast<size_t>(search - m_scene.begin()));
+    }
+
+    // the CPU builder has no incremental mode, a DAG can not be updated in place, and the buffers only grow with full builds
+    if (m_buildMode == BuildMode::cpu)
+        updateCPU();
+    else if (m_compressed || growToFit(false))
+        updateGPU();
+    else if (!meshes.empty())
+        updateMeshesGPU(meshes);
+    if (m_brickPoolEnabled)
+        updateBricks();
+}
+
+SparseVoxelOctree::BuildMode SparseVoxelOctree::getBuildMode() const
+{
+    return m_buildMode;
+}
+
+void SparseVoxelOctree::setVoxelizer(Voxelizer voxelizer)
+{
+    if (voxelizer == Voxelizer::raster && !m_conservativeRaster)
+        throw std::runtime_error("The raster voxelizer needs GL_NV_conservative_raster");
+    m_voxelizer = voxelizer == Voxelizer::automatic ? (m_conservativeRaster ? Voxelizer::raster : Voxelizer::compute) : voxelizer;
+}
+
+SparseVoxelOctree::Voxelizer SparseVoxelOctree::getVoxelizer() const
+{
+    return m_voxelizer;
+}
+
+void SparseVoxelOctree::updateCPU()
+{
+    const SparseVoxelOctreeBuilder builder(m_bmin, m_bmax, m_depth);
+    const SparseVoxelOctreeData octree = builder.build(m_scene);
+
+    GPUProfiler::beginScope("upload");
+    reserveNodes(octree.nodePool.size());
+    reserveNodeData(octree.nodeColor.size());
+    // clear the nodes of the previous tree that are not overwritten
+    if (!m_levelStartIndices.empty() && static_cast<size_t>(m_levelStartIndices.back()) > octree.nodePool.size())
+    {
+        const size_t offset = octree.nodePool.size();
+        const size_t count = std::min<size_t>(m_levelStartIndices.back(), m_nodeCapacity) - offset;
+        const GLuint clear_val_color = 0u;
+        const GLint clear_val = -1;
+        glClearNamedBufferSubData(m_nodeColor->getHandle(), GL_R32UI, offset * sizeof(GLuint), count * sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_color);
+        glClearNamedBufferSubData(m_nodePool->getHandle(), GL_R32I, offset * sizeof(GLint), count * sizeof(GLint), GL_RED_INTEGER, GL_INT, &clear_val);
+    }
+    m_nodePool->setContentToContainerSubData(octree.nodePool, 0);
+    m_nodeColor->setContentToContainerSubData(octree.nodeColor, 0);
+    const GLuint nodeCount = static_cast<GLuint>(octree.nodePool.size() / 8 - 1);
+    m_nodeCounter.setContentSubData(nodeCount, 0);
+    GPUProfiler::endScope();
+
+    m_levelStartIndices = octree.levelStartIndices;
+    m_compressed = false;
+    if constexpr(util::debugmode) std::cout << octree.nodePool.size() << " Nodes \n";
+}
+
+void SparseVoxelOctree::updateGPU()
+{
+    // the counters of the previous update are usually ready by now, so checking them does not stall
+    growToFit(false);
+    buildGPU();
+    m_compressed = false;
+
+    // the first build has nothing to size the buffers by, wait for it and repeat until everything fits
+    if (!m_capacityKnown)
+    {
+        while (growToFit(true))
+            buildGPU();
+        m_capacityKnown = true;
+    }
+
+    if constexpr(util::debugmode) {
+        GLuint voxelCount, nodeCount;
+        GLuint packedRootNodeColor;
+        glGetNamedBufferSubData(m_voxelCounter.getHandle(), 0, 4, &voxelCount);
+        glGetNamedBufferSubData(m_nodeCounter.getHandle(), 0, 4, &nodeCount);
+        glGetNamedBufferSubData(m_nodeColor->getHandle(), 0, 4, &packedRootNodeColor);
+        const glm::vec4 rootNodeColor = SparseVoxelOctreeBuilder::unpackColor(packedRootNodeColor);
+        std::cout << voxelCount << " filled Voxels \n";
+        std::cout << nodeCount * 8 << " Nodes \n";
+        std::cout << "Root color: (" << rootNodeColor.x << ", " << rootNodeColor.y << ", " << rootNodeColor.z << ", " << rootNodeColor.w << ") \n";
+    }
+}
 
+void SparseVoxelOctree::buildGPU()
+{
     ////////////////////////////////////////////////////////////////////////////////////
     // clear and bind buffers, textures, atomic counters, etc.
 
-    if constexpr(util::debugmode) { glFinish(); t1 = glfwGetTime(); }
+    GPUProfiler::beginScope("buffer clearing");
 
-    //bind Buffers
-    m_voxelFragmentList.bindBase(static_cast<BufferBindings::Binding>(0));
-    m_voxelFragmentColor.bindBase(static_cast<BufferBindings::Binding>(1));
-    m_nodePool.bindBase(static_cast<BufferBindings::Binding>(2));
-    m_nodeColor.bindBase(static_cast<BufferBindings::Binding>(3));
-    m_voxelCounter.bindBase(static_cast<BufferBindings::Binding>(0));
-    m_nodeCounter.bindBase(static_cast<BufferBindings::Binding>(1));
-
-    //clear SSBOs
-    glGetNamedBufferSubData(m_voxelCounter.getHandle(), 0, 4, &voxelCount);
-    glGetNamedBufferSubData(m_nodeCounter.getHandle(), 0, 4, &nodeCount);
+    bindBuffers();
 
+    //clear SSBOs, the sizes of the previous octree are only known on the GPU, so the whole buffers are cleared
     glm::vec4 zero_vec = glm::vec4(0.f); 
     const GLint clear_val = -1;
-    glClearNamedBufferSubData(m_voxelFragmentList.getHandle(), GL_RGBA32F, 0, (voxelCount+1) * 16 /*4 * 4*/, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
-    glClearNamedBufferSubData(m_voxelFragmentColor.getHandle(), GL_RGBA32F, 0, (voxelCount+1) * 16 /*4 * 4*/, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
-    glClearNamedBufferSubData(m_nodeColor.getHandle(), GL_RGBA32F, 0, (nodeCount+1) * 128 /*8 * 4 * 4*/, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
-    glClearNamedBufferSubData(m_nodePool.getHandle(), GL_R32I, 0, (nodeCount+1) * 32 /*8 * 4*/, GL_RED_INTEGER, GL_INT, &clear_val);
-
-    //clear atomic counters
-    GLuint clear_val_atomic = 0u;
-    glClearNamedBufferSubData(m_voxelCounter.getHandle(), GL_R32UI, 0, 4, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_atomic);
-    clear_val_atomic = 1u;
+    glClearNamedBufferData(m_voxelFragmentList->getHandle(), GL_RGBA32F, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
+    glClearNamedBufferData(m_voxelFragmentColor->getHandle(), GL_RGBA32F, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
+    const GLuint clear_val_color = 0u;
+    glClearNamedBufferData(m_nodeColor->getHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_color);
+    glClearNamedBufferData(m_nodePool->getHandle(), GL_R32I, GL_RED_INTEGER, GL_INT, &clear_val);
+    const GLint clear_val_count = 0;
+    glClearNamedBufferData(m_leafCount->getHandle(), GL_R32I, GL_RED_INTEGER, GL_INT, &clear_val_count);
+
+    //clear voxel counter, the fragments are appended from the start
+    const GLuint clear_val_voxels = 0u;
+    glClearNamedBufferSubData(m_voxelCounter.getHandle(), GL_R32UI, 0, 4, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_voxels);
+
+    //clear node counter
+    const GLuint clear_val_atomic = 1u;
     glClearNamedBufferSubData(m_nodeCounter.getHandle(), GL_R32UI, 0, 4, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_atomic);
 
     //set octree root value
     const GLint root_val = 8;
-    m_nodePool.setContentSubData(root_val, 0);
+    m_nodePool->setContentSubData(root_val, 0);
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
 
-    if constexpr(util::debugmode) { glFinish(); std::cout << "Buffer clearing took: " << (glfwGetTime() - t1) * 1000 << "ms \n"; }
+    GPUProfiler::endScope();
 
     ////////////////////////////////////////////////////////////////////////////////////
     // Voxelization into uniform grid, i.e. creation of voxel fragment list
 
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_CONSERVATIVE_RASTERIZATION_NV);
-    const float Nf = static_cast<float>(m_N);
-    glViewportIndexedf(1, 0.0f, 0.0f, Nf, Nf);
-    glViewportIndexedf(2, 0.0f, 0.0f, Nf, Nf);
-    glViewportIndexedf(3, 0.0f, 0.0f, Nf, Nf);
-
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    m_voxelGenShader.use();
-    if constexpr(util::debugmode) { glFinish(); t1 = glfwGetTime(); }
-    std::for_each(m_scene.begin(), m_scene.end(), [&](auto& mesh)
-    {
-        m_modelMatrixUniform->setContent(mesh->getModelMatrix());
-        m_voxelGenShader.updateUniforms();
-        mesh->draw();
-    });
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
-    if constexpr(util::debugmode) {glFinish(); std::cout << "Voxelization took: " << (glfwGetTime() - t1) * 1000 << "ms \n";}
-
-    glDisable(GL_CONSERVATIVE_RASTERIZATION_NV);
-
-    glGetNamedBufferSubData(m_voxelCounter.getHandle(), 0, 4, &voxelCount);
-    if constexpr(util::debugmode) std::cout << voxelCount << " filled Voxels \n";
+    GPUProfiler::beginScope("voxelization");
+    std::vector<size_t> meshes(m_scene.size());
+    std::iota(meshes.begin(), meshes.end(), 0);
+    voxelize(meshes);
+    prepareFragmentDispatch(s_allFragments);
+    GPUProfiler::endScope();
 
     ///////////////////////////////////////////////////////////////////////////////////
     // Octree generation
+    // the number of nodes per level stays on the GPU, PrepareIndirect.comp writes the dispatch size of the next level
 
-    std::vector<int> levelStartIndices;
-    levelStartIndices.push_back(8);
-    if constexpr(util::debugmode) { glFinish(); t1 = glfwGetTime(); }
+    GPUProfiler::beginScope("tree building");
     for (int i = 1; i < m_depth; ++i) {
+        m_levelUniform->setContent(i);
         m_flagShader.use();
-        glDispatchCompute(static_cast<GLuint>(glm::ceil(voxelCount / 64.f)), 1, 1);
+        m_flagShader.updateUniforms();
+        glDispatchComputeIndirect(0);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-        glGetNamedBufferSubData(m_nodeCounter.getHandle(), 0, 4, &nodeCount);
-        levelStartIndices.push_back(int((nodeCount + 1) * 8));
-        m_startIndexUniform->setContent(levelStartIndices[i - 1]);
         m_nodeCreationShader.use();
-        glDispatchCompute(static_cast<GLuint>(glm::pow(8, i - 1)), 1, 1);
+        m_nodeCreationShader.updateUniforms();
+        glDispatchComputeIndirect(i * sizeof(glm::uvec4));
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
-    }
-    glGetNamedBufferSubData(m_nodeCounter.getHandle(), 0, 4, &nodeCount);
-    levelStartIndices.push_back(int((nodeCount + 1) * 8));
-    if constexpr(util::debugmode) {
-        glFinish();
-        std::cout << "Tree building took: " << (glfwGetTime() - t1) * 1000 << "ms \n";
 
-        std::cout << nodeCount * 8 << " Nodes \n";
+        m_prepareIndirectShader.use();
+        m_prepareIndirectShader.updateUniforms();
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
     }
+    GPUProfiler::endScope();
 
     ///////////////////////////////////////////////////////////////////////////////////
     // Initialization of leaf node data
 
-    if constexpr(util::debugmode) { glFinish(); t1 = glfwGetTime(); }
+    GPUProfiler::beginScope("leaf initialization");
     m_leafInitShader.use();
-    glDispatchCompute(static_cast<GLuint>(glm::ceil(voxelCount / 64.f)), 1, 1);
+    glDispatchComputeIndirect(0);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    if constexpr(util::debugmode) { glFinish(); std::cout << "Leaf initialization took: " << (glfwGetTime() - t1) * 1000 << "ms \n"; }
+    GPUProfiler::endScope();
 
     ///////////////////////////////////////////////////////////////////////////////////
     // Mipmap values
 
-    if constexpr(util::debugmode) { glFinish(); t1 = glfwGetTime(); }
+    GPUProfiler::beginScope("mipmapping");
     m_mipMapShader.use();
-    for (int64_t i = m_depth - 2; i >= 0; --i) {
-        m_startIndexUniform->setContent(levelStartIndices[i]);
+    for (int64_t i = m_depth - 1; i >= 1; --i) {
+        m_levelUniform->setContent(static_cast<int>(i));
         m_mipMapShader.updateUniforms();
-        glDispatchCompute((levelStartIndices[i + 1] - levelStartIndices[i]) / 8, 1, 1);
+        glDispatchComputeIndirect(i * sizeof(glm::uvec4));
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
     }
-    m_startIndexUniform->setContent(0);
+    m_levelUniform->setContent(0);
     m_mipMapShader.updateUniforms();
     glDispatchCompute(1, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    if constexpr(util::debugmode) {
-        glFinish();
-        std::cout << "Mipmapping values took: " << (glfwGetTime() - t1) * 1000 << "ms \n";
+    GPUProfiler::endScope();
 
-        glm::vec4 rootNodeColor;
-        glGetNamedBufferSubData(m_nodeColor.getHandle(), 0, 4 * 4, &rootNodeColor);
-        std::cout << "Root color: (" << rootNodeColor.x << ", " << rootNodeColor.y << ", " << rootNodeColor.z << ", " << rootNodeColor.w << ") \n";
+    fenceCounters(true);
+}
+
+void SparseVoxelOctree::updateMeshesGPU(const std::vector<size_t>& meshes)
+{
+    bindBuffers();
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Removal of the old voxels, their positions are appended behind the fragments of the last update
+
+    GPUProfiler::beginScope("voxel removal");
+    // everything appended from now on is removed or new
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(m_voxelCounter.getHandle(), m_fragmentRanges.getHandle(), 0, sizeof(glm::uvec2), sizeof(GLuint));
+    for (const size_t mesh : meshes)
+    {
+        prepareFragmentDispatch(static_cast<int>(mesh));
+        m_removeVoxelsShader.use();
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
     }
+    GPUProfiler::endScope();
+
+    GPUProfiler::beginScope("voxelization");
+    voxelize(meshes);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(m_voxelCounter.getHandle(), m_fragmentRanges.getHandle(), 0, sizeof(glm::uvec2) + sizeof(GLuint), sizeof(GLuint));
+    prepareFragmentDispatch(s_updatedFragments);
+    GPUProfiler::endScope();
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    // Insertion of the new voxels, only the nodes on their paths are visited
+
+    GPUProfiler::beginScope("tree building");
+    for (int i = 1; i < m_depth; ++i) {
+        m_levelUniform->setContent(i);
+        m_flagShader.use();
+        m_flagShader.updateUniforms();
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        m_fragmentNodeCreationShader.use();
+        m_fragmentNodeCreationShader.updateUniforms();
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+    }
+    GPUProfiler::endScope();
+
+    GPUProfiler::beginScope("leaf initialization");
+    m_leafInitShader.use();
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    GPUProfiler::endScope();
 
     ///////////////////////////////////////////////////////////////////////////////////
+    // Mipmap values on the paths of the removed and new voxels
+
+    GPUProfiler::beginScope("mipmapping");
+    m_fragmentMipMapShader.use();
+    for (int64_t i = m_depth - 1; i >= 0; --i) {
+        m_levelUniform->setContent(static_cast<int>(i));
+        m_fragmentMipMapShader.updateUniforms();
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    GPUProfiler::endScope();
+
+    fenceCounters(false);
+}
+
+void SparseVoxelOctree::bindBuffers() const
+{
+    m_voxelFragmentList->bindBase(static_cast<BufferBindings::Binding>(0));
+    m_voxelFragmentColor->bindBase(static_cast<BufferBindings::Binding>(1));
+    m_nodePool->bindBase(static_cast<BufferBindings::Binding>(2));
+    m_nodeColor->bindBase(static_cast<BufferBindings::Binding>(3));
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_levelArgs.getHandle());
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_fragmentRanges.getHandle());
+    m_leafCount->bindBase(static_cast<BufferBindings::Binding>(6));
+    GLStateCache::bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_levelArgs.getHandle());
+    m_voxelCounter.bindBase(static_cast<BufferBindings::Binding>(0));
+    m_nodeCounter.bindBase(static_cast<BufferBindings::Binding>(1));
+}
 
+void SparseVoxelOctree::voxelize(const std::vector<size_t>& meshes)
+{
+    const bool raster = m_voxelizer == Voxelizer::raster;
+    // VoxelGen.geom projects along the dominant axis regardless of the facing, so half of the triangles end up back facing
+    const bool depthTest = GLStateCache::isEnabled(GL_DEPTH_TEST);
+    const bool cullFace = GLStateCache::isEnabled(GL_CULL_FACE);
+    if (raster)
+    {
+        GLStateCache::disable(GL_DEPTH_TEST);
+        GLStateCache::disable(GL_CULL_FACE);
+        glEnable(GL_CONSERVATIVE_RASTERIZATION_NV);
+        const float Nf = static_cast<float>(m_N);
+        glViewportIndexedf(1, 0.0f, 0.0f, Nf, Nf);
+        glViewportIndexedf(2, 0.0f, 0.0f, Nf, Nf);
+        glViewportIndexedf(3, 0.0f, 0.0f, Nf, Nf);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    for (const size_t mesh : meshes)
+    {
+        // the counter before and after the mesh is the range of its fragments
+        const size_t rangeOffset = (mesh + 2) * sizeof(glm::uvec2);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glCopyNamedBufferSubData(m_voxelCounter.getHandle(), m_fragmentRanges.getHandle(), 0, rangeOffset, sizeof(GLuint));
+
+        if (raster)
+        {
+            m_voxelGenShader.use();
+            m_modelMatrixUniform->setContent(m_scene[mesh]->getModelMatrix());
+            m_albedoUniform->setContent(m_scene[mesh]->getAlbedo());
+            m_voxelGenShader.updateUniforms();
+            m_scene[mesh]->draw();
+        }
+        else
+            voxelizeCompute(*m_scene[mesh]);
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+        glCopyNamedBufferSubData(m_voxelCounter.getHandle(), m_fragmentRanges.getHandle(), 0, rangeOffset + sizeof(GLuint), sizeof(GLuint));
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+
+    if (raster)
+    {
+        glDisable(GL_CONSERVATIVE_RASTERIZATION_NV);
+        GLStateCache::setEnabled(GL_DEPTH_TEST, depthTest);
+        GLStateCache::setEnabled(GL_CULL_FACE, cullFace);
+    }
+}
+
+void SparseVoxelOctree::voxelizeCompute(const Mesh& mesh)
+{
+    if (!mesh.isEnabledForRendering())
+        return;
+
+    // voxel coordinates, the octree bounds map to [0, N]
+    const glm::vec3 scale = glm::vec3(static_cast<float>(m_N)) / (m_bmax - m_bmin);
+    m_voxelMatrixUniform->setContent(glm::scale(glm::mat4(1.0f), scale) * glm::translate(glm::mat4(1.0f), -m_bmin) * mesh.getModelMatrix());
+    m_albedoUniform->setContent(mesh.getAlbedo());
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(BufferBindings::Binding::voxelizeVertices), mesh.getVertexBuffer().getHandle());
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(BufferBindings::Binding::voxelizeIndices), mesh.getIndexBuffer().getHandle());
+    GLStateCache::bindBufferBase(GL_SHADER_STORAGE_BUFFER, static_cast<GLuint>(BufferBindings::Binding::voxelizeTileArgs), m_voxelizeTileArgs.getHandle());
+    m_voxelizeTiles->bindBase(BufferBindings::Binding::voxelizeTiles);
+
+    // no tiles yet
+    m_voxelizeTileArgs.setContentSubData(glm::uvec4(0u, 1u, 1u, 0u), 0);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    m_voxelizeTrianglesShader.use();
+    m_voxelizeTrianglesShader.updateUniforms();
+    dispatchComputeWrapped((mesh.getIndices().size() / 3 + 63) / 64);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_prepareVoxelizeTilesShader.use();
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // the tile count is only known on the GPU
+    GLStateCache::bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_voxelizeTileArgs.getHandle());
+    m_voxelizeTilesShader.use();
+    m_voxelizeTilesShader.updateUniforms();
+    glDispatchComputeIndirect(0);
+    GLStateCache::bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_levelArgs.getHandle());
+}
+
+void SparseVoxelOctree::prepareFragmentDispatch(int mesh)
+{
+    m_levelUniform->setContent(0);
+    m_meshUniform->setContent(mesh);
+    m_prepareIndirectShader.use();
+    m_prepareIndirectShader.updateUniforms();
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void SparseVoxelOctree::fenceCounters(bool fullBuild)
+{
+    // copy the counters for growToFit, they are read once the fence is signaled
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glCopyNamedBufferSubData(m_voxelCounter.getHandle(), m_counterReadback.getHandle(), 0, 0, sizeof(GLuint));
+    glCopyNamedBufferSubData(m_nodeCounter.getHandle(), m_counterReadback.getHandle(), 0, sizeof(GLuint), sizeof(GLuint));
+    if (m_counterFence)
+        glDeleteSync(m_counterFence);
+    m_counterFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, UnusedMask::GL_UNUSED_BIT);
+    m_countersFromFullBuild = fullBuild;
+}
+
+bool SparseVoxelOctree::growToFit(bool wait)
+{
+    if (!m_counterFence)
+        return false;
+
+    const GLuint64 timeout = wait ? std::numeric_limits<GLuint64>::max() : 0;
+    const GLenum result = glClientWaitSync(m_counterFence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+        return false;
+    glDeleteSync(m_counterFence);
+    m_counterFence = nullptr;
+
+    const size_t voxelCount = m_counters[0];
+    const size_t nodeCount = (static_cast<size_t>(m_counters[1]) + 1) * 8;
+    const bool overflow = voxelCount > m_voxelFragmentCapacity || nodeCount > m_nodeCapacity;
+
+    // incremental updates append removed voxels and leave emptied nodes behind,
+    // so their counters say nothing about the size of the scene and only call for a full build
+    if (!overflow || !m_countersFromFullBuild)
+        return overflow;
+
+    // the counters include what did not fit. Nodes below missing nodes were never counted,
+    // so the pool grows at least by half to need fewer builds until the whole tree fits
+    if (voxelCount > m_voxelFragmentCapacity)
+        allocateVoxelFragments(static_cast<size_t>(voxelCount * s_headroom));
+    if (nodeCount > m_nodeCapacity)
+    {
+        reserveNodes(std::max(nodeCount, m_nodeCapacity + m_nodeCapacity / 2));
+        reserveNodeData(m_nodeCapacity);
+    }
+    return true;
+}
+
+std::vector<int> SparseVoxelOctree::readLevelStartIndices() const
+{
+    std::vector<glm::uvec4> levelArgs(m_depth + 1);
+    glGetNamedBufferSubData(m_levelArgs.getHandle(), 0, levelArgs.size() * sizeof(glm::uvec4), levelArgs.data());
+
+    std::vector<int> levelStartIndices;
+    for (int64_t i = 1; i <= m_depth; ++i)
+        levelStartIndices.push_back(static_cast<int>(levelArgs[i].w));
+    // incremental updates append their nodes behind the last level
+    GLuint nodeCount;
+    glGetNamedBufferSubData(m_nodeCounter.getHandle(), 0, 4, &nodeCount);
+    const size_t end = std::min((static_cast<size_t>(nodeCount) + 1) * 8, m_nodeCapacity);
+    levelStartIndices.push_back(static_cast<int>(std::max<size_t>(levelArgs[m_depth].w + levelArgs[m_depth].x * 8, end)));
+    return levelStartIndices;
+}
+
+void SparseVoxelOctree::allocateVoxelFragments(size_t count)
+{
+    // whole work groups of FlagNodes.comp and InitLeafNodes.comp, the cleared entries at the end are skipped
+    count = (count + 63) / 64 * 64;
+    const glm::vec4 zero_vec = glm::vec4(0.f);
+
+    m_voxelFragmentList = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_voxelFragmentList->setStorageWithoutData<glm::vec4>(count, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(m_voxelFragmentList->getHandle(), GL_RGBA32F, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
+
+    m_voxelFragmentColor = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_voxelFragmentColor->setStorageWithoutData<glm::vec4>(count, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(m_voxelFragmentColor->getHandle(), GL_RGBA32F, GL_RGBA, GL_FLOAT, glm::value_ptr(zero_vec));
+
+    // large triangles leave many fragments per tile, so a tile per 16 fragments rarely runs out. Tiles that do not fit are voxelized by their triangle
+    m_voxelizeTiles = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_voxelizeTiles->setStorageWithoutData<glm::uvec2>(count / 16, GL_DYNAMIC_STORAGE_BIT);
+
+    m_voxelFragmentCapacity = count;
+    if constexpr(util::debugmode) std::cout << "Voxel fragment list resized to " << count << " fragments \n";
+}
+
+void SparseVoxelOctree::reserveNodes(size_t count, float headroom)
+{
+    if (count <= m_nodeCapacity)
+        return;
+
+    const size_t capacity = (static_cast<size_t>(count * headroom) + 7) / 8 * 8;
+    m_nodePool = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_nodePool->setStorageWithoutData<GLint>(capacity, GL_DYNAMIC_STORAGE_BIT);
+    const GLint clear_val = -1;
+    glClearNamedBufferData(m_nodePool->getHandle(), GL_R32I, GL_RED_INTEGER, GL_INT, &clear_val);
+
+    m_nodeCapacity = capacity;
+    if constexpr(util::debugmode) std::cout << "Node pool resized to " << capacity << " nodes \n";
+}
+
+void SparseVoxelOctree::reserveNodeData(size_t count)
+{
+    if (count <= m_nodeDataCapacity)
+        return;
+
+    // same size as the node pool, every node has a color and a fragment count
+    const size_t capacity = std::max(m_nodeCapacity, count);
+    const GLuint clear_val_color = 0u;
+    m_nodeColor = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_nodeColor->setStorageWithoutData<GLuint>(capacity, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(m_nodeColor->getHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_color);
+
+    const GLint clear_val = 0;
+    m_leafCount = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_leafCount->setStorageWithoutData<GLint>(capacity, GL_DYNAMIC_STORAGE_BIT);
+    glClearNamedBufferData(m_leafCount->getHandle(), GL_R32I, GL_RED_INTEGER, GL_INT, &clear_val);
+    m_nodeDataCapacity = capacity;
+}
+
+SparseVoxelOctreeData SparseVoxelOctree::readBack() const
+{
+    SparseVoxelOctreeData octree;
+    octree.levelStartIndices = m_buildMode == BuildMode::gpu && !m_compressed ? readLevelStartIndices() : m_levelStartIndices;
+    const size_t nodes = octree.levelStartIndices.back();
+    octree.nodePool.resize(nodes);
+    octree.nodeColor.resize(nodes);
+    glGetNamedBufferSubData(m_nodePool->getHandle(), 0, nodes * sizeof(GLint), octree.nodePool.data());
+    glGetNamedBufferSubData(m_nodeColor->getHandle(), 0, nodes * sizeof(GLuint), octree.nodeColor.data());
+    return octree;
+}
+
+SparseVoxelOctreeComparison SparseVoxelOctree::verifyWithCPUBuilder() const
+{
+    if (m_buildMode == BuildMode::loaded)
+        throw std::runtime_error("Octrees loaded from a file have no scene to verify against");
+    const SparseVoxelOctreeBuilder builder(m_bmin, m_bmax, m_depth);
+    return SparseVoxelOctreeBuilder::compare(builder.build(m_scene), readBack());
+}
+
+SparseVoxelOctreeTracer SparseVoxelOctree::createTracer() const
+{
+    return SparseVoxelOctreeTracer(readBack(), m_bmin, m_bmax);
+}
+
+SparseVoxelOctreeTraceComparison SparseVoxelOctree::verifyTracer(const glm::mat4& view, const glm::mat4& projection, int width, int height) const
+{
+    TRACE_SCOPE("SparseVoxelOctree::verifyTracer");
+    const glm::mat4 inverseView = glm::inverse(view);
+    const glm::mat4 inverseViewProjection = inverseView * glm::inverse(projection);
+    const glm::vec3 camPosition(inverseView[3]);
+
+    // render the shader into a float target, so the colors are read back unrounded
+    ShaderProgram traceShader(Shader{ "SparseVoxelOctree/sfq_rayDir.vert", GL_VERTEX_SHADER }, Shader{ "SparseVoxelOctree/TraceSparseVoxelOctree.frag", GL_FRAGMENT_SHADER });
+    traceShader.addUniform(std::make_shared<Uniform<glm::mat4>>("viewMatrix", view));
+    traceShader.addUniform(std::make_shared<Uniform<glm::mat4>>("projectionMatrix", projection));
+    traceShader.addUniform(std::make_shared<Uniform<glm::vec3>>("camPosition", camPosition));
+    traceShader.addUniform(std::make_shared<Uniform<glm::vec3>>("bmin", m_bmin));
+    traceShader.addUniform(std::make_shared<Uniform<glm::vec3>>("bmax", m_bmax));
+    auto target = std::make_shared<Texture>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+    target->initWithoutData(width, height, GL_RGBA32F);
+    const FrameBuffer frameBuffer({ target }, false);
+    const Quad quad;
+
+    const std::array<GLint, 4> viewport = GLStateCache::getViewport();
+    frameBuffer.bind();
+    GLStateCache::viewport(0, 0, width, height);
+    traceShader.use();
+    bind();
+    quad.draw();
+    frameBuffer.unbind();
+    GLStateCache::viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    std::vector<glm::vec4> pixels(static_cast<size_t>(width) * height);
+    glGetTextureImage(target->getName(), 0, GL_RGBA, GL_FLOAT, static_cast<GLsizei>(pixels.size() * sizeof(glm::vec4)), pixels.data());
+
+    // the same rays as sfq_rayDir.vert through the pixel centers
+    std::vector<SparseVoxelOctreeRay> rays(pixels.size());
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const glm::vec2 ndc = (glm::vec2(x, y) + 0.5f) / glm::vec2(width, height) * 2.0f - 1.0f;
+            glm::vec4 originPlusDir = inverseViewProjection * glm::vec4(ndc, 0.0f, 1.0f);
+            originPlusDir /= originPlusDir.w;
+            rays[y * width + x] = { camPosition, glm::normalize(glm::vec3(originPlusDir) - camPosition) };
+        }
+    }
+    std::vector<SparseVoxelOctreeHit> hits;
+    createTracer().trace(rays, hits);
+
+    // misses show the sky of the shader, one step of the 8 bit colors is allowed
+    SparseVoxelOctreeTraceComparison comparison;
+    comparison.pixels = pixels.size();
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        const glm::vec4 sky(glm::vec3(0.7f, 0.9f, 1.0f) + rays[i].direction.y * 0.618f, 1.0f);
+        const bool shaderHit = glm::compMax(glm::abs(pixels[i] - sky)) > 1e-4f;
+        if (shaderHit != hits[i].isHit())
+            comparison.hitMismatches++;
+        else if (shaderHit && glm::compMax(glm::abs(pixels[i] - hits[i].color)) > 1.5f / 255.0f)
+            comparison.colorMismatches++;
+    }
+    return comparison;
+}
+
+void SparseVoxelOctree::saveToFile(const std::experimental::filesystem::path& file, bool chunkPerLevel) const
+{
+    TRACE_SCOPE("SparseVoxelOctree::saveToFile");
+    SparseVoxelOctreeFile::write(file, readBack(), m_bmin, m_bmax, chunkPerLevel);
+}
+
+void SparseVoxelOctree::streamUpload(const SparseVoxelOctreeFile& file)
+{
+    GPUProfiler::beginScope("upload");
+    const BufferStorageMask flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    Buffer staging(GL_COPY_READ_BUFFER);
+    staging.setStorageWithoutData<char>(2 * s_stagingSliceSize, flags);
+    char* mapped = staging.mapBufferContent<char>(2 * s_stagingSliceSize, 0, flags);
+    std::array<GLsync, 2> fences = { nullptr, nullptr };
+    size_t slice = 0;
+
+    const auto upload = [&](const Buffer& target, size_t targetOffset, const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            // the GPU has to be done with the previous copy out of this half
+            if (fences[slice])
+            {
+                glClientWaitSync(fences[slice], GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+                glDeleteSync(fences[slice]);
+            }
+            const size_t count = std::min(size, s_stagingSliceSize);
+            std::memcpy(mapped + slice * s_stagingSliceSize, data, count);
+            glCopyNamedBufferSubData(staging.getHandle(), target.getHandle(), slice * s_stagingSliceSize, targetOffset, count);
+            fences[slice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, UnusedMask::GL_UNUSED_BIT);
+
+            slice = 1 - slice;
+            data += count;
+            targetOffset += count;
+            size -= count;
+        }
+    };
+
+    // coarse levels first, they are in the first chunks
+    for (const auto& chunk : file.getChunks())
+    {
+        upload(*m_nodePool, chunk.firstNode * sizeof(GLint), reinterpret_cast<const char*>(file.getNodePool(chunk)), chunk.nodeCount * sizeof(GLint));
+        upload(*m_nodeColor, chunk.firstNode * sizeof(GLuint), reinterpret_cast<const char*>(file.getNodeColor(chunk)), chunk.nodeCount * sizeof(GLuint));
+    }
+
+    // the staging buffer is only deleted by the driver once the copies are done
+    staging.unmapBuffer();
+    for (GLsync fence : fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    GPUProfiler::endScope();
+}
+
+void SparseVoxelOctree::compress(float colorTolerance)
+{
+    TRACE_SCOPE("SparseVoxelOctree::compress");
+    const SparseVoxelOctreeData dag = SparseVoxelOctreeBuilder::compress(readBack(), colorTolerance);
+
+    // the DAG is never larger than the octree, so it fits into the current buffers
+    GPUProfiler::beginScope("upload");
+    const GLuint clear_val_color = 0u;
+    const GLint clear_val = -1;
+    glClearNamedBufferData(m_nodeColor->getHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &clear_val_color);
+    glClearNamedBufferData(m_nodePool->getHandle(), GL_R32I, GL_RED_INTEGER, GL_INT, &clear_val);
+    m_nodePool->setContentToContainerSubData(dag.nodePool, 0);
+    m_nodeColor->setContentToContainerSubData(dag.nodeColor, 0);
+    GPUProfiler::endScope();
+
+    m_levelStartIndices = dag.levelStartIndices;
+    m_compressed = true;
+    setBrickPool(false);
+    if constexpr(util::debugmode) std::cout << dag.nodePool.size() << " Nodes after compression \n";
+}
+
+void SparseVoxelOctree::setBrickPool(bool enabled)
+{
+    if (enabled && m_compressed)
+        throw std::runtime_error("DAGs have no brick pool, the neighbors of shared groups are not unique");
+    m_brickPoolEnabled = enabled;
+    if (!enabled)
+    {
+        m_brickPool.reset();
+        m_brickGroups.reset();
+        m_brickPoolHandle = 0;
+        m_brickGroupCapacity = 0;
+        return;
+    }
+
+    // both constructors get here, the uniforms of the build exist only for octrees built from a scene
+    if (!m_brickLevelUniform)
+    {
+        m_brickLevelUniform = std::make_shared<Uniform<int>>("level", 1);
+        m_locateBricksShader.addUniform(m_brickLevelUniform);
+        m_brickImageUniform = std::make_shared<Uniform<GLuint64>>("brickPool", 0);
+        m_fillBricksShader.addUniform(m_brickImageUniform);
+    }
+    updateBricks();
+}
+
+bool SparseVoxelOctree::hasBrickPool() const
+{
+    return m_brickPoolEnabled;
+}
+
+GLuint64 SparseVoxelOctree::getBrickPoolHandle() const
+{
+    return m_brickPoolHandle;
+}
+
+void SparseVoxelOctree::updateBricks()
+{
+    GPUProfiler::beginScope("brick pool");
+    // the used part of the pool is only known on the GPU, so there is a brick for every group of the pool
+    reserveBricks(m_nodeCapacity / 8);
+
+    // only the group of the root children is known up front, all others are found top down
+    const glm::ivec4 unused(0, 0, 0, -1);
+    glClearNamedBufferData(m_brickGroups->getHandle(), GL_RGBA32I, GL_RGBA_INTEGER, GL_INT, glm::value_ptr(unused));
+    m_brickGroups->setContentSubData(glm::ivec4(0), sizeof(glm::ivec4));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_nodePool->bindBase(static_cast<BufferBindings::Binding>(2));
+    m_nodeColor->bindBase(static_cast<BufferBindings::Binding>(3));
+    m_brickGroups->bindBase(BufferBindings::Binding::brickGroups);
+
+    m_locateBricksShader.use();
+    for (int i = 1; i < m_depth; ++i) {
+        m_brickLevelUniform->setContent(i);
+        m_locateBricksShader.updateUniforms();
+        dispatchComputeWrapped((m_nodeCapacity + 63) / 64);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // all colors are final after mipmapping, so the borders can be copied from the neighbors
+    m_fillBricksShader.use();
+    m_fillBricksShader.updateUniforms();
+    dispatchComputeWrapped(m_brickGroupCapacity - 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    GPUProfiler::endScope();
+}
+
+void SparseVoxelOctree::reserveBricks(size_t count)
+{
+    if (count <= m_brickGroupCapacity)
+        return;
+
+    m_brickGroups = std::make_unique<Buffer>(GL_SHADER_STORAGE_BUFFER);
+    m_brickGroups->setStorageWithoutData<glm::ivec4>(count, GL_DYNAMIC_STORAGE_BIT);
+
+    // group 0 only holds the root and has no brick, the others are stored row by row and slice by slice in a roughly cubic atlas
+    const size_t bricks = count - 1;
+    const size_t bricksPerRow = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(bricks))));
+    const size_t slices = (bricks + bricksPerRow * bricksPerRow - 1) / (bricksPerRow * bricksPerRow);
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    if (static_cast<GLint>(std::max(bricksPerRow, slices) * s_brickSize) > maxSize)
+        throw std::runtime_error("The brick pool does not fit into a 3D texture");
+
+    // no mipmaps and no anisotropic filtering, they would blend neighboring bricks
+    m_brickPool = std::make_unique<Image>(GL_TEXTURE_3D, GL_LINEAR, GL_LINEAR);
+    m_brickPool->setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    glTextureParameterf(m_brickPool->getName(), GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+    const auto texels = static_cast<int>(bricksPerRow * s_brickSize);
+    m_brickPool->initWithoutData3D(texels, texels, static_cast<int>(slices * s_brickSize), GL_RGBA8, false);
+    m_brickImageUniform->setContent(m_brickPool->generateImageHandle(GL_RGBA8));
+    m_brickPoolHandle = m_brickPool->Texture::generateHandle();
+
+    m_brickGroupCapacity = count;
+    if constexpr(util::debugmode) std::cout << "Brick pool resized to " << bricks << " bricks \n";
+}
+
+size_t SparseVoxelOctree::getNodeCount() const
+{
+    return m_buildMode == BuildMode::gpu && !m_compressed ? readLevelStartIndices().back() : m_levelStartIndices.back();
+}
+
+size_t SparseVoxelOctree::getDepth() const
+{
+    return static_cast<size_t>(m_depth);
 }
 
 glm::vec3 SparseVoxelOctree::getBMin() const
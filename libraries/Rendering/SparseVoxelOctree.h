@@ -4,25 +4,232 @@
 using namespace gl;
 
 #include <memory>
+#include <experimental/filesystem>
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
 
+#include "Binding.h"
+#include "Image.h"
 #include "Mesh.h"
 #include "ShaderProgram.h"
+#include "SparseVoxelOctreeBuilder.h"
+#include "SparseVoxelOctreeFile.h"
+#include "SparseVoxelOctreeTracer.h"
 
 class SparseVoxelOctree 
 {
 public:
-    SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& scene, const size_t depth);
+    /**
+     * \brief where the octree is built, automatic uses the GPU. Octrees loaded from a file are static
+     */
+    enum class BuildMode
+    {
+        automatic,
+        gpu,
+        cpu,
+        loaded
+    };
+
+    /**
+     * \brief how the GPU build voxelizes the scene, raster draws the meshes with VoxelGen.vert/geom/frag and needs GL_NV_conservative_raster,
+     * compute runs VoxelizeTriangles.comp and VoxelizeTiles.comp on the vertex and index buffers of the meshes and works on every GL 4.5 driver.
+     * Both write the same voxel fragment list, automatic uses raster if it is available
+     */
+    enum class Voxelizer
+    {
+        automatic,
+        raster,
+        compute
+    };
+
+    SparseVoxelOctree(const std::vector<std::shared_ptr<Mesh>>& scene, const size_t depth, BuildMode mode = BuildMode::automatic, Voxelizer voxelizer = Voxelizer::automatic);
+
+    /**
+     * \brief loads an octree baked with saveToFile, the mapped file is streamed into the buffers without voxelizing anything.
+     * Throws if the file is invalid
+     */
+    explicit SparseVoxelOctree(const std::experimental::filesystem::path& file);
+    ~SparseVoxelOctree();
 
     void bind() const;
 
+    /**
+     * \brief rebuilds the whole octree, throws for octrees loaded from a file
+     */
     void update();
 
+    /**
+     * \brief removes the voxels of the given meshes of the scene and voxelizes them again, e.g. after they moved.
+     * Only the paths of these voxels are updated, emptied nodes stay in the pool until the next full update.
+     * Falls back to a full update on the CPU, after compress or if the buffers have to grow
+     */
+    void update(const std::vector<std::shared_ptr<Mesh>>& changedMeshes);
+
+    BuildMode getBuildMode() const;
+
+    /**
+     * \brief selects the voxelizer of the following GPU updates, throws for raster without GL_NV_conservative_raster
+     */
+    void setVoxelizer(Voxelizer voxelizer);
+    Voxelizer getVoxelizer() const;
+
+    /**
+     * \brief reads the node pool and colors of the last update back from the GPU
+     */
+    SparseVoxelOctreeData readBack() const;
+
+    /**
+     * \brief builds the octree with the CPU reference builder and compares it with the current GPU buffers
+     */
+    SparseVoxelOctreeComparison verifyWithCPUBuilder() const;
+
+    /**
+     * \brief returns a CPU tracer for a copy of the current octree (or DAG), e.g. for picking
+     */
+    SparseVoxelOctreeTracer createTracer() const;
+
+    /**
+     * \brief renders TraceSparseVoxelOctree.frag offscreen and compares every pixel with the rays of SparseVoxelOctreeTracer
+     * \param view view matrix of the camera the pixels are traced from
+     * \param projection projection matrix of the camera
+     */
+    SparseVoxelOctreeTraceComparison verifyTracer(const glm::mat4& view, const glm::mat4& projection, int width, int height) const;
+
+    /**
+     * \brief writes the current octree (or DAG) to a file, see SparseVoxelOctreeFile
+     * \param chunkPerLevel store every level as a separate chunk
+     */
+    void saveToFile(const std::experimental::filesystem::path& file, bool chunkPerLevel = true) const;
+
+    /**
+     * \brief replaces the octree with a DAG of its shared subtrees, see SparseVoxelOctreeBuilder::compress.
+     * The next update rebuilds the uncompressed octree
+     */
+    void compress(float colorTolerance = 0.0f);
+
+    /**
+     * \brief keeps a brick pool for filtered lookups up to date with every update, see brickPool.glsl.
+     * Every group of 8 siblings owns a brick of s_brickSize^3 RGBA8 texels in a 3D atlas: the siblings and a border of their neighbors,
+     * so hardware trilinear filtering inside the parent node is correct. The atlas has a brick for every group the node pool has room for,
+     * 256 bytes per 8 nodes. Throws for DAGs, whose shared groups have no unique neighbors, compress disables the brick pool
+     */
+    void setBrickPool(bool enabled);
+    bool hasBrickPool() const;
+
+    /**
+     * \brief bindless handle of the brick atlas for sampleBrick in brickPool.glsl, 0 without brick pool
+     */
+    GLuint64 getBrickPoolHandle() const;
+
+    /**
+     * \brief number of nodes in the used part of the node pool, including the unused siblings in every group
+     */
+    size_t getNodeCount() const;
+
+    /**
+     * \brief deepest level of the octree, the root is level 0
+     */
+    size_t getDepth() const;
+
     glm::vec3 getBMin() const;
     glm::vec3 getBMax() const;
 
+    // extra space allocated when a buffer has to grow, so small changes of the scene do not reallocate every update
+    static constexpr float s_headroom = 1.25f;
+
+    // size of each of the two halves of the staging buffer used to stream a loaded file into the buffers
+    static constexpr size_t s_stagingSliceSize = 4 << 20;
+
+    // texels per axis of a brick, the 2^3 siblings of a group with a border of one texel
+    static constexpr int s_brickSize = 4;
+
 protected:
+    void updateGPU();
+    void updateCPU();
+
+    /**
+     * \brief records the whole GPU build without reading anything back, the counters are copied for growToFit
+     */
+    void buildGPU();
+
+    /**
+     * \brief records the incremental GPU update of the voxels of the meshes with the given indices
+     */
+    void updateMeshesGPU(const std::vector<size_t>& meshes);
+
+    void bindBuffers() const;
+
+    /**
+     * \brief appends the fragments of the meshes to the fragment list and records their ranges,
+     * fragments that do not fit are only counted
+     */
+    void voxelize(const std::vector<size_t>& meshes);
+
+    /**
+     * \brief appends the fragments of one mesh with the compute voxelizer, small triangles are voxelized by one invocation each,
+     * the columns of large triangles are split into tiles of one work group each
+     */
+    void voxelizeCompute(const Mesh& mesh);
+
+    /**
+     * \brief selects the fragments for the following per fragment dispatches
+     * \param mesh index of a mesh, s_allFragments or s_updatedFragments
+     */
+    void prepareFragmentDispatch(int mesh);
+
+    /**
+     * \brief copies the counters for growToFit and fences them
+     */
+    void fenceCounters(bool fullBuild);
+
+    /**
+     * \brief checks the counters of the last GPU build and grows the buffers if a full build was too small
+     * \param wait wait for the build to finish, otherwise return false if it is still running
+     * \return true if the last build did not fit and a full build is needed
+     */
+    bool growToFit(bool wait);
+
+    /**
+     * \brief reads the level start indices of the last full GPU build from the level arguments,
+     * the last entry is the end of the used node pool including nodes of incremental updates
+     */
+    std::vector<int> readLevelStartIndices() const;
+
+    /**
+     * \brief replaces the voxel fragment list and colors with cleared buffers for at least count fragments
+     */
+    void allocateVoxelFragments(size_t count);
+
+    /**
+     * \brief replaces the node pool with a cleared pool for at least count nodes if it is smaller
+     * \param headroom factor of extra space for later updates
+     */
+    void reserveNodes(size_t count, float headroom = s_headroom);
+
+    /**
+     * \brief makes room for the colors and leaf fragment counts of at least count nodes, they are cleared if the buffers are replaced
+     */
+    void reserveNodeData(size_t count);
+
+    /**
+     * \brief uploads the chunks of a mapped file through a persistently mapped staging buffer with two fenced halves,
+     * so copying the next slice out of the file overlaps with the transfer of the previous one
+     */
+    void streamUpload(const SparseVoxelOctreeFile& file);
+
+    /**
+     * \brief locates the groups top down and copies the colors of every group and its neighbors into its brick
+     */
+    void updateBricks();
+
+    /**
+     * \brief replaces the brick atlas and the group positions if they have less room than count groups
+     */
+    void reserveBricks(size_t count);
+
+    // fragments selected by prepareFragmentDispatch besides the fragments of a single mesh, see PrepareIndirect.comp
+    static constexpr int s_allFragments = -1;
+    static constexpr int s_updatedFragments = -2;
 
     ShaderProgram m_voxelGenShader{ {
         Shader{ "SparseVoxelOctree/VoxelGen.vert", GL_VERTEX_SHADER},
@@ -30,6 +237,18 @@ protected:
         Shader{ "SparseVoxelOctree/VoxelGen.frag", GL_FRAGMENT_SHADER}
     } };
 
+    ShaderProgram m_voxelizeTrianglesShader{ {
+        Shader{ "SparseVoxelOctree/VoxelizeTriangles.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions }
+    } };
+
+    ShaderProgram m_prepareVoxelizeTilesShader{ {
+        Shader{ "SparseVoxelOctree/PrepareVoxelizeTiles.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions }
+    } };
+
+    ShaderProgram m_voxelizeTilesShader{ {
+        Shader{ "SparseVoxelOctree/VoxelizeTiles.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions }
+    } };
+
     ShaderProgram m_flagShader{ {
         Shader{ "SparseVoxelOctree/FlagNodes.comp", GL_COMPUTE_SHADER }
     } };
@@ -46,20 +265,77 @@ protected:
         Shader{ "SparseVoxelOctree/MipMapNodes.comp", GL_COMPUTE_SHADER }
     } };
 
-    Buffer m_voxelFragmentList{GL_SHADER_STORAGE_BUFFER};   // vec4
-    Buffer m_voxelCounter{GL_ATOMIC_COUNTER_BUFFER};        // uint32
-    Buffer m_voxelFragmentColor{GL_SHADER_STORAGE_BUFFER};  // vec4
+    ShaderProgram m_prepareIndirectShader{ {
+        Shader{ "SparseVoxelOctree/PrepareIndirect.comp", GL_COMPUTE_SHADER }
+    } };
+
+    ShaderProgram m_removeVoxelsShader{ {
+        Shader{ "SparseVoxelOctree/RemoveVoxels.comp", GL_COMPUTE_SHADER }
+    } };
+
+    ShaderProgram m_fragmentNodeCreationShader{ {
+        Shader{ "SparseVoxelOctree/CreateNodesForFragments.comp", GL_COMPUTE_SHADER }
+    } };
+
+    ShaderProgram m_fragmentMipMapShader{ {
+        Shader{ "SparseVoxelOctree/MipMapFragments.comp", GL_COMPUTE_SHADER }
+    } };
+
+    ShaderProgram m_locateBricksShader{ {
+        Shader{ "SparseVoxelOctree/LocateBricks.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions }
+    } };
 
-    Buffer m_nodePool{GL_SHADER_STORAGE_BUFFER};        // int32
+    ShaderProgram m_fillBricksShader{ {
+        Shader{ "SparseVoxelOctree/FillBricks.comp", GL_COMPUTE_SHADER, BufferBindings::g_definitions }
+    } };
+
+    // the fragment list, node pool and colors are immutable buffers, they are replaced when they have to grow
+    std::unique_ptr<Buffer> m_voxelFragmentList;        // vec4
+    Buffer m_voxelCounter{GL_ATOMIC_COUNTER_BUFFER};    // uint32
+    std::unique_ptr<Buffer> m_voxelFragmentColor;       // vec4
+    std::unique_ptr<Buffer> m_voxelizeTiles;            // uvec2 triangle and tile of the large triangles of the compute voxelizer
+    Buffer m_voxelizeTileArgs{GL_SHADER_STORAGE_BUFFER}; // uvec4 work groups and number of tiles, see VoxelizeTriangles.comp
+
+    std::unique_ptr<Buffer> m_nodePool;                 // int32
     Buffer m_nodeCounter{GL_ATOMIC_COUNTER_BUFFER};     // uint32
-    Buffer m_nodeColor{GL_SHADER_STORAGE_BUFFER};       // vec4
+    std::unique_ptr<Buffer> m_nodeColor;                // uint32, RGBA8 see nodeColor.glsl
+    std::unique_ptr<Buffer> m_leafCount;                // int32, fragments per leaf
+
+    Buffer m_fragmentRanges{GL_SHADER_STORAGE_BUFFER};  // uvec2 dispatch range, update range and range of every mesh
+
+    Buffer m_levelArgs{GL_DISPATCH_INDIRECT_BUFFER};    // uvec4, work groups and start index per level, see PrepareIndirect.comp
+    Buffer m_counterReadback{GL_COPY_WRITE_BUFFER};     // uint32 voxel and node counter of the last build
+    const GLuint* m_counters = nullptr;
+    GLsync m_counterFence = nullptr;
+    bool m_capacityKnown = false;
+    bool m_countersFromFullBuild = false;
+
+    size_t m_voxelFragmentCapacity = 0;
+    size_t m_nodeCapacity = 0;
+    size_t m_nodeDataCapacity = 0;
+
+    bool m_brickPoolEnabled = false;
+    std::unique_ptr<Buffer> m_brickGroups;              // ivec4 position and level of the parent of every group, see LocateBricks.comp
+    std::unique_ptr<Image> m_brickPool;                 // RGBA8 atlas of s_brickSize^3 bricks
+    GLuint64 m_brickPoolHandle = 0;
+    size_t m_brickGroupCapacity = 0;
 
-    std::shared_ptr<Uniform<int>> m_startIndexUniform;
+    std::shared_ptr<Uniform<int>> m_levelUniform;
+    std::shared_ptr<Uniform<int>> m_meshUniform;
     std::shared_ptr<Uniform<glm::mat4>> m_modelMatrixUniform;
+    std::shared_ptr<Uniform<glm::mat4>> m_voxelMatrixUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_albedoUniform;
+    std::shared_ptr<Uniform<int>> m_brickLevelUniform;
+    std::shared_ptr<Uniform<GLuint64>> m_brickImageUniform;
 
     int64_t m_N;
     int64_t m_depth;
-    const std::vector<std::shared_ptr<Mesh>>& m_scene;
+    BuildMode m_buildMode;
+    Voxelizer m_voxelizer = Voxelizer::compute;
+    bool m_conservativeRaster = false;
+    std::vector<int> m_levelStartIndices;   // CPU build, loaded or compressed only, the GPU keeps them in m_levelArgs
+    bool m_compressed = false;
+    std::vector<std::shared_ptr<Mesh>> m_scene;     // empty if loaded from a file
 
     glm::vec3 m_bmin;
     glm::vec3 m_bmax;
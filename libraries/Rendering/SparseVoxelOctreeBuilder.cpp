@@ -0,0 +1,502 @@
+#include "SparseVoxelOctreeBuilder.h"
+#include "Utils/Tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <execution>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <glm/gtc/packing.hpp>
+#include <glm/gtx/component_wise.hpp>
+
+namespace
+{
+    constexpr size_t trianglesPerChunk = 1024;
+
+    // spreads the lower 10 bits so that there are two zero bits between each of them
+    uint32_t part1By2(uint32_t x)
+    {
+        x &= 0x000003ff;
+        x = (x ^ (x << 16)) & 0xff0000ff;
+        x = (x ^ (x << 8)) & 0x0300f00f;
+        x = (x ^ (x << 4)) & 0x030c30c3;
+        x = (x ^ (x << 2)) & 0x09249249;
+        return x;
+    }
+
+    // voxels are sorted by code, voxels with the same code by color. Keeps the last, i.e. the largest color like atomicMax in InitLeafNodes.comp
+    void removeDuplicateVoxels(std::vector<uint64_t>& voxels)
+    {
+        auto out = voxels.begin();
+        for (auto it = voxels.begin(); it != voxels.end(); ++it)
+        {
+            const auto next = std::next(it);
+            if (next == voxels.end() || (*next >> 32) != (*it >> 32))
+                *out++ = *it;
+        }
+        voxels.erase(out, voxels.end());
+    }
+
+    uint32_t compact1By2(uint32_t x)
+    {
+        x &= 0x09249249;
+        x = (x ^ (x >> 2)) & 0x030c30c3;
+        x = (x ^ (x >> 4)) & 0x0300f00f;
+        x = (x ^ (x >> 8)) & 0xff0000ff;
+        x = (x ^ (x >> 16)) & 0x000003ff;
+        return x;
+    }
+
+    // separating axis test of a triangle and an axis aligned box (Akenine-Moeller), vertices relative to the box center
+    bool triangleBoxOverlap(const std::array<glm::vec3, 3>& v, glm::vec3 halfSize)
+    {
+        // box normals
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float minV = glm::min(v[0][axis], glm::min(v[1][axis], v[2][axis]));
+            const float maxV = glm::max(v[0][axis], glm::max(v[1][axis], v[2][axis]));
+            if (minV > halfSize[axis] || maxV < -halfSize[axis])
+                return false;
+        }
+
+        // cross products of the edges with the box normals
+        const std::array<glm::vec3, 3> edges = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+        for (const auto& edge : edges)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                glm::vec3 unit(0.0f);
+                unit[axis] = 1.0f;
+                const glm::vec3 separatingAxis = glm::cross(unit, edge);
+                const float p0 = glm::dot(separatingAxis, v[0]);
+                const float p1 = glm::dot(separatingAxis, v[1]);
+                const float p2 = glm::dot(separatingAxis, v[2]);
+                const float r = glm::dot(halfSize, glm::abs(separatingAxis));
+                if (glm::min(p0, glm::min(p1, p2)) > r || glm::max(p0, glm::max(p1, p2)) < -r)
+                    return false;
+            }
+        }
+
+        // triangle plane
+        const glm::vec3 normal = glm::cross(edges[0], edges[1]);
+        const float r = glm::dot(halfSize, glm::abs(normal));
+        return glm::abs(glm::dot(normal, v[0])) <= r;
+    }
+
+    bool isOccupied(const SparseVoxelOctreeData& octree, size_t index, size_t level, size_t depth)
+    {
+        if (index >= octree.nodePool.size() || index >= octree.nodeColor.size())
+            return false;
+        // inner nodes without filled leaves below, e.g. left behind by incremental updates, are empty as well
+        const bool filled = SparseVoxelOctreeBuilder::unpackColor(octree.nodeColor[index]).w > 0.0f;
+        return level == depth ? filled : octree.nodePool[index] > 0 && filled;
+    }
+
+    size_t countSubtree(const SparseVoxelOctreeData& octree, size_t index, size_t level, size_t depth)
+    {
+        size_t count = 1;
+        if (level < depth)
+        {
+            for (size_t tile = 0; tile < 8; tile++)
+            {
+                const size_t child = octree.nodePool[index] + tile;
+                if (isOccupied(octree, child, level + 1, depth))
+                    count += countSubtree(octree, child, level + 1, depth);
+            }
+        }
+        return count;
+    }
+
+    void compareSubtree(const SparseVoxelOctreeData& reference, const SparseVoxelOctreeData& other, size_t referenceIndex, size_t otherIndex,
+        size_t level, size_t depth, float colorEpsilon, SparseVoxelOctreeComparison& result)
+    {
+        result.nodes++;
+        const glm::vec4 referenceColor = SparseVoxelOctreeBuilder::unpackColor(reference.nodeColor[referenceIndex]);
+        const glm::vec4 otherColor = SparseVoxelOctreeBuilder::unpackColor(other.nodeColor[otherIndex]);
+        if (glm::compMax(glm::abs(referenceColor - otherColor)) > colorEpsilon)
+            result.colorMismatches++;
+        if (level == depth)
+            return;
+
+        for (size_t tile = 0; tile < 8; tile++)
+        {
+            const size_t referenceChild = reference.nodePool[referenceIndex] + tile;
+            const size_t otherChild = other.nodePool[otherIndex] + tile;
+            const bool inReference = isOccupied(reference, referenceChild, level + 1, depth);
+            const bool inOther = isOccupied(other, otherChild, level + 1, depth);
+            if (inReference && inOther)
+                compareSubtree(reference, other, referenceChild, otherChild, level + 1, depth, colorEpsilon, result);
+            else if (inReference)
+                result.onlyInReference += countSubtree(reference, referenceChild, level + 1, depth);
+            else if (inOther)
+                result.onlyInOther += countSubtree(other, otherChild, level + 1, depth);
+        }
+    }
+
+    // child group id (-1 for leaves, -2 for empty nodes) and the 4 (quantized) color channels of each of the 8 siblings of a group
+    using GroupKey = std::array<int32_t, 8 * 5>;
+
+    struct GroupKeyHash
+    {
+        size_t operator()(const GroupKey& key) const
+        {
+            // FNV-1a over the 32 bit values
+            uint64_t hash = 14695981039346656037ull;
+            for (const int32_t value : key)
+            {
+                hash ^= static_cast<uint32_t>(value);
+                hash *= 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    // unique groups of one level of the DAG, their ids are their order in the level
+    struct DagLevel
+    {
+        std::unordered_map<GroupKey, int, GroupKeyHash> ids;
+        std::vector<std::array<int, 8>> children;       // ids of the child groups on the next level, -1 without children
+        std::vector<std::array<GLuint, 8>> colors;
+    };
+
+    struct DagCompression
+    {
+        const SparseVoxelOctreeData& octree;
+        size_t depth;
+        float colorTolerance;
+        std::vector<DagLevel> levels;
+        std::vector<int> groupIds;      // DAG id of every group of the input by its start / 8, so shared input groups are merged once
+    };
+
+    // merges the subtrees below the group of children starting at groupStart and returns the id of the group on its level
+    int mergeGroup(DagCompression& compression, size_t groupStart, size_t level)
+    {
+        int& groupId = compression.groupIds[groupStart / 8];
+        if (groupId >= 0)
+            return groupId;
+
+        GroupKey key;
+        std::array<int, 8> children;
+        std::array<GLuint, 8> colors;
+        for (size_t tile = 0; tile < 8; tile++)
+        {
+            const size_t node = groupStart + tile;
+            const bool occupied = isOccupied(compression.octree, node, level, compression.depth);
+            children[tile] = occupied && level < compression.depth ? mergeGroup(compression, compression.octree.nodePool[node], level + 1) : -1;
+            colors[tile] = occupied ? compression.octree.nodeColor[node] : 0u;
+
+            // empty nodes are kept apart from leaves even if the quantized colors are equal
+            key[tile * 5] = occupied ? children[tile] : -2;
+            // the alpha byte is the occupancy mask of the children and always compared exactly
+            const glm::vec4 color = SparseVoxelOctreeBuilder::unpackColor(colors[tile]);
+            for (int c = 0; c < 4; c++)
+            {
+                if (compression.colorTolerance > 0.0f && c < 3)
+                    key[tile * 5 + 1 + c] = static_cast<int32_t>(std::floor(color[c] / compression.colorTolerance + 0.5f));
+                else
+                    key[tile * 5 + 1 + c] = static_cast<int32_t>(colors[tile] >> (8 * c) & 0xff);
+            }
+        }
+
+        DagLevel& dagLevel = compression.levels[level];
+        const auto inserted = dagLevel.ids.emplace(key, static_cast<int>(dagLevel.children.size()));
+        if (inserted.second)
+        {
+            dagLevel.children.push_back(children);
+            dagLevel.colors.push_back(colors);
+        }
+        groupId = inserted.first->second;
+        return groupId;
+    }
+}
+
+bool SparseVoxelOctreeComparison::isEqual() const
+{
+    return onlyInReference == 0 && onlyInOther == 0 && colorMismatches == 0;
+}
+
+std::string SparseVoxelOctreeComparison::toString() const
+{
+    std::stringstream ss;
+    ss << nodes << " nodes in both, " << onlyInReference << " only in reference, " << onlyInOther << " only in other, " << colorMismatches << " with different colors";
+    return ss.str();
+}
+
+SparseVoxelOctreeBuilder::SparseVoxelOctreeBuilder(glm::vec3 bmin, glm::vec3 bmax, size_t depth)
+    : m_bmin(bmin), m_bmax(bmax), m_depth(static_cast<int64_t>(depth)), m_N(int64_t(1) << depth)
+{
+    // voxel positions are limited to 10 bits per axis, same as encodeVoxelPos in VoxelGen.frag
+    if (depth < 1 || depth > 10)
+        throw std::runtime_error("SparseVoxelOctreeBuilder supports depths from 1 to 10");
+}
+
+uint32_t SparseVoxelOctreeBuilder::encodeMorton(glm::uvec3 position)
+{
+    // x in the lowest bit of every triple, same as the child index z * 4 + y * 2 + x
+    return part1By2(position.x) | part1By2(position.y) << 1 | part1By2(position.z) << 2;
+}
+
+glm::uvec3 SparseVoxelOctreeBuilder::decodeMorton(uint32_t code)
+{
+    return glm::uvec3(compact1By2(code), compact1By2(code >> 1), compact1By2(code >> 2));
+}
+
+GLuint SparseVoxelOctreeBuilder::packColor(glm::vec4 color)
+{
+    return glm::packUnorm4x8(color);
+}
+
+glm::vec4 SparseVoxelOctreeBuilder::unpackColor(GLuint color)
+{
+    return glm::unpackUnorm4x8(color);
+}
+
+GLuint SparseVoxelOctreeBuilder::mipmapColor(const GLuint* childColors)
+{
+    glm::vec3 sum(0.0f);
+    GLuint mask = 0u;
+    for (int i = 0; i < 8; i++)
+    {
+        if (childColors[i] >> 24 != 0u)
+        {
+            sum += glm::vec3(unpackColor(childColors[i]));
+            mask |= 1u << i;
+        }
+    }
+    if (mask == 0u)
+        return 0u;
+    // multiplied by the reciprocal like the shader. The GPU may round differently when packing, compare allows one step per channel
+    const float count = static_cast<float>(std::bitset<8>(mask).count());
+    return (packColor(glm::vec4(sum * (1.0f / count), 0.0f)) & 0x00ffffffu) | mask << 24;
+}
+
+std::vector<uint64_t> SparseVoxelOctreeBuilder::voxelize(const std::vector<std::shared_ptr<Mesh>>& scene) const
+{
+    TRACE_SCOPE("SparseVoxelOctreeBuilder::voxelize");
+
+    // triangles in voxel coordinates, one voxel has size 1
+    const glm::vec3 scale = glm::vec3(static_cast<float>(m_N)) / (m_bmax - m_bmin);
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    std::vector<GLuint> triangleColors;
+    for (const auto& mesh : scene)
+    {
+        const GLuint color = packColor(glm::vec4(mesh->getAlbedo(), 1.0f));
+        const glm::mat4& model = mesh->getModelMatrix();
+        const auto& vertices = mesh->getVertices();
+        const auto& indices = mesh->getIndices();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            std::array<glm::vec3, 3> triangle;
+            for (int j = 0; j < 3; j++)
+                triangle[j] = (glm::vec3(model * glm::vec4(vertices[indices[i + j]], 1.0f)) - m_bmin) * scale;
+            triangles.push_back(triangle);
+            triangleColors.push_back(color);
+        }
+    }
+
+    // every chunk of triangles collects its voxels separately
+    const size_t chunkCount = (triangles.size() + trianglesPerChunk - 1) / trianglesPerChunk;
+    std::vector<std::vector<uint64_t>> chunkVoxels(chunkCount);
+    std::for_each(std::execution::par, chunkVoxels.begin(), chunkVoxels.end(), [&](std::vector<uint64_t>& voxels)
+    {
+        const size_t first = (&voxels - chunkVoxels.data()) * trianglesPerChunk;
+        const size_t last = std::min(first + trianglesPerChunk, triangles.size());
+        for (size_t i = first; i < last; i++)
+            voxelizeTriangle(triangles[i][0], triangles[i][1], triangles[i][2], triangleColors[i], voxels);
+        std::sort(voxels.begin(), voxels.end());
+        removeDuplicateVoxels(voxels);
+    });
+
+    std::vector<uint64_t> voxels;
+    voxels.reserve(std::accumulate(chunkVoxels.begin(), chunkVoxels.end(), size_t(0), [](size_t sum, const auto& v) { return sum + v.size(); }));
+    for (const auto& chunk : chunkVoxels)
+        voxels.insert(voxels.end(), chunk.begin(), chunk.end());
+    std::sort(std::execution::par, voxels.begin(), voxels.end());
+    removeDuplicateVoxels(voxels);
+    return voxels;
+}
+
+void SparseVoxelOctreeBuilder::voxelizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, GLuint color, std::vector<uint64_t>& voxels) const
+{
+    const glm::vec3 normal = glm::cross(v1 - v0, v2 - v1);
+    if (normal == glm::vec3(0.0f))
+        return;
+
+    const glm::ivec3 lo = glm::clamp(glm::ivec3(glm::floor(glm::min(v0, glm::min(v1, v2)))), glm::ivec3(0), glm::ivec3(static_cast<int>(m_N - 1)));
+    const glm::ivec3 hi = glm::clamp(glm::ivec3(glm::floor(glm::max(v0, glm::max(v1, v2)))), glm::ivec3(0), glm::ivec3(static_cast<int>(m_N - 1)));
+
+    // walk the voxel columns along the axis the triangle is most perpendicular to, only the voxels around the plane are tested
+    const glm::vec3 absNormal = glm::abs(normal);
+    const int d = absNormal.x > absNormal.y && absNormal.x > absNormal.z ? 0 : absNormal.y > absNormal.z ? 1 : 2;
+    const int a = (d + 1) % 3;
+    const int b = (d + 2) % 3;
+    const float planeDistance = glm::dot(normal, v0);
+
+    for (int ia = lo[a]; ia <= hi[a]; ia++)
+    {
+        for (int ib = lo[b]; ib <= hi[b]; ib++)
+        {
+            float minD = std::numeric_limits<float>::max();
+            float maxD = std::numeric_limits<float>::lowest();
+            for (int corner = 0; corner < 4; corner++)
+            {
+                const float xa = static_cast<float>(ia + (corner & 1));
+                const float xb = static_cast<float>(ib + (corner >> 1));
+                const float xd = (planeDistance - normal[a] * xa - normal[b] * xb) / normal[d];
+                minD = glm::min(minD, xd);
+                maxD = glm::max(maxD, xd);
+            }
+            // one voxel of slack on both sides for voxels that only touch the plane, the overlap test decides
+            const int first = glm::max(lo[d], static_cast<int>(glm::floor(minD)) - 1);
+            const int last = glm::min(hi[d], static_cast<int>(glm::floor(maxD)) + 1);
+            for (int id = first; id <= last; id++)
+            {
+                glm::ivec3 voxel;
+                voxel[a] = ia;
+                voxel[b] = ib;
+                voxel[d] = id;
+                const glm::vec3 center = glm::vec3(voxel) + 0.5f;
+                if (triangleBoxOverlap({ v0 - center, v1 - center, v2 - center }, glm::vec3(0.5f)))
+                    voxels.push_back(static_cast<uint64_t>(encodeMorton(glm::uvec3(voxel))) << 32 | color);
+            }
+        }
+    }
+}
+
+SparseVoxelOctreeData SparseVoxelOctreeBuilder::buildTree(const std::vector<uint64_t>& voxels) const
+{
+    TRACE_SCOPE("SparseVoxelOctreeBuilder::buildTree");
+
+    // the Morton prefixes of every level, the children of a node share the prefix of their parent.
+    // groups are allocated level by level in the order of their parents, which is the sorted order of the prefixes
+    std::vector<std::vector<uint32_t>> prefixes(m_depth + 1);
+    prefixes[m_depth].resize(voxels.size());
+    std::transform(voxels.begin(), voxels.end(), prefixes[m_depth].begin(), [](uint64_t voxel) { return static_cast<uint32_t>(voxel >> 32); });
+    for (int64_t level = m_depth - 1; level >= 0; level--)
+    {
+        auto& current = prefixes[level];
+        for (const uint32_t code : prefixes[level + 1])
+        {
+            if (current.empty() || current.back() != code >> 3)
+                current.push_back(code >> 3);
+        }
+    }
+    // the root always has children, as in SparseVoxelOctree::update
+    prefixes[0] = { 0u };
+
+    SparseVoxelOctreeData octree;
+    octree.levelStartIndices.push_back(8);
+    for (int64_t level = 1; level <= m_depth; level++)
+        octree.levelStartIndices.push_back(octree.levelStartIndices.back() + 8 * static_cast<int>(prefixes[level - 1].size()));
+
+    const size_t poolSize = octree.levelStartIndices.back();
+    octree.nodePool.assign(poolSize, -1);
+    octree.nodeColor.assign(poolSize, 0u);
+    octree.nodePool[0] = 8;
+
+    for (int64_t level = 1; level <= m_depth; level++)
+    {
+        const auto& nodes = prefixes[level];
+        const auto& parents = prefixes[level - 1];
+        const int levelStart = octree.levelStartIndices[level - 1];
+        std::for_each(std::execution::par, nodes.begin(), nodes.end(), [&](const uint32_t& code)
+        {
+            const size_t k = &code - nodes.data();
+            const size_t parent = std::lower_bound(parents.begin(), parents.end(), code >> 3) - parents.begin();
+            const size_t index = levelStart + 8 * parent + (code & 7);
+            if (level < m_depth)
+                octree.nodePool[index] = octree.levelStartIndices[level] + 8 * static_cast<int>(k);
+            else
+                octree.nodeColor[index] = static_cast<GLuint>(voxels[k]);
+        });
+    }
+    return octree;
+}
+
+void SparseVoxelOctreeBuilder::mipmap(SparseVoxelOctreeData& octree)
+{
+    TRACE_SCOPE("SparseVoxelOctreeBuilder::mipmap");
+
+    const auto mipmapNode = [&](const GLint& children)
+    {
+        if (children <= 0)
+            return;
+        const size_t index = &children - octree.nodePool.data();
+        octree.nodeColor[index] = mipmapColor(&octree.nodeColor[children]);
+    };
+
+    const auto& starts = octree.levelStartIndices;
+    for (int64_t level = static_cast<int64_t>(starts.size()) - 3; level >= 0; level--)
+        std::for_each(std::execution::par, octree.nodePool.begin() + starts[level], octree.nodePool.begin() + starts[level + 1], mipmapNode);
+    mipmapNode(octree.nodePool[0]);
+}
+
+SparseVoxelOctreeData SparseVoxelOctreeBuilder::build(const std::vector<std::shared_ptr<Mesh>>& scene) const
+{
+    auto octree = buildTree(voxelize(scene));
+    mipmap(octree);
+    return octree;
+}
+
+SparseVoxelOctreeComparison SparseVoxelOctreeBuilder::compare(const SparseVoxelOctreeData& reference, const SparseVoxelOctreeData& other, float colorEpsilon)
+{
+    if (reference.levelStartIndices.size() != other.levelStartIndices.size())
+        throw std::runtime_error("Can not compare octrees of different depth");
+    if (reference.nodePool.empty() || other.nodePool.empty())
+        throw std::runtime_error("Can not compare empty octrees");
+
+    SparseVoxelOctreeComparison result;
+    const size_t depth = reference.levelStartIndices.size() - 1;
+    compareSubtree(reference, other, 0, 0, 0, depth, colorEpsilon, result);
+    return result;
+}
+
+SparseVoxelOctreeData SparseVoxelOctreeBuilder::compress(const SparseVoxelOctreeData& octree, float colorTolerance)
+{
+    TRACE_SCOPE("SparseVoxelOctreeBuilder::compress");
+    if (octree.nodePool.empty() || octree.levelStartIndices.empty())
+        throw std::runtime_error("Can not compress an empty octree");
+    if (colorTolerance < 0.0f)
+        throw std::runtime_error("Color tolerance of the compression must not be negative");
+
+    // hash the groups bottom up, a group is only inserted after all of its children are merged
+    const size_t depth = octree.levelStartIndices.size() - 1;
+    DagCompression compression{ octree, depth, colorTolerance, std::vector<DagLevel>(depth + 1), std::vector<int>(octree.nodePool.size() / 8, -1) };
+    mergeGroup(compression, octree.nodePool[0], 1);
+
+    // write the unique groups level by level, the same layout as buildTree with shared child groups
+    SparseVoxelOctreeData dag;
+    dag.levelStartIndices.push_back(8);
+    for (size_t level = 1; level <= depth; level++)
+        dag.levelStartIndices.push_back(dag.levelStartIndices.back() + 8 * static_cast<int>(compression.levels[level].children.size()));
+
+    const size_t poolSize = dag.levelStartIndices.back();
+    dag.nodePool.assign(poolSize, -1);
+    dag.nodeColor.assign(poolSize, 0u);
+    dag.nodePool[0] = 8;
+    dag.nodeColor[0] = octree.nodeColor[0];
+
+    for (size_t level = 1; level <= depth; level++)
+    {
+        const DagLevel& dagLevel = compression.levels[level];
+        for (size_t group = 0; group < dagLevel.children.size(); group++)
+        {
+            for (size_t tile = 0; tile < 8; tile++)
+            {
+                const size_t index = dag.levelStartIndices[level - 1] + 8 * group + tile;
+                const int child = dagLevel.children[group][tile];
+                if (child >= 0)
+                    dag.nodePool[index] = dag.levelStartIndices[level] + 8 * child;
+                dag.nodeColor[index] = dagLevel.colors[group][tile];
+            }
+        }
+    }
+    return dag;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+/**
+ * \brief node pool and node colors of a sparse voxel octree in the layout of SparseVoxelOctree.
+ * Index 0 is the root, the children of a node are a group of 8 consecutive nodes starting at nodePool[node]
+ * (ordered z * 4 + y * 2 + x). nodePool is -1 for nodes without children. Filled leaves have a color with alpha 1,
+ * inner nodes store the occupancy mask of their children in the alpha byte, so the alpha of every filled node is non-zero
+ */
+struct SparseVoxelOctreeData
+{
+    std::vector<GLint> nodePool;
+    std::vector<GLuint> nodeColor;          // RGBA8, see SparseVoxelOctreeBuilder::packColor and mipmapColor
+    std::vector<int> levelStartIndices;     // first node of every level below the root, the last entry is the end of the pool
+};
+
+/**
+ * \brief differences between two octrees, see SparseVoxelOctreeBuilder::compare
+ */
+struct SparseVoxelOctreeComparison
+{
+    size_t nodes = 0;               // occupied nodes visited in both trees
+    size_t onlyInReference = 0;     // occupied nodes missing in the other tree
+    size_t onlyInOther = 0;         // occupied nodes missing in the reference
+    size_t colorMismatches = 0;     // nodes in both trees with different colors
+
+    bool isEqual() const;
+    std::string toString() const;
+};
+
+/**
+ * \brief CPU reference implementation of the SparseVoxelOctree build.
+ * Voxelizes triangles with a triangle/box overlap test in parallel, sorts the voxels by Morton code and creates
+ * the same node pool and color layout as the GPU, using the same mipmapping rule.
+ * Used as correctness oracle for the GPU build (the compute voxelizer runs the same overlap test) and as benchmark baseline
+ */
+class SparseVoxelOctreeBuilder
+{
+public:
+    /**
+     * \param bmin minimum of the cubic bounding box of the octree
+     * \param bmax maximum of the cubic bounding box of the octree
+     * \param depth number of levels below the root, the voxel grid has 2^depth voxels per axis (at most 10)
+     */
+    SparseVoxelOctreeBuilder(glm::vec3 bmin, glm::vec3 bmax, size_t depth);
+
+    /**
+     * \brief returns all voxels overlapped by a triangle of the scene, sorted and without duplicates.
+     * A voxel is its Morton code in the upper 32 bits and its packed color in the lower, the albedo of the mesh.
+     * Voxels of several meshes keep the largest packed color like the GPU build
+     */
+    std::vector<uint64_t> voxelize(const std::vector<std::shared_ptr<Mesh>>& scene) const;
+
+    /**
+     * \brief creates the nodes for the voxels and the leaf colors, without mipmapping
+     * \param voxels as returned by voxelize
+     */
+    SparseVoxelOctreeData buildTree(const std::vector<uint64_t>& voxels) const;
+
+    /**
+     * \brief averages the colors of the children into the inner nodes, bottom up like MipMapNodes.comp
+     */
+    static void mipmap(SparseVoxelOctreeData& octree);
+
+    /**
+     * \brief voxelize, buildTree and mipmap
+     */
+    SparseVoxelOctreeData build(const std::vector<std::shared_ptr<Mesh>>& scene) const;
+
+    /**
+     * \brief compares two mipmapped octrees structurally, the order of the groups in the node pool may differ.
+     * Nodes without color count as empty
+     * \param reference octree to compare against, e.g. from the CPU builder
+     * \param other octree to check, e.g. read back from the GPU
+     * \param colorEpsilon largest difference per color channel that counts as equal, by default one step of the 8 bit channels
+     */
+    static SparseVoxelOctreeComparison compare(const SparseVoxelOctreeData& reference, const SparseVoxelOctreeData& other, float colorEpsilon = 1.5f / 255.0f);
+
+    /**
+     * \brief merges identical subtrees of a mipmapped octree into a directed acyclic graph with the same layout.
+     * Groups of 8 siblings are hashed bottom up and shared if their colors and merged children are equal, empty subtrees are removed.
+     * Nodes still store child pointers and colors, so the result is traced like the octree
+     * \param colorTolerance colors are quantized to steps of this size before comparing, 0 compares them exactly.
+     * Merged groups keep the colors of their first occurrence
+     */
+    static SparseVoxelOctreeData compress(const SparseVoxelOctreeData& octree, float colorTolerance = 0.0f);
+
+    static uint32_t encodeMorton(glm::uvec3 position);
+    static glm::uvec3 decodeMorton(uint32_t code);
+
+    /**
+     * \brief packs a color into RGBA8 like packNodeColor in nodeColor.glsl
+     */
+    static GLuint packColor(glm::vec4 color);
+    static glm::vec4 unpackColor(GLuint color);
+
+    /**
+     * \brief returns the packed color of an inner node from the colors of its 8 children like mipmapNodeColor in nodeColor.glsl,
+     * the average of the filled children with their occupancy mask in the alpha byte
+     */
+    static GLuint mipmapColor(const GLuint* childColors);
+
+private:
+    void voxelizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, GLuint color, std::vector<uint64_t>& voxels) const;
+
+    glm::vec3 m_bmin;
+    glm::vec3 m_bmax;
+    int64_t m_depth;
+    int64_t m_N;
+};
@@ -0,0 +1,217 @@
+#include "SparseVoxelOctreeConeTracer.h"
+#include "IO/ModelImporter.h"
+#include "Utils/GLStateCache.h"
+#include "Utils/GPUProfiler.h"
+#include "imgui/imgui.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+SparseVoxelOctreeConeTracer::SparseVoxelOctreeConeTracer(int width, int height, Quality quality)
+    : m_width(width), m_height(height), m_quality(quality)
+{
+    m_viewUniform = std::make_shared<Uniform<glm::mat4>>("viewMatrix", glm::mat4(1.0f));
+    m_inverseViewUniform = std::make_shared<Uniform<glm::mat4>>("inverseViewMatrix", glm::mat4(1.0f));
+    m_projectionUniform = std::make_shared<Uniform<glm::mat4>>("projectionMatrix", glm::mat4(1.0f));
+    m_bminUniform = std::make_shared<Uniform<glm::vec3>>("bmin", glm::vec3(0.0f));
+    m_bmaxUniform = std::make_shared<Uniform<glm::vec3>>("bmax", glm::vec3(0.0f));
+    m_octreeDepthUniform = std::make_shared<Uniform<int>>("octreeDepth", 1);
+    m_useBrickPoolUniform = std::make_shared<Uniform<bool>>("useBrickPool", false);
+    m_brickPoolUniform = std::make_shared<Uniform<GLuint64>>("brickPool", 0);
+    m_resolutionScaleUniform = std::make_shared<Uniform<int>>("resolutionScale", 1);
+    m_coneCountUniform = std::make_shared<Uniform<int>>("coneCount", 6);
+    m_maxStepsUniform = std::make_shared<Uniform<int>>("maxSteps", 32);
+    m_stepFactorUniform = std::make_shared<Uniform<float>>("stepFactor", 0.5f);
+    m_maxDistanceUniform = std::make_shared<Uniform<float>>("maxDistance", m_maxDistance);
+    m_ambientUniform = std::make_shared<Uniform<glm::vec3>>("ambient", m_ambient);
+    m_indirectIntensityUniform = std::make_shared<Uniform<float>>("indirectIntensity", m_indirectIntensity);
+
+    m_gBuffer = std::make_shared<Texture>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+    m_gBuffer->initWithoutData(width, height, GL_RGBA32F);
+    m_gBufferFrameBuffer = std::make_unique<FrameBuffer>(std::vector<std::shared_ptr<Texture>>{ m_gBuffer }, true);
+    const GLuint64 gBufferHandle = m_gBuffer->generateHandle();
+
+    // the half resolution texture is allocated up front, so switching the preset does not reallocate anything
+    m_tracedAmbient = std::make_shared<Image>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+    m_tracedAmbient->initWithoutData((width + 1) / 2, (height + 1) / 2, GL_RGBA16F);
+    m_tracedAmbientImageHandle = m_tracedAmbient->generateImageHandle(GL_RGBA16F, GL_FALSE);
+    const GLuint64 tracedAmbientHandle = m_tracedAmbient->Texture::generateHandle();
+
+    m_ambientTexture = std::make_shared<Image>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+    m_ambientTexture->initWithoutData(width, height, GL_RGBA16F);
+    m_ambientImageHandle = m_ambientTexture->generateImageHandle(GL_RGBA16F, GL_FALSE);
+    m_ambientHandle = m_ambientTexture->Texture::generateHandle();
+    m_traceImageUniform = std::make_shared<Uniform<GLuint64>>("ambientImage", m_ambientImageHandle);
+
+    m_gBufferProgram.addUniform(m_viewUniform);
+    m_gBufferProgram.addUniform(m_projectionUniform);
+
+    const auto gBufferUniform = std::make_shared<Uniform<GLuint64>>("gBuffer", gBufferHandle);
+    m_traceProgram.addUniform(gBufferUniform);
+    m_traceProgram.addUniform(m_traceImageUniform);
+    m_traceProgram.addUniform(m_inverseViewUniform);
+    m_traceProgram.addUniform(m_projectionUniform);
+    m_traceProgram.addUniform(m_bminUniform);
+    m_traceProgram.addUniform(m_bmaxUniform);
+    m_traceProgram.addUniform(m_octreeDepthUniform);
+    m_traceProgram.addUniform(m_useBrickPoolUniform);
+    m_traceProgram.addUniform(m_brickPoolUniform);
+    m_traceProgram.addUniform(m_resolutionScaleUniform);
+    m_traceProgram.addUniform(m_coneCountUniform);
+    m_traceProgram.addUniform(m_maxStepsUniform);
+    m_traceProgram.addUniform(m_stepFactorUniform);
+    m_traceProgram.addUniform(m_maxDistanceUniform);
+    m_traceProgram.addUniform(m_ambientUniform);
+    m_traceProgram.addUniform(m_indirectIntensityUniform);
+
+    m_upsampleProgram.addUniform(gBufferUniform);
+    m_upsampleProgram.addUniform(std::make_shared<Uniform<GLuint64>>("tracedAmbient", tracedAmbientHandle));
+    m_upsampleProgram.addUniform(std::make_shared<Uniform<GLuint64>>("ambientImage", m_ambientImageHandle));
+    m_upsampleProgram.addUniform(m_ambientUniform);
+
+    setQuality(quality);
+}
+
+void SparseVoxelOctreeConeTracer::update(const SparseVoxelOctree& svo, const ModelImporter& scene, const glm::mat4& view, const glm::mat4& projection)
+{
+    m_viewUniform->setContent(view);
+    m_inverseViewUniform->setContent(glm::inverse(view));
+    m_projectionUniform->setContent(projection);
+    m_bminUniform->setContent(svo.getBMin());
+    m_bmaxUniform->setContent(svo.getBMax());
+    m_octreeDepthUniform->setContent(static_cast<int>(svo.getDepth()));
+    // the atlas is replaced when the node pool grows, so its handle is set every frame
+    m_useBrickPoolUniform->setContent(svo.hasBrickPool());
+    m_brickPoolUniform->setContent(svo.getBrickPoolHandle());
+
+    {
+        GPUProfileScope scope("ambient prepass");
+        // the normals and depths must not be blended, back faces are drawn with flipped normals
+        const bool blend = GLStateCache::isEnabled(GL_BLEND);
+        const bool depthTest = GLStateCache::isEnabled(GL_DEPTH_TEST);
+        const bool cullFace = GLStateCache::isEnabled(GL_CULL_FACE);
+        const GLboolean depthMask = GLStateCache::getDepthMask();
+        GLStateCache::disable(GL_BLEND);
+        GLStateCache::enable(GL_DEPTH_TEST);
+        GLStateCache::disable(GL_CULL_FACE);
+        GLStateCache::depthMask(GL_TRUE);
+
+        m_gBufferFrameBuffer->bind();
+        const glm::vec4 noGeometry(0.0f);
+        glClearNamedFramebufferfv(m_gBufferFrameBuffer->getName(), GL_COLOR, 0, glm::value_ptr(noGeometry));
+        glClearNamedFramebufferfi(m_gBufferFrameBuffer->getName(), GL_DEPTH_STENCIL, 0, 1.0f, 0);
+        scene.multiDrawCulled(m_gBufferProgram, projection * view);
+        m_gBufferFrameBuffer->unbind();
+
+        GLStateCache::setEnabled(GL_BLEND, blend);
+        GLStateCache::setEnabled(GL_DEPTH_TEST, depthTest);
+        GLStateCache::setEnabled(GL_CULL_FACE, cullFace);
+        GLStateCache::depthMask(depthMask);
+    }
+
+    const Settings settings = getSettings(m_quality);
+    {
+        GPUProfileScope scope("ambient cone trace");
+        // at half resolution the traced pixels are written into the half resolution texture and upsampled afterwards
+        const int tracedWidth = settings.halfResolution ? m_tracedAmbient->getWidth() : m_width;
+        const int tracedHeight = settings.halfResolution ? m_tracedAmbient->getHeight() : m_height;
+        svo.bind();
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        m_traceProgram.use();
+        glDispatchCompute((tracedWidth + 7) / 8, (tracedHeight + 7) / 8, 1);
+    }
+
+    if (settings.halfResolution)
+    {
+        GPUProfileScope scope("ambient upsample");
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        m_upsampleProgram.use();
+        glDispatchCompute((m_width + 7) / 8, (m_height + 7) / 8, 1);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+GLuint64 SparseVoxelOctreeConeTracer::getAmbientHandle() const
+{
+    return m_ambientHandle;
+}
+
+void SparseVoxelOctreeConeTracer::setQuality(Quality quality)
+{
+    m_quality = quality;
+    const Settings settings = getSettings(quality);
+    m_resolutionScaleUniform->setContent(settings.halfResolution ? 2 : 1);
+    m_coneCountUniform->setContent(settings.coneCount);
+    m_maxStepsUniform->setContent(settings.maxSteps);
+    m_stepFactorUniform->setContent(settings.stepFactor);
+    m_traceImageUniform->setContent(settings.halfResolution ? m_tracedAmbientImageHandle : m_ambientImageHandle);
+}
+
+SparseVoxelOctreeConeTracer::Quality SparseVoxelOctreeConeTracer::getQuality() const
+{
+    return m_quality;
+}
+
+SparseVoxelOctreeConeTracer::Settings SparseVoxelOctreeConeTracer::getSettings(Quality quality)
+{
+    switch (quality)
+    {
+    case Quality::performance:
+        return { true, 4, 16, 1.0f };
+    case Quality::quality:
+        return { false, 9, 48, 0.33f };
+    case Quality::balanced:
+    default:
+        return { true, 6, 32, 0.5f };
+    }
+}
+
+void SparseVoxelOctreeConeTracer::setAmbient(const glm::vec3& ambient)
+{
+    m_ambient = ambient;
+    m_ambientUniform->setContent(ambient);
+}
+
+void SparseVoxelOctreeConeTracer::setIndirectIntensity(float intensity)
+{
+    m_indirectIntensity = intensity;
+    m_indirectIntensityUniform->setContent(intensity);
+}
+
+void SparseVoxelOctreeConeTracer::setMaxDistance(float distance)
+{
+    m_maxDistance = distance;
+    m_maxDistanceUniform->setContent(distance);
+}
+
+bool SparseVoxelOctreeConeTracer::showGUIContent()
+{
+    bool changed = false;
+    int quality = static_cast<int>(m_quality);
+    if (ImGui::Combo("Quality", &quality, "Performance (half resolution, 4 cones)\0Balanced (half resolution, 6 cones)\0Quality (full resolution, 9 cones)\0"))
+    {
+        setQuality(static_cast<Quality>(quality));
+        changed = true;
+    }
+    if (ImGui::ColorEdit3("Ambient", glm::value_ptr(m_ambient)))
+    {
+        setAmbient(m_ambient);
+        changed = true;
+    }
+    bool indirect = m_indirectIntensity > 0.0f;
+    if (ImGui::Checkbox("Indirect light", &indirect))
+    {
+        setIndirectIntensity(indirect ? 1.0f : 0.0f);
+        changed = true;
+    }
+    if (indirect && ImGui::SliderFloat("Indirect intensity", &m_indirectIntensity, 0.0f, 4.0f))
+    {
+        setIndirectIntensity(m_indirectIntensity);
+        changed = true;
+    }
+    if (ImGui::SliderFloat("Cone length", &m_maxDistance, 0.01f, 1.0f))
+    {
+        setMaxDistance(m_maxDistance);
+        changed = true;
+    }
+    return changed;
+}
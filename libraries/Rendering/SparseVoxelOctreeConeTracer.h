@@ -0,0 +1,129 @@
+#pragma once
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "Binding.h"
+#include "FrameBuffer.h"
+#include "Image.h"
+#include "ShaderProgram.h"
+#include "SparseVoxelOctree.h"
+#include "Texture.h"
+
+class ModelImporter;
+
+/**
+ * \brief screen space ambient occlusion and one bounce of indirect diffuse light by cone tracing a SparseVoxelOctree of the scene,
+ * replaces the constant ambient light of common/light.glsl in shaders that use getAmbient of common/ambient.glsl.
+ * A prepass (ConeTraceGBuffer.vert/frag) renders the normals and view depths of the scene, ConeTraceAmbient.comp traces a few cones
+ * per pixel over the hemisphere of the normal through the mipmapped levels of the octree, trilinearly filtered if it has a brick pool.
+ * The sky and the voxels the cones see are lit by the constant ambient light, so the result is the ambient light reaching the pixel.
+ * The reflection off the voxels, colored by the albedo of their meshes, is opt-in with setIndirectIntensity. At half resolution UpsampleAmbient.comp upsamples the result with weights of the
+ * depth and normal differences. The cost per frame is bounded by the resolution, cones and steps of the quality preset
+ */
+class SparseVoxelOctreeConeTracer
+{
+public:
+    /**
+     * \brief presets from cheap to accurate, see getSettings
+     */
+    enum class Quality
+    {
+        performance,
+        balanced,
+        quality
+    };
+
+    struct Settings
+    {
+        bool halfResolution;
+        int coneCount;      // cones per traced pixel, at least 2
+        int maxSteps;       // samples per cone
+        float stepFactor;   // distance of the samples along a cone relative to its diameter
+    };
+
+    /**
+     * \param width width of the framebuffer the ambient light is used in
+     * \param height height of the framebuffer the ambient light is used in
+     */
+    SparseVoxelOctreeConeTracer(int width, int height, Quality quality = Quality::balanced);
+
+    /**
+     * \brief renders the prepass of the scene and traces the ambient light of the current frame.
+     * Overwrites the bindings 2 and 3 of the shader storage buffers with the octree
+     */
+    void update(const SparseVoxelOctree& svo, const ModelImporter& scene, const glm::mat4& view, const glm::mat4& projection);
+
+    /**
+     * \brief bindless handle of the full resolution ambient texture (rgb ambient light, a ambient occlusion) for ambientTexture of common/ambient.glsl
+     */
+    GLuint64 getAmbientHandle() const;
+
+    void setQuality(Quality quality);
+    Quality getQuality() const;
+    static Settings getSettings(Quality quality);
+
+    /**
+     * \brief constant ambient light that lights the sky and the voxels
+     */
+    void setAmbient(const glm::vec3& ambient);
+
+    /**
+     * \brief factor of the light reflected by the voxels, 0 (the default) for ambient occlusion only
+     */
+    void setIndirectIntensity(float intensity);
+
+    /**
+     * \brief length of the cones as a fraction of the octree size
+     */
+    void setMaxDistance(float distance);
+
+    /**
+     * \brief shows the preset and the light parameters, returns true if something changed
+     */
+    bool showGUIContent();
+
+private:
+    int m_width;
+    int m_height;
+    Quality m_quality;
+    glm::vec3 m_ambient{ 0.3f };
+    float m_indirectIntensity = 0.0f;
+    float m_maxDistance = 0.25f;
+
+    Shader m_gBufferVertexShader{ "SparseVoxelOctree/ConeTraceGBuffer.vert", GL_VERTEX_SHADER, BufferBindings::g_definitions };
+    Shader m_gBufferFragmentShader{ "SparseVoxelOctree/ConeTraceGBuffer.frag", GL_FRAGMENT_SHADER };
+    Shader m_traceShader{ "SparseVoxelOctree/ConeTraceAmbient.comp", GL_COMPUTE_SHADER };
+    Shader m_upsampleShader{ "SparseVoxelOctree/UpsampleAmbient.comp", GL_COMPUTE_SHADER };
+    ShaderProgram m_gBufferProgram{ m_gBufferVertexShader, m_gBufferFragmentShader };
+    ShaderProgram m_traceProgram{ { m_traceShader } };
+    ShaderProgram m_upsampleProgram{ { m_upsampleShader } };
+
+    std::shared_ptr<Uniform<glm::mat4>> m_viewUniform;
+    std::shared_ptr<Uniform<glm::mat4>> m_inverseViewUniform;
+    std::shared_ptr<Uniform<glm::mat4>> m_projectionUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_bminUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_bmaxUniform;
+    std::shared_ptr<Uniform<int>> m_octreeDepthUniform;
+    std::shared_ptr<Uniform<bool>> m_useBrickPoolUniform;
+    std::shared_ptr<Uniform<GLuint64>> m_brickPoolUniform;
+    std::shared_ptr<Uniform<int>> m_resolutionScaleUniform;
+    std::shared_ptr<Uniform<int>> m_coneCountUniform;
+    std::shared_ptr<Uniform<int>> m_maxStepsUniform;
+    std::shared_ptr<Uniform<float>> m_stepFactorUniform;
+    std::shared_ptr<Uniform<float>> m_maxDistanceUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_ambientUniform;
+    std::shared_ptr<Uniform<float>> m_indirectIntensityUniform;
+    std::shared_ptr<Uniform<GLuint64>> m_traceImageUniform;
+
+    std::shared_ptr<Texture> m_gBuffer;             // rgba32f, world space normal and view depth
+    std::unique_ptr<FrameBuffer> m_gBufferFrameBuffer;
+    std::shared_ptr<Image> m_tracedAmbient;         // rgba16f, half resolution
+    std::shared_ptr<Image> m_ambientTexture;        // rgba16f, full resolution
+    GLuint64 m_tracedAmbientImageHandle;
+    GLuint64 m_ambientImageHandle;
+    GLuint64 m_ambientHandle;
+};
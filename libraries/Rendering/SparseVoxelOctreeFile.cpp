@@ -0,0 +1,256 @@
+#include "SparseVoxelOctreeFile.h"
+#include "Utils/Tracer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(SparseVoxelOctreeFileHeader) == 48, "the header is written as is");
+static_assert(sizeof(SparseVoxelOctreeFileChunk) == 32, "the chunk table is written as is");
+
+namespace
+{
+    constexpr char magic[4] = { 'S', 'V', 'O', '1' };
+    constexpr size_t dataAlignment = 16;
+
+    size_t align(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // true if count elements of the given size starting at offset lie inside the file
+    bool fits(uint64_t offset, uint64_t count, size_t elementSize, size_t fileSize)
+    {
+        return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    }
+}
+
+void SparseVoxelOctreeFile::write(const std::experimental::filesystem::path& file, const SparseVoxelOctreeData& octree, glm::vec3 bmin, glm::vec3 bmax, bool chunkPerLevel)
+{
+    TRACE_SCOPE("SparseVoxelOctreeFile::write");
+    if (octree.levelStartIndices.empty() || octree.nodePool.size() != static_cast<size_t>(octree.levelStartIndices.back()) || octree.nodeColor.size() != octree.nodePool.size())
+        throw std::runtime_error("Can not write an octree with inconsistent sizes");
+
+    SparseVoxelOctreeFileHeader header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = s_version;
+    header.depth = static_cast<uint32_t>(octree.levelStartIndices.size() - 1);
+    header.bmin = bmin;
+    header.bmax = bmax;
+    header.nodeCount = octree.nodePool.size();
+
+    // the root group and every level, or all nodes at once
+    std::vector<SparseVoxelOctreeFileChunk> chunks;
+    if (chunkPerLevel)
+    {
+        uint64_t first = 0;
+        for (const int end : octree.levelStartIndices)
+        {
+            chunks.push_back({ first, end - first, 0, 0 });
+            first = end;
+        }
+    }
+    else
+        chunks.push_back({ 0, header.nodeCount, 0, 0 });
+    header.chunkCount = static_cast<uint32_t>(chunks.size());
+
+    size_t offset = sizeof(header) + octree.levelStartIndices.size() * sizeof(int32_t);
+    const size_t chunkTableOffset = align(offset, alignof(SparseVoxelOctreeFileChunk));
+    offset = align(chunkTableOffset + chunks.size() * sizeof(SparseVoxelOctreeFileChunk), dataAlignment);
+    for (auto& chunk : chunks)
+    {
+        chunk.poolOffset = offset;
+        offset = align(offset + chunk.nodeCount * sizeof(GLint), dataAlignment);
+        chunk.colorOffset = offset;
+        offset = align(offset + chunk.nodeCount * sizeof(GLuint), dataAlignment);
+    }
+
+    std::ofstream out(file, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Could not open " + file.string() + " for writing");
+
+    const auto pad = [&out](size_t position)
+    {
+        static const char zeros[dataAlignment] = {};
+        out.write(zeros, position - static_cast<size_t>(out.tellp()));
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const std::vector<int32_t> levelStartIndices(octree.levelStartIndices.begin(), octree.levelStartIndices.end());
+    out.write(reinterpret_cast<const char*>(levelStartIndices.data()), levelStartIndices.size() * sizeof(int32_t));
+    pad(chunkTableOffset);
+    out.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(SparseVoxelOctreeFileChunk));
+    for (const auto& chunk : chunks)
+    {
+        pad(chunk.poolOffset);
+        out.write(reinterpret_cast<const char*>(octree.nodePool.data() + chunk.firstNode), chunk.nodeCount * sizeof(GLint));
+        pad(chunk.colorOffset);
+        out.write(reinterpret_cast<const char*>(octree.nodeColor.data() + chunk.firstNode), chunk.nodeCount * sizeof(GLuint));
+    }
+    pad(offset);
+
+    if (!out)
+        throw std::runtime_error("Could not write " + file.string());
+}
+
+SparseVoxelOctreeFile::SparseVoxelOctreeFile(const std::experimental::filesystem::path& file)
+{
+    TRACE_SCOPE("SparseVoxelOctreeFile::map");
+    const std::string fileString = file.string();
+
+#ifdef _WIN32
+    m_fileHandle = CreateFileA(fileString.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+    {
+        m_fileHandle = nullptr;
+        throw std::runtime_error("Could not open octree file " + fileString);
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(m_fileHandle, &fileSize);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    if (m_size > 0)
+    {
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle)
+            m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int fd = open(fileString.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Could not open octree file " + fileString);
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        m_size = static_cast<size_t>(fileStat.st_size);
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            // the chunks are read front to back by the upload
+            madvise(mapping, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(mapping);
+        }
+    }
+    // the mapping stays valid without the descriptor
+    close(fd);
+#endif
+
+    try
+    {
+        if (!m_data)
+            throw std::runtime_error("Could not map octree file " + fileString);
+        if (m_size < sizeof(m_header))
+            throw std::runtime_error("Octree file " + fileString + " is too small");
+
+        std::memcpy(&m_header, m_data, sizeof(m_header));
+        if (std::memcmp(m_header.magic, magic, sizeof(magic)) != 0)
+            throw std::runtime_error(fileString + " is not an octree file");
+        if (m_header.version != s_version)
+            throw std::runtime_error("Octree file " + fileString + " has version " + std::to_string(m_header.version) + ", expected " + std::to_string(s_version));
+        if (m_header.depth < 1 || m_header.depth > 10 || m_header.chunkCount == 0)
+            throw std::runtime_error("Octree file " + fileString + " has an invalid depth or no chunks");
+
+        const size_t levelOffset = sizeof(m_header);
+        const size_t chunkTableOffset = align(levelOffset + (m_header.depth + 1) * sizeof(int32_t), alignof(SparseVoxelOctreeFileChunk));
+        if (!fits(chunkTableOffset, m_header.chunkCount, sizeof(SparseVoxelOctreeFileChunk), m_size))
+            throw std::runtime_error("Octree file " + fileString + " is truncated");
+
+        const std::vector<int> levelStartIndices = getLevelStartIndices();
+        if (levelStartIndices.front() != 8 || static_cast<uint64_t>(levelStartIndices.back()) != m_header.nodeCount
+            || !std::is_sorted(levelStartIndices.begin(), levelStartIndices.end()))
+            throw std::runtime_error("Octree file " + fileString + " has invalid level start indices");
+
+        // the chunks have to cover all nodes in order, the node pool values are trusted
+        m_chunks.resize(m_header.chunkCount);
+        std::memcpy(m_chunks.data(), m_data + chunkTableOffset, m_chunks.size() * sizeof(SparseVoxelOctreeFileChunk));
+        uint64_t nextNode = 0;
+        for (const auto& chunk : m_chunks)
+        {
+            if (chunk.firstNode != nextNode || chunk.poolOffset % dataAlignment != 0 || chunk.colorOffset % dataAlignment != 0
+                || !fits(chunk.poolOffset, chunk.nodeCount, sizeof(GLint), m_size) || !fits(chunk.colorOffset, chunk.nodeCount, sizeof(GLuint), m_size))
+                throw std::runtime_error("Octree file " + fileString + " has an invalid chunk table");
+            nextNode += chunk.nodeCount;
+        }
+        if (nextNode != m_header.nodeCount)
+            throw std::runtime_error("Octree file " + fileString + " has an invalid chunk table");
+    }
+    catch (...)
+    {
+        unmap();
+        throw;
+    }
+}
+
+SparseVoxelOctreeFile::~SparseVoxelOctreeFile()
+{
+    unmap();
+}
+
+void SparseVoxelOctreeFile::unmap()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle)
+        CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const SparseVoxelOctreeFileHeader& SparseVoxelOctreeFile::getHeader() const
+{
+    return m_header;
+}
+
+std::vector<int> SparseVoxelOctreeFile::getLevelStartIndices() const
+{
+    std::vector<int32_t> levelStartIndices(m_header.depth + 1);
+    std::memcpy(levelStartIndices.data(), m_data + sizeof(m_header), levelStartIndices.size() * sizeof(int32_t));
+    return std::vector<int>(levelStartIndices.begin(), levelStartIndices.end());
+}
+
+const std::vector<SparseVoxelOctreeFileChunk>& SparseVoxelOctreeFile::getChunks() const
+{
+    return m_chunks;
+}
+
+const GLint* SparseVoxelOctreeFile::getNodePool(const SparseVoxelOctreeFileChunk& chunk) const
+{
+    return reinterpret_cast<const GLint*>(m_data + chunk.poolOffset);
+}
+
+const GLuint* SparseVoxelOctreeFile::getNodeColor(const SparseVoxelOctreeFileChunk& chunk) const
+{
+    return reinterpret_cast<const GLuint*>(m_data + chunk.colorOffset);
+}
+
+SparseVoxelOctreeData SparseVoxelOctreeFile::readData() const
+{
+    SparseVoxelOctreeData octree;
+    octree.levelStartIndices = getLevelStartIndices();
+    octree.nodePool.reserve(m_header.nodeCount);
+    octree.nodeColor.reserve(m_header.nodeCount);
+    for (const auto& chunk : m_chunks)
+    {
+        octree.nodePool.insert(octree.nodePool.end(), getNodePool(chunk), getNodePool(chunk) + chunk.nodeCount);
+        octree.nodeColor.insert(octree.nodeColor.end(), getNodeColor(chunk), getNodeColor(chunk) + chunk.nodeCount);
+    }
+    return octree;
+}
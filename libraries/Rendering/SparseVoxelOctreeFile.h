@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <experimental/filesystem>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include <glm/glm.hpp>
+
+#include "SparseVoxelOctreeBuilder.h"
+
+/**
+ * \brief fixed size start of a sparse voxel octree file, followed by the level start indices (int32, depth + 1),
+ * the chunk table and the data of the chunks. All values are little endian
+ */
+struct SparseVoxelOctreeFileHeader
+{
+    char magic[4];          // "SVO1"
+    uint32_t version;
+    uint32_t depth;
+    uint32_t chunkCount;
+    glm::vec3 bmin;
+    glm::vec3 bmax;
+    uint64_t nodeCount;
+};
+
+/**
+ * \brief consecutive range of nodes stored together, their node pool entries at poolOffset and colors at colorOffset
+ */
+struct SparseVoxelOctreeFileChunk
+{
+    uint64_t firstNode;
+    uint64_t nodeCount;
+    uint64_t poolOffset;    // bytes from the start of the file, 16 byte aligned
+    uint64_t colorOffset;   // bytes from the start of the file, 16 byte aligned
+};
+
+/**
+ * \brief on-disk format of a baked sparse voxel octree or DAG in the layout of SparseVoxelOctreeData.
+ * The node pool and colors are stored as in the GPU buffers, either as one chunk or as one chunk per level
+ * (the root group first), so they can be uploaded straight from the mapped file.
+ * Opening a file maps it read-only, the chunks are only read from disk when they are accessed
+ */
+class SparseVoxelOctreeFile
+{
+public:
+    // 2: colors packed as RGBA8
+    static constexpr uint32_t s_version = 2;
+
+    /**
+     * \brief writes an octree, throws if the file can not be written
+     * \param octree node pool, colors and level start indices, e.g. from SparseVoxelOctree::readBack
+     * \param bmin minimum of the cubic bounding box of the octree
+     * \param bmax maximum of the cubic bounding box of the octree
+     * \param chunkPerLevel store every level as a separate chunk instead of one chunk for all nodes
+     */
+    static void write(const std::experimental::filesystem::path& file, const SparseVoxelOctreeData& octree, glm::vec3 bmin, glm::vec3 bmax, bool chunkPerLevel = true);
+
+    /**
+     * \brief maps the file, throws if it can not be opened or is not a valid octree file
+     */
+    explicit SparseVoxelOctreeFile(const std::experimental::filesystem::path& file);
+    ~SparseVoxelOctreeFile();
+
+    SparseVoxelOctreeFile(const SparseVoxelOctreeFile&) = delete;
+    SparseVoxelOctreeFile& operator=(const SparseVoxelOctreeFile&) = delete;
+
+    const SparseVoxelOctreeFileHeader& getHeader() const;
+
+    std::vector<int> getLevelStartIndices() const;
+
+    const std::vector<SparseVoxelOctreeFileChunk>& getChunks() const;
+
+    /**
+     * \brief returns the node pool entries of a chunk inside the mapped file
+     */
+    const GLint* getNodePool(const SparseVoxelOctreeFileChunk& chunk) const;
+
+    /**
+     * \brief returns the packed colors of a chunk inside the mapped file
+     */
+    const GLuint* getNodeColor(const SparseVoxelOctreeFileChunk& chunk) const;
+
+    /**
+     * \brief copies the whole octree out of the file, e.g. to compare or compress it on the CPU
+     */
+    SparseVoxelOctreeData readData() const;
+
+private:
+    void unmap();
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+
+    SparseVoxelOctreeFileHeader m_header;
+    std::vector<SparseVoxelOctreeFileChunk> m_chunks;
+};
@@ -0,0 +1,107 @@
+#include "SparseVoxelOctreeRenderer.h"
+#include "Utils/GLStateCache.h"
+#include "Utils/GPUProfiler.h"
+
+#include <array>
+
+SparseVoxelOctreeRenderer::SparseVoxelOctreeRenderer(int width, int height)
+    : m_width(width), m_height(height)
+{
+    m_viewUniform = std::make_shared<Uniform<glm::mat4>>("viewMatrix", glm::mat4(1.0f));
+    m_projectionUniform = std::make_shared<Uniform<glm::mat4>>("projectionMatrix", glm::mat4(1.0f));
+    m_inverseViewProjectionUniform = std::make_shared<Uniform<glm::mat4>>("inverseViewProjection", glm::mat4(1.0f));
+    m_camPositionUniform = std::make_shared<Uniform<glm::vec3>>("camPosition", glm::vec3(0.0f));
+    m_bminUniform = std::make_shared<Uniform<glm::vec3>>("bmin", glm::vec3(0.0f));
+    m_bmaxUniform = std::make_shared<Uniform<glm::vec3>>("bmax", glm::vec3(0.0f));
+    m_maxLevelUniform = std::make_shared<Uniform<int>>("maxLevel", 10);
+    m_beamTileSizeUniform = std::make_shared<Uniform<int>>("beamTileSize", s_beamTileSize);
+    m_filterBricksUniform = std::make_shared<Uniform<bool>>("filterBricks", false);
+    m_brickPoolUniform = std::make_shared<Uniform<GLuint64>>("brickPool", 0);
+
+    // one texel per tile, rounded up so partial tiles at the border are traced as well
+    m_beamDistances = std::make_shared<Texture>(GL_TEXTURE_2D, GL_NEAREST, GL_NEAREST);
+    m_beamDistances->initWithoutData((width + s_beamTileSize - 1) / s_beamTileSize, (height + s_beamTileSize - 1) / s_beamTileSize, GL_R32F);
+    m_beamFrameBuffer = std::make_unique<FrameBuffer>(std::vector<std::shared_ptr<Texture>>{ m_beamDistances }, false);
+
+    // the beams do not use the interpolated ray directions, they compute the rays of the tile corners
+    m_beamProgram.addUniform(m_inverseViewProjectionUniform);
+    m_beamProgram.addUniform(m_camPositionUniform);
+    m_beamProgram.addUniform(m_bminUniform);
+    m_beamProgram.addUniform(m_bmaxUniform);
+    m_beamProgram.addUniform(m_maxLevelUniform);
+    m_beamProgram.addUniform(m_beamTileSizeUniform);
+    m_beamProgram.addUniform(std::make_shared<Uniform<glm::vec2>>("resolution", glm::vec2(width, height)));
+
+    m_traceProgram.addUniform(m_viewUniform);
+    m_traceProgram.addUniform(m_projectionUniform);
+    m_traceProgram.addUniform(m_camPositionUniform);
+    m_traceProgram.addUniform(m_bminUniform);
+    m_traceProgram.addUniform(m_bmaxUniform);
+    m_traceProgram.addUniform(m_maxLevelUniform);
+    m_traceProgram.addUniform(m_beamTileSizeUniform);
+    m_traceProgram.addUniform(std::make_shared<Uniform<GLuint64>>("beamDistances", m_beamDistances->generateHandle()));
+    m_traceProgram.addUniform(m_filterBricksUniform);
+    m_traceProgram.addUniform(m_brickPoolUniform);
+}
+
+void SparseVoxelOctreeRenderer::draw(const SparseVoxelOctree& svo, const glm::mat4& view, const glm::mat4& projection)
+{
+    m_viewUniform->setContent(view);
+    m_projectionUniform->setContent(projection);
+    m_inverseViewProjectionUniform->setContent(glm::inverse(projection * view));
+    m_camPositionUniform->setContent(glm::vec3(glm::inverse(view)[3]));
+    m_bminUniform->setContent(svo.getBMin());
+    m_bmaxUniform->setContent(svo.getBMax());
+    m_beamTileSizeUniform->setContent(m_beamOptimization ? s_beamTileSize : 0);
+    // the atlas is replaced when the node pool grows, so its handle is set every frame
+    const bool filterBricks = m_brickFiltering && svo.hasBrickPool();
+    m_filterBricksUniform->setContent(filterBricks);
+    m_brickPoolUniform->setContent(filterBricks ? svo.getBrickPoolHandle() : 0);
+    svo.bind();
+
+    if (m_beamOptimization)
+    {
+        GPUProfileScope scope("svo beams");
+        const std::array<GLint, 4> viewport = GLStateCache::getViewport();
+        m_beamFrameBuffer->bind();
+        GLStateCache::viewport(0, 0, m_beamDistances->getWidth(), m_beamDistances->getHeight());
+        m_beamProgram.use();
+        m_quad.draw();
+        m_beamFrameBuffer->unbind();
+        GLStateCache::viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    GPUProfileScope scope("svo trace");
+    m_traceProgram.use();
+    m_quad.draw();
+}
+
+void SparseVoxelOctreeRenderer::setMaxLevel(int maxLevel)
+{
+    m_maxLevelUniform->setContent(maxLevel);
+}
+
+void SparseVoxelOctreeRenderer::setBeamOptimization(bool enabled)
+{
+    m_beamOptimization = enabled;
+}
+
+bool SparseVoxelOctreeRenderer::getBeamOptimization() const
+{
+    return m_beamOptimization;
+}
+
+void SparseVoxelOctreeRenderer::setBrickFiltering(bool enabled)
+{
+    m_brickFiltering = enabled;
+}
+
+bool SparseVoxelOctreeRenderer::getBrickFiltering() const
+{
+    return m_brickFiltering;
+}
+
+void SparseVoxelOctreeRenderer::showReloadShaderGUI()
+{
+    m_traceProgram.showReloadShaderGUI({ m_rayDirShader, m_traceShader }, "Octree trace");
+}
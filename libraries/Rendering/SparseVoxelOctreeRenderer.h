@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "FrameBuffer.h"
+#include "Quad.h"
+#include "ShaderProgram.h"
+#include "SparseVoxelOctree.h"
+#include "Texture.h"
+
+/**
+ * \brief ray traces a SparseVoxelOctree with TraceSparseVoxelOctree.frag into the current framebuffer.
+ * With the beam optimization a low resolution pass (TraceBeams.frag) first traces one cone per tile of s_beamTileSize^2 pixels
+ * and stores the distance every ray of the tile can safely start at. The full resolution pass starts its rays there
+ * instead of at the root and skips tiles without any hit.
+ * With brick filtering the hits of octrees with a brick pool are colored by trilinear filtering of the bricks, see SparseVoxelOctree::setBrickPool
+ */
+class SparseVoxelOctreeRenderer
+{
+public:
+    /**
+     * \param width width of the framebuffer drawn into
+     * \param height height of the framebuffer drawn into
+     */
+    SparseVoxelOctreeRenderer(int width, int height);
+
+    void draw(const SparseVoxelOctree& svo, const glm::mat4& view, const glm::mat4& projection);
+
+    /**
+     * \brief deepest level traced, for level debugging
+     */
+    void setMaxLevel(int maxLevel);
+
+    void setBeamOptimization(bool enabled);
+    bool getBeamOptimization() const;
+
+    void setBrickFiltering(bool enabled);
+    bool getBrickFiltering() const;
+
+    void showReloadShaderGUI();
+
+    static constexpr int s_beamTileSize = 8;
+
+private:
+    int m_width;
+    int m_height;
+    bool m_beamOptimization = true;
+    bool m_brickFiltering = false;
+
+    Shader m_rayDirShader{ "SparseVoxelOctree/sfq_rayDir.vert", GL_VERTEX_SHADER };
+    Shader m_beamShader{ "SparseVoxelOctree/TraceBeams.frag", GL_FRAGMENT_SHADER };
+    Shader m_traceShader{ "SparseVoxelOctree/TraceSparseVoxelOctree.frag", GL_FRAGMENT_SHADER };
+    ShaderProgram m_beamProgram{ m_rayDirShader, m_beamShader };
+    ShaderProgram m_traceProgram{ m_rayDirShader, m_traceShader };
+
+    std::shared_ptr<Uniform<glm::mat4>> m_viewUniform;
+    std::shared_ptr<Uniform<glm::mat4>> m_projectionUniform;
+    std::shared_ptr<Uniform<glm::mat4>> m_inverseViewProjectionUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_camPositionUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_bminUniform;
+    std::shared_ptr<Uniform<glm::vec3>> m_bmaxUniform;
+    std::shared_ptr<Uniform<int>> m_maxLevelUniform;
+    std::shared_ptr<Uniform<int>> m_beamTileSizeUniform;
+    std::shared_ptr<Uniform<bool>> m_filterBricksUniform;
+    std::shared_ptr<Uniform<GLuint64>> m_brickPoolUniform;
+
+    std::shared_ptr<Texture> m_beamDistances;      // r32f, one texel per tile
+    std::unique_ptr<FrameBuffer> m_beamFrameBuffer;
+    Quad m_quad;
+};
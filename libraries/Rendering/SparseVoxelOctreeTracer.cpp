@@ -0,0 +1,212 @@
+#include "SparseVoxelOctreeTracer.h"
+#include "Utils/Tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <execution>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <glm/gtx/component_wise.hpp>
+
+namespace
+{
+    constexpr size_t maxDepth = 10;
+
+    // node on the traversal stack, t0 and t1 are the ray parameters of its lower and upper planes
+    struct Frame
+    {
+        glm::vec3 t0;
+        glm::vec3 t1;
+        glm::ivec3 position;
+        int children;   // first node of the child group
+        int child;      // next child to visit in mirrored order, 8 if all are done
+        GLuint mask;    // occupancy of the children, see SparseVoxelOctreeBuilder::mipmapColor
+    };
+
+    int minAxis(glm::vec3 v)
+    {
+        return v.x <= v.y ? (v.x <= v.z ? 0 : 2) : (v.y <= v.z ? 1 : 2);
+    }
+
+    int maxAxis(glm::vec3 v)
+    {
+        return v.x >= v.y ? (v.x >= v.z ? 0 : 2) : (v.y >= v.z ? 1 : 2);
+    }
+
+    // child of a node the ray enters first, the children on the far side of the center planes crossed before entering
+    int firstChild(glm::vec3 t0, glm::vec3 tm)
+    {
+        const int entryAxis = maxAxis(t0);
+        int child = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (axis != entryAxis && tm[axis] < t0[entryAxis])
+                child |= 1 << axis;
+        }
+        return child;
+    }
+}
+
+bool SparseVoxelOctreeHit::isHit() const
+{
+    return node >= 0;
+}
+
+bool SparseVoxelOctreeTraceComparison::isEqual() const
+{
+    return hitMismatches == 0 && colorMismatches == 0;
+}
+
+std::string SparseVoxelOctreeTraceComparison::toString() const
+{
+    std::stringstream ss;
+    ss << pixels << " pixels, " << hitMismatches << " hit by only one tracer, " << colorMismatches << " with different colors";
+    return ss.str();
+}
+
+SparseVoxelOctreeTracer::SparseVoxelOctreeTracer(SparseVoxelOctreeData octree, glm::vec3 bmin, glm::vec3 bmax)
+    : m_octree(std::move(octree)), m_bmin(bmin), m_bmax(bmax)
+{
+    if (m_octree.levelStartIndices.size() < 2 || m_octree.levelStartIndices.size() > maxDepth + 1
+        || m_octree.nodePool.size() < static_cast<size_t>(m_octree.levelStartIndices.back()) || m_octree.nodeColor.size() < m_octree.nodePool.size())
+        throw std::runtime_error("SparseVoxelOctreeTracer needs an octree with 1 to 10 levels and colors for all nodes");
+    m_depth = m_octree.levelStartIndices.size() - 1;
+}
+
+SparseVoxelOctreeHit SparseVoxelOctreeTracer::trace(const SparseVoxelOctreeRay& ray, size_t level) const
+{
+    SparseVoxelOctreeHit hit;
+    const int maxLevel = static_cast<int>(std::min(level, m_depth));
+
+    // mirror the ray at the center of the octree so all direction components are positive,
+    // the mask mirrors the child indices back
+    glm::vec3 origin = ray.origin;
+    glm::vec3 direction = ray.direction;
+    int mirror = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (direction[axis] < 0.0f)
+        {
+            origin[axis] = m_bmin[axis] + m_bmax[axis] - origin[axis];
+            direction[axis] = -direction[axis];
+            mirror |= 1 << axis;
+        }
+    }
+    // same as the shader, rays parallel to an axis get huge instead of infinite plane distances
+    const glm::vec3 invDirection = 1.0f / glm::max(direction, glm::vec3(1e-7f));
+
+    const glm::vec3 t0 = (m_bmin - origin) * invDirection;
+    const glm::vec3 t1 = (m_bmax - origin) * invDirection;
+    const float tEnter = std::max(glm::compMax(t0), ray.tMin);
+    if (tEnter > std::min(glm::compMin(t1), ray.tMax))
+        return hit;
+
+    const auto& nodePool = m_octree.nodePool;
+    const auto& nodeColor = m_octree.nodeColor;
+    const auto handleNode = [&](int node, int nodeLevel, glm::ivec3 position, float distance)
+    {
+        const glm::vec4 color = SparseVoxelOctreeBuilder::unpackColor(nodeColor[node]);
+        if (color.w <= 0.0f)
+            return false;
+        hit.node = node;
+        hit.level = nodeLevel;
+        hit.voxel = position;
+        hit.distance = distance;
+        hit.color = color;
+        return true;
+    };
+
+    if (maxLevel == 0 || nodePool[0] <= 0)
+    {
+        handleNode(0, 0, glm::ivec3(0), tEnter);
+        return hit;
+    }
+
+    std::array<Frame, maxDepth> stack;
+    int stackPointer = 0;
+    stack[0] = { t0, t1, glm::ivec3(0), nodePool[0], firstChild(t0, 0.5f * (t0 + t1)), nodeColor[0] >> 24 };
+
+    while (stackPointer >= 0)
+    {
+        Frame& frame = stack[stackPointer];
+        if (frame.child > 7)
+        {
+            stackPointer--;
+            continue;
+        }
+
+        const int child = frame.child;
+        const int index = child ^ mirror;
+        const glm::vec3 tm = 0.5f * (frame.t0 + frame.t1);
+        glm::vec3 childT0;
+        glm::vec3 childT1;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const bool upper = (child >> axis) & 1;
+            childT0[axis] = upper ? tm[axis] : frame.t0[axis];
+            childT1[axis] = upper ? frame.t1[axis] : tm[axis];
+        }
+
+        // the next sibling is across the plane the ray leaves this child through, there is none if that is the upper plane of the parent
+        const int exitBit = 1 << minAxis(childT1);
+        frame.child = child & exitBit ? 8 : child | exitBit;
+
+        // empty children are skipped without reading them
+        if (!(frame.mask >> index & 1u))
+            continue;
+
+        // children are visited front to back, everything after this one is beyond tMax as well
+        const float childEnter = glm::compMax(childT0);
+        if (childEnter > ray.tMax)
+            return hit;
+        const float distance = std::max(childEnter, ray.tMin);
+        if (glm::compMin(childT1) <= distance)
+            continue;
+
+        const int node = frame.children + index;
+        const int nodeLevel = stackPointer + 1;
+        const glm::ivec3 position = frame.position * 2 + glm::ivec3(index & 1, (index >> 1) & 1, index >> 2);
+        const int children = nodePool[node];
+        if (nodeLevel < maxLevel && children > 0)
+        {
+            stackPointer++;
+            stack[stackPointer] = { childT0, childT1, position, children, firstChild(childT0, 0.5f * (childT0 + childT1)), nodeColor[node] >> 24 };
+        }
+        else if (handleNode(node, nodeLevel, position, distance))
+            return hit;
+    }
+    return hit;
+}
+
+void SparseVoxelOctreeTracer::trace(const std::vector<SparseVoxelOctreeRay>& rays, std::vector<SparseVoxelOctreeHit>& hits, size_t level) const
+{
+    TRACE_SCOPE("SparseVoxelOctreeTracer::trace");
+    hits.resize(rays.size());
+    std::vector<size_t> packets((rays.size() + s_packetSize - 1) / s_packetSize);
+    std::iota(packets.begin(), packets.end(), size_t(0));
+    std::for_each(std::execution::par, packets.begin(), packets.end(), [&](const size_t& packet)
+    {
+        const size_t end = std::min(rays.size(), (packet + 1) * s_packetSize);
+        for (size_t i = packet * s_packetSize; i < end; i++)
+            hits[i] = trace(rays[i], level);
+    });
+}
+
+void SparseVoxelOctreeTracer::getNodeBounds(const SparseVoxelOctreeHit& hit, glm::vec3& nodeMin, glm::vec3& nodeMax) const
+{
+    const glm::vec3 nodeSize = (m_bmax - m_bmin) / static_cast<float>(1 << hit.level);
+    nodeMin = m_bmin + glm::vec3(hit.voxel) * nodeSize;
+    nodeMax = nodeMin + nodeSize;
+}
+
+size_t SparseVoxelOctreeTracer::getDepth() const
+{
+    return m_depth;
+}
+
+const SparseVoxelOctreeData& SparseVoxelOctreeTracer::getOctree() const
+{
+    return m_octree;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SparseVoxelOctreeBuilder.h"
+
+/**
+ * \brief ray for SparseVoxelOctreeTracer, only hits between tMin and tMax are reported
+ */
+struct SparseVoxelOctreeRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float tMin = 0.0f;
+    float tMax = std::numeric_limits<float>::max();
+};
+
+/**
+ * \brief first filled node along a ray
+ */
+struct SparseVoxelOctreeHit
+{
+    int node = -1;                  // index in the node pool, -1 if nothing was hit
+    int level = 0;                  // level of the node, the root is level 0
+    glm::ivec3 voxel{ 0 };          // position of the node in the 2^level grid of its level
+    float distance = 0.0f;          // ray parameter where the ray enters the node
+    glm::vec4 color{ 0.0f };        // unpacked color of the node, mipmapped for inner nodes
+
+    bool isHit() const;
+};
+
+/**
+ * \brief differences between the shader and the CPU tracer, see SparseVoxelOctree::verifyTracer
+ */
+struct SparseVoxelOctreeTraceComparison
+{
+    size_t pixels = 0;
+    size_t hitMismatches = 0;       // pixels hit by only one of the tracers
+    size_t colorMismatches = 0;     // pixels hit by both with different colors
+
+    bool isEqual() const;
+    std::string toString() const;
+};
+
+/**
+ * \brief traces rays through a node pool in the layout of SparseVoxelOctreeData on the CPU, e.g. for picking, visibility and collision queries.
+ * Octrees and DAGs are traversed the same way as in TraceSparseVoxelOctree.frag, the rays are mirrored so all direction components are
+ * positive and the children of each node are visited front to back, so the first filled node is the closest one.
+ * Children missing in the occupancy mask of their parent are skipped without reading them
+ */
+class SparseVoxelOctreeTracer
+{
+public:
+    /**
+     * \param octree node pool, colors and level start indices, e.g. from SparseVoxelOctree::readBack or SparseVoxelOctreeFile::readData
+     * \param bmin minimum of the cubic bounding box of the octree
+     * \param bmax maximum of the cubic bounding box of the octree
+     */
+    SparseVoxelOctreeTracer(SparseVoxelOctreeData octree, glm::vec3 bmin, glm::vec3 bmax);
+
+    /**
+     * \brief returns the closest filled node of the ray
+     * \param level deepest level to descend to, filled nodes at this level are hit with their mipmapped color
+     */
+    SparseVoxelOctreeHit trace(const SparseVoxelOctreeRay& ray, size_t level = std::numeric_limits<size_t>::max()) const;
+
+    /**
+     * \brief traces many rays in parallel, packets of s_packetSize neighboring rays are traced by the same thread,
+     * so coherent rays (e.g. of neighboring pixels) reuse the cached upper levels of the tree
+     * \param hits resized to the number of rays
+     */
+    void trace(const std::vector<SparseVoxelOctreeRay>& rays, std::vector<SparseVoxelOctreeHit>& hits, size_t level = std::numeric_limits<size_t>::max()) const;
+
+    /**
+     * \brief returns the world space bounds of a hit node
+     */
+    void getNodeBounds(const SparseVoxelOctreeHit& hit, glm::vec3& nodeMin, glm::vec3& nodeMax) const;
+
+    size_t getDepth() const;
+    const SparseVoxelOctreeData& getOctree() const;
+
+    static constexpr size_t s_packetSize = 64;
+
+private:
+    SparseVoxelOctreeData m_octree;
+    glm::vec3 m_bmin;
+    glm::vec3 m_bmax;
+    size_t m_depth;
+};
@@ -109,10 +109,10 @@ void Texture::initWithoutDataMultiSample(int width, int height, GLenum internalF
     m_height = height;
 }
 
-void Texture::initWithoutData3D(int width, int height, int depth, GLenum internalFormat)
+void Texture::initWithoutData3D(int width, int height, int depth, GLenum internalFormat, bool mipmaps)
 {
     glEnable(GL_TEXTURE_3D);
-    const auto numLevels = static_cast<GLsizei>(glm::ceil(glm::log2<float>(static_cast<float>(glm::max(glm::max(width, height), depth)))));
+    const auto numLevels = mipmaps ? static_cast<GLsizei>(glm::ceil(glm::log2<float>(static_cast<float>(glm::max(glm::max(width, height), depth))))) : 1;
 	glTextureStorage3D(m_name, numLevels, internalFormat, width, height, depth);
 	m_width = width;
 	m_height = height;
@@ -31,7 +31,10 @@ public:
 	
 	virtual void initWithoutData(int width, int height, GLenum internalFormat);
     virtual void initWithoutDataMultiSample(int width, int height, GLenum internalFormat, GLsizei samples, GLboolean fixedSampleLocations);
-    virtual void initWithoutData3D(int width, int height, int depth, GLenum internalFormat);
+    /**
+     * \brief allocates a 3D texture, without mipmaps only level 0 is allocated, e.g. for atlases whose texels must not be averaged
+     */
+    virtual void initWithoutData3D(int width, int height, int depth, GLenum internalFormat, bool mipmaps = true);
 
     void setWrap(GLenum wrapS, GLenum wrapT) const;
     void setWrap(GLenum wrapS, GLenum wrapT, GLenum wrapR) const;
@@ -1,5 +1,6 @@
 #include "VertexArray.h"
 #include "Utils/UtilCollection.h"
+#include "Utils/GLStateCache.h"
 
 VertexArray::VertexArray()
 {
@@ -10,14 +11,14 @@ VertexArray::~VertexArray()
 {
     if (glfwGetCurrentContext() != nullptr)
     {
-        glDeleteVertexArrays(1, &m_vaoHandle);
+        GLStateCache::deleteVertexArray(m_vaoHandle);
     }
     util::getGLerror(__LINE__, __FUNCTION__);
 }
 
 void VertexArray::bind() const
 {
-    glBindVertexArray(m_vaoHandle);
+    GLStateCache::bindVertexArray(m_vaoHandle);
 }
 
 void VertexArray::connectIndexBuffer(Buffer& buffer) const
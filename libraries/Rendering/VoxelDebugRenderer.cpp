@@ -5,6 +5,7 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "imgui/imgui.h"
+#include "Utils/GLStateCache.h"
 
 VoxelDebugRenderer::VoxelDebugRenderer(const glm::ivec3 gridDim, const ScreenInfo screenInfo)
     : m_gridDim(gridDim), m_screenInfo(screenInfo), m_camera(m_screenInfo.width, m_screenInfo.height),
@@ -41,7 +42,7 @@ void VoxelDebugRenderer::draw() const
 
     m_emptyVao.bind();
     glDrawArrays(GL_POINTS, 0, m_numVoxels);
-    glBindVertexArray(0);
+    GLStateCache::bindVertexArray(0);
 }
 
 void VoxelDebugRenderer::drawGuiContent()
@@ -0,0 +1,172 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "GPUProfiler.h"
+
+Benchmark::Benchmark(std::string name, int frameCount, int warmupFrames)
+    : m_name(std::move(name)), m_frameCount(frameCount), m_warmupFrames(warmupFrames)
+{
+    if (frameCount < 1)
+        throw std::runtime_error("Benchmark needs at least one frame");
+    m_samples.reserve(frameCount);
+}
+
+void Benchmark::addFrame(float cpuMs)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const float frameMs = m_frame > 0 ? std::chrono::duration<float, std::milli>(now - m_lastFrame).count() : 0.0f;
+    m_lastFrame = now;
+
+    if (m_frame >= m_warmupFrames && !isFinished())
+    {
+        std::vector<float> sample(m_columns.size(), std::numeric_limits<float>::quiet_NaN());
+        sample[0] = cpuMs;
+        sample[1] = frameMs;
+        // GPU results arrive a few frames late, they still belong to frames on the same path.
+        // Without a newly collected frame the GPU columns stay NaN instead of repeating the previous results
+        if (GPUProfiler::hasNewResults())
+        {
+            for (const auto& result : GPUProfiler::getResults())
+            {
+                const size_t column = getColumn(result.path);
+                sample.resize(m_columns.size(), std::numeric_limits<float>::quiet_NaN());
+                // a scope begun several times in a frame counts once with the sum of its times
+                sample[column] = std::isnan(sample[column]) ? result.ms : sample[column] + result.ms;
+            }
+        }
+        m_samples.push_back(std::move(sample));
+    }
+    m_frame++;
+}
+
+bool Benchmark::isFinished() const
+{
+    return m_frame >= m_warmupFrames + m_frameCount;
+}
+
+float Benchmark::getPathParameter() const
+{
+    if (m_frameCount < 2)
+        return 0.0f;
+    return std::clamp(static_cast<float>(m_frame - m_warmupFrames) / (m_frameCount - 1), 0.0f, 1.0f);
+}
+
+double Benchmark::getSimulationTime() const
+{
+    return m_frame * s_simulationStep;
+}
+
+const std::string& Benchmark::getName() const
+{
+    return m_name;
+}
+
+void Benchmark::write(const std::experimental::filesystem::path& file) const
+{
+    if (file.extension() == ".json")
+        writeJSON(file);
+    else
+        writeCSV(file);
+}
+
+Benchmark::Summary Benchmark::summarize(std::vector<float> samples)
+{
+    samples.erase(std::remove_if(samples.begin(), samples.end(), [](float f) { return std::isnan(f); }), samples.end());
+    if (samples.empty())
+        return { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    std::sort(samples.begin(), samples.end());
+    // nearest-rank percentile
+    const auto percentile = [&](float p) {
+        const size_t rank = static_cast<size_t>(std::ceil(p / 100.0f * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+    const float mean = std::accumulate(samples.begin(), samples.end(), 0.0f) / samples.size();
+    return { mean, samples.front(), samples.back(), percentile(50.0f), percentile(95.0f), percentile(99.0f) };
+}
+
+size_t Benchmark::getColumn(const std::string& name)
+{
+    const auto search = std::find(m_columns.begin() + 2, m_columns.end(), name);
+    if (search != m_columns.end())
+        return static_cast<size_t>(search - m_columns.begin());
+    m_columns.push_back(name);
+    return m_columns.size() - 1;
+}
+
+void Benchmark::writeCSV(const std::experimental::filesystem::path& file) const
+{
+    std::ofstream out(file);
+    if (!out)
+        throw std::runtime_error("Could not write benchmark results to " + file.string());
+
+    out << "frame";
+    for (const auto& column : m_columns)
+        out << ',' << column;
+    out << '\n';
+    for (size_t frame = 0; frame < m_samples.size(); frame++)
+    {
+        out << frame;
+        for (size_t column = 0; column < m_columns.size(); column++)
+        {
+            out << ',';
+            if (column < m_samples[frame].size() && !std::isnan(m_samples[frame][column]))
+                out << m_samples[frame][column];
+        }
+        out << '\n';
+    }
+
+    auto summaryFile = file;
+    summaryFile.replace_filename(file.stem().string() + "_summary" + file.extension().string());
+    std::ofstream summaryOut(summaryFile);
+    if (!summaryOut)
+        throw std::runtime_error("Could not write benchmark results to " + summaryFile.string());
+
+    summaryOut << "name,mean,min,max,p50,p95,p99\n";
+    for (size_t column = 0; column < m_columns.size(); column++)
+    {
+        std::vector<float> values;
+        for (const auto& sample : m_samples)
+            values.push_back(column < sample.size() ? sample[column] : std::numeric_limits<float>::quiet_NaN());
+        const Summary s = summarize(std::move(values));
+        summaryOut << m_columns[column] << ',' << s.mean << ',' << s.min << ',' << s.max << ',' << s.p50 << ',' << s.p95 << ',' << s.p99 << '\n';
+    }
+}
+
+void Benchmark::writeJSON(const std::experimental::filesystem::path& file) const
+{
+    std::ofstream out(file);
+    if (!out)
+        throw std::runtime_error("Could not write benchmark results to " + file.string());
+
+    // scope names are profiler labels without quotes or backslashes, so they are written as they are
+    out << "{\n  \"name\": \"" << m_name << "\",\n  \"frames\": " << m_samples.size() << ",\n  \"warmupFrames\": " << m_warmupFrames << ",\n";
+    out << "  \"series\": {\n";
+    for (size_t column = 0; column < m_columns.size(); column++)
+    {
+        std::vector<float> values;
+        for (const auto& sample : m_samples)
+            values.push_back(column < sample.size() ? sample[column] : std::numeric_limits<float>::quiet_NaN());
+
+        out << "    \"" << m_columns[column] << "\": {\n      \"ms\": [";
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            out << (i > 0 ? ", " : "");
+            if (std::isnan(values[i]))
+                out << "null";
+            else
+                out << values[i];
+        }
+        const Summary s = summarize(std::move(values));
+        out << "],\n      \"mean\": " << s.mean << ", \"min\": " << s.min << ", \"max\": " << s.max
+            << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << "\n    }"
+            << (column + 1 < m_columns.size() ? "," : "") << "\n";
+    }
+    out << "  }\n}\n";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <experimental/filesystem>
+
+/**
+ * \brief collects CPU frame times and the GPUProfiler scopes of a fixed number of frames and writes them with percentiles.
+ * The first frames are a warm-up and are not recorded. Simulation time advances by a fixed step per frame,
+ * so runs with the same settings render the same frames.
+ */
+class Benchmark
+{
+public:
+    static constexpr double s_simulationStep = 1.0 / 60.0;
+
+    /**
+     * \param name name of the run, e.g. the scene
+     * \param frameCount number of recorded frames
+     * \param warmupFrames number of frames rendered before recording
+     */
+    Benchmark(std::string name, int frameCount, int warmupFrames = 30);
+
+    /**
+     * \brief records a frame, call once per frame after GPUProfiler::newFrame()
+     * \param cpuMs CPU time spent on the frame until the swap
+     */
+    void addFrame(float cpuMs);
+
+    bool isFinished() const;
+
+    /**
+     * \brief returns the position on a camera path, 0 during the warm-up, 1 at the last recorded frame
+     */
+    float getPathParameter() const;
+
+    /**
+     * \brief returns the fixed-step simulation time of the current frame in seconds
+     */
+    double getSimulationTime() const;
+
+    const std::string& getName() const;
+
+    /**
+     * \brief writes per-frame times and a summary, JSON if the extension is .json, CSV otherwise.
+     * CSV writes the summary to a second file with "_summary" appended to the name
+     */
+    void write(const std::experimental::filesystem::path& file) const;
+
+private:
+    struct Summary
+    {
+        float mean;
+        float min;
+        float max;
+        float p50;
+        float p95;
+        float p99;
+    };
+
+    static Summary summarize(std::vector<float> samples);
+    size_t getColumn(const std::string& name);
+    void writeCSV(const std::experimental::filesystem::path& file) const;
+    void writeJSON(const std::experimental::filesystem::path& file) const;
+
+    std::string m_name;
+    int m_frameCount;
+    int m_warmupFrames;
+    int m_frame = 0;
+    std::chrono::steady_clock::time_point m_lastFrame;
+
+    // column 0 is the CPU time, column 1 the wall time between frames, the rest are GPU scopes named by their path
+    std::vector<std::string> m_columns = { "cpu", "frame" };
+    std::vector<std::vector<float>> m_samples;  // per frame, one value per column, NaN if a scope was missing
+};
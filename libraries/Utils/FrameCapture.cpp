@@ -0,0 +1,377 @@
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "stb/stb_image_write.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <GLFW/glfw3.h>
+
+#include "imgui/imgui.h"
+
+std::array<FrameCapture::Readback, FrameCapture::s_ringSize> FrameCapture::s_readbacks;
+size_t FrameCapture::s_nextReadback = 0;
+unsigned FrameCapture::s_stalls = 0;
+
+bool FrameCapture::s_sequenceRecording = false;
+std::experimental::filesystem::path FrameCapture::s_sequenceDirectory;
+ImageFormat FrameCapture::s_sequenceFormat = ImageFormat::qoi;
+int FrameCapture::s_sequenceFrame = 0;
+int FrameCapture::s_sequenceFrameCount = -1;
+
+std::deque<FrameCapture::EncodeJob> FrameCapture::s_jobs;
+std::mutex FrameCapture::s_jobMutex;
+std::condition_variable FrameCapture::s_jobAdded;
+std::condition_variable FrameCapture::s_jobTaken;
+bool FrameCapture::s_stopWorkers = false;
+std::atomic<unsigned> FrameCapture::s_encoding = 0;
+std::atomic<unsigned> FrameCapture::s_written = 0;
+// defined last so it is destroyed before the queue and mutex it uses
+FrameCapture::WorkerPool FrameCapture::s_workers;
+
+namespace
+{
+    void writeBigEndian(std::vector<unsigned char>& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+
+    // encoder for the QOI format, see https://qoiformat.org/qoi-specification.pdf
+    std::vector<unsigned char> encodeQOI(const unsigned char* pixels, int width, int height)
+    {
+        constexpr unsigned char opIndex = 0x00;
+        constexpr unsigned char opDiff = 0x40;
+        constexpr unsigned char opLuma = 0x80;
+        constexpr unsigned char opRun = 0xc0;
+        constexpr unsigned char opRGB = 0xfe;
+        constexpr unsigned char opRGBA = 0xff;
+
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+        std::vector<unsigned char> out;
+        out.reserve(14 + pixelCount * 2 + 8);
+        out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+        writeBigEndian(out, width);
+        writeBigEndian(out, height);
+        out.push_back(4);   // channels
+        out.push_back(0);   // sRGB with linear alpha
+
+        std::array<std::array<unsigned char, 4>, 64> index{};
+        std::array<unsigned char, 4> previous = { 0, 0, 0, 255 };
+        int run = 0;
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            std::array<unsigned char, 4> px;
+            std::memcpy(px.data(), pixels + i * 4, 4);
+
+            if (px == previous)
+            {
+                run++;
+                if (run == 62 || i + 1 == pixelCount)
+                {
+                    out.push_back(opRun | static_cast<unsigned char>(run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0)
+            {
+                out.push_back(opRun | static_cast<unsigned char>(run - 1));
+                run = 0;
+            }
+
+            const int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+            if (index[hash] == px)
+                out.push_back(opIndex | static_cast<unsigned char>(hash));
+            else
+            {
+                index[hash] = px;
+                if (px[3] == previous[3])
+                {
+                    const int dr = static_cast<signed char>(px[0] - previous[0]);
+                    const int dg = static_cast<signed char>(px[1] - previous[1]);
+                    const int db = static_cast<signed char>(px[2] - previous[2]);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                        out.push_back(opDiff | static_cast<unsigned char>((dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                    else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+                    {
+                        out.push_back(opLuma | static_cast<unsigned char>(dg + 32));
+                        out.push_back(static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8)));
+                    }
+                    else
+                        out.insert(out.end(), { opRGB, px[0], px[1], px[2] });
+                }
+                else
+                    out.insert(out.end(), { opRGBA, px[0], px[1], px[2], px[3] });
+            }
+            previous = px;
+        }
+        out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+        return out;
+    }
+}
+
+void FrameCapture::captureFrame(const std::experimental::filesystem::path& file, ImageFormat format)
+{
+    int width;
+    int height;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    const size_t size = static_cast<size_t>(width) * height * 4;
+
+    // the oldest readback has to be finished before its buffer can be reused
+    Readback& readback = s_readbacks[s_nextReadback];
+    if (readback.fence)
+    {
+        s_stalls++;
+        collect(true);
+    }
+
+    if (readback.size != size)
+    {
+        if (readback.buffer != 0)
+            GLStateCache::deleteBuffer(readback.buffer);
+        glCreateBuffers(1, &readback.buffer);
+        glNamedBufferStorage(readback.buffer, size, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_CLIENT_STORAGE_BIT);
+        readback.mapped = static_cast<const unsigned char*>(glMapNamedBufferRange(readback.buffer, 0, size, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+        readback.size = size;
+    }
+
+    GLStateCache::bindFramebuffer(0);
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLStateCache::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, UnusedMask::GL_UNUSED_BIT);
+    readback.width = width;
+    readback.height = height;
+    readback.file = file;
+    readback.format = format;
+
+    s_nextReadback = (s_nextReadback + 1) % s_ringSize;
+}
+
+void FrameCapture::startSequence(const std::experimental::filesystem::path& directory, ImageFormat format, int frameCount)
+{
+    std::experimental::filesystem::create_directories(directory);
+    s_sequenceDirectory = directory;
+    s_sequenceFormat = format;
+    s_sequenceFrame = 0;
+    s_sequenceFrameCount = frameCount;
+    s_sequenceRecording = true;
+}
+
+void FrameCapture::stopSequence()
+{
+    s_sequenceRecording = false;
+}
+
+bool FrameCapture::isRecordingSequence()
+{
+    return s_sequenceRecording;
+}
+
+void FrameCapture::endFrame()
+{
+    if (s_sequenceRecording)
+    {
+        std::ostringstream name;
+        name << "frame_" << std::setw(6) << std::setfill('0') << s_sequenceFrame << getExtension(s_sequenceFormat);
+        captureFrame(s_sequenceDirectory / name.str(), s_sequenceFormat);
+        s_sequenceFrame++;
+        if (s_sequenceFrameCount >= 0 && s_sequenceFrame >= s_sequenceFrameCount)
+            s_sequenceRecording = false;
+    }
+    collect(false);
+}
+
+void FrameCapture::waitForReadbacks()
+{
+    for (size_t i = 0; i < s_ringSize; i++)
+        collect(true);
+}
+
+void FrameCapture::finish()
+{
+    s_sequenceRecording = false;
+    waitForReadbacks();
+    stopWorkers();
+
+    for (auto& readback : s_readbacks)
+    {
+        if (readback.buffer != 0)
+            GLStateCache::deleteBuffer(readback.buffer);
+        readback = Readback();
+    }
+}
+
+std::string FrameCapture::getExtension(ImageFormat format)
+{
+    switch (format)
+    {
+    case ImageFormat::png: return ".png";
+    case ImageFormat::qoi: return ".qoi";
+    case ImageFormat::pam: return ".pam";
+    }
+    throw std::runtime_error("Unknown image format");
+}
+
+void FrameCapture::showGUIContent()
+{
+    static int format = static_cast<int>(ImageFormat::qoi);
+    ImGui::Combo("Format", &format, "PNG\0QOI\0PAM (uncompressed)\0");
+    if (s_sequenceRecording)
+    {
+        ImGui::Text("Recording frame %d", s_sequenceFrame);
+        if (ImGui::Button("Stop recording"))
+            stopSequence();
+    }
+    else if (ImGui::Button("Record sequence"))
+        startSequence("capture", static_cast<ImageFormat>(format));
+
+    size_t queued;
+    {
+        std::unique_lock<std::mutex> lock(s_jobMutex);
+        queued = s_jobs.size();
+    }
+    const auto inFlight = std::count_if(s_readbacks.begin(), s_readbacks.end(), [](const Readback& r) { return r.fence != nullptr; });
+    ImGui::Text("%d readbacks in flight, %zu queued, %u encoding", static_cast<int>(inFlight), queued, s_encoding.load());
+    ImGui::Text("%u written, render loop waited %u times", s_written.load(), s_stalls);
+}
+
+void FrameCapture::collect(bool wait)
+{
+    // readbacks finish in the order they were issued, start with the oldest
+    for (size_t i = 0; i < s_ringSize; i++)
+    {
+        Readback& readback = s_readbacks[(s_nextReadback + i) % s_ringSize];
+        if (!readback.fence)
+            continue;
+
+        GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1'000'000'000 : 0);
+        if (status == GL_TIMEOUT_EXPIRED && !wait)
+            return;
+        // captureFrame reuses the buffer of the oldest readback after waiting, so it must not be skipped
+        while (status == GL_TIMEOUT_EXPIRED)
+        {
+            std::cout << "WARNING: frame capture readback still not finished after 1 s, waiting\n";
+            status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+        }
+        if (status == GL_WAIT_FAILED)
+            throw std::runtime_error("Waiting for a frame capture readback failed");
+
+        handOff(readback);
+        // only the oldest readback is waited for
+        wait = false;
+    }
+}
+
+void FrameCapture::handOff(Readback& readback)
+{
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    EncodeJob job{ readback.file, readback.format, readback.width, readback.height,
+        std::vector<unsigned char>(readback.mapped, readback.mapped + readback.size) };
+
+    if (s_workers.threads.empty())
+        startWorkers();
+    {
+        // bounds the memory held by the queue if encoding can not keep up
+        std::unique_lock<std::mutex> lock(s_jobMutex);
+        s_jobTaken.wait(lock, []() { return s_jobs.size() < s_maxQueuedFrames; });
+        s_jobs.push_back(std::move(job));
+    }
+    s_jobAdded.notify_one();
+}
+
+void FrameCapture::startWorkers()
+{
+    // leave one core to the render loop
+    const unsigned count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    for (unsigned i = 0; i < count; i++)
+        s_workers.threads.emplace_back(workerLoop);
+}
+
+void FrameCapture::stopWorkers()
+{
+    {
+        std::unique_lock<std::mutex> lock(s_jobMutex);
+        s_stopWorkers = true;
+    }
+    s_jobAdded.notify_all();
+    // the workers finish the queued jobs before they return
+    for (auto& worker : s_workers.threads)
+        worker.join();
+    s_workers.threads.clear();
+    s_stopWorkers = false;
+}
+
+FrameCapture::WorkerPool::~WorkerPool()
+{
+    stopWorkers();
+}
+
+void FrameCapture::workerLoop()
+{
+    while (true)
+    {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(s_jobMutex);
+            s_jobAdded.wait(lock, []() { return s_stopWorkers || !s_jobs.empty(); });
+            if (s_jobs.empty())
+                return;
+            job = std::move(s_jobs.front());
+            s_jobs.pop_front();
+            s_encoding++;
+        }
+        s_jobTaken.notify_one();
+
+        try
+        {
+            encode(job);
+            s_written++;
+        }
+        catch (std::runtime_error& ex)
+        {
+            std::cout << ex.what() << std::endl;
+        }
+        s_encoding--;
+    }
+}
+
+void FrameCapture::encode(EncodeJob& job)
+{
+    // OpenGL reads the bottom row first, images start at the top
+    const size_t rowSize = static_cast<size_t>(job.width) * 4;
+    for (int y = 0; y < job.height / 2; y++)
+        std::swap_ranges(job.pixels.begin() + y * rowSize, job.pixels.begin() + (y + 1) * rowSize, job.pixels.end() - (y + 1) * rowSize);
+
+    if (job.format == ImageFormat::png)
+    {
+        if (stbi_write_png(job.file.string().c_str(), job.width, job.height, 4, job.pixels.data(), static_cast<int>(rowSize)) == 0)
+            throw std::runtime_error("Could not write image " + job.file.string());
+        return;
+    }
+
+    std::ofstream out(job.file, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Could not write image " + job.file.string());
+    if (job.format == ImageFormat::qoi)
+    {
+        const auto encoded = encodeQOI(job.pixels.data(), job.width, job.height);
+        out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    }
+    else
+    {
+        out << "P7\nWIDTH " << job.width << "\nHEIGHT " << job.height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+        out.write(reinterpret_cast<const char*>(job.pixels.data()), job.pixels.size());
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <experimental/filesystem>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+/**
+ * \brief file formats the captured frames can be written in
+ */
+enum class ImageFormat
+{
+    png,    // small files, slow to encode
+    qoi,    // "Quite OK Image" format, lossless, several times faster to encode than png
+    pam     // uncompressed RGBA (netpbm P7), fastest but large
+};
+
+/**
+ * \brief captures the default framebuffer without stalling the render loop.
+ * The pixels are read into a ring of persistently mapped pixel pack buffers and fenced. Finished readbacks are
+ * collected in a later frame and encoded by a pool of worker threads, so image sequences can be recorded at full frame rate.
+ * The render loop only waits if every readback buffer is still in flight or too many frames are queued for encoding
+ */
+class FrameCapture
+{
+public:
+    static constexpr size_t s_ringSize = 3;
+    static constexpr size_t s_maxQueuedFrames = 32;
+
+    /**
+     * \brief reads back the current content of the default framebuffer and writes it to a file in the background
+     * \param file output file, the extension is not changed
+     * \param format encoding of the file
+     */
+    static void captureFrame(const std::experimental::filesystem::path& file, ImageFormat format = ImageFormat::png);
+
+    /**
+     * \brief captures every following frame into numbered files "frame_000000.<ext>" in the directory
+     * \param directory output directory, created if it does not exist
+     * \param format encoding of the files
+     * \param frameCount number of frames to record, -1 records until stopSequence() is called
+     */
+    static void startSequence(const std::experimental::filesystem::path& directory, ImageFormat format, int frameCount = -1);
+
+    static void stopSequence();
+
+    static bool isRecordingSequence();
+
+    /**
+     * \brief captures the frame of a running sequence and hands finished readbacks to the encoders,
+     * call once per frame after everything is rendered and before swapping the buffers
+     */
+    static void endFrame();
+
+    /**
+     * \brief waits until all readbacks are finished and hands them to the encoders
+     */
+    static void waitForReadbacks();
+
+    /**
+     * \brief waits for all readbacks and encodings and stops the workers, call before the context is destroyed
+     */
+    static void finish();
+
+    /**
+     * \brief returns the file extension for a format, including the dot
+     */
+    static std::string getExtension(ImageFormat format);
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    static void showGUIContent();
+
+private:
+    struct Readback
+    {
+        GLuint buffer = 0;
+        const unsigned char* mapped = nullptr;
+        size_t size = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        std::experimental::filesystem::path file;
+        ImageFormat format = ImageFormat::png;
+    };
+
+    struct EncodeJob
+    {
+        std::experimental::filesystem::path file;
+        ImageFormat format;
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;  // RGBA, bottom row first as read by OpenGL
+    };
+
+    static void collect(bool wait);
+    static void handOff(Readback& readback);
+    static void startWorkers();
+    static void stopWorkers();
+    static void workerLoop();
+    static void encode(EncodeJob& job);
+
+    static std::array<Readback, s_ringSize> s_readbacks;
+    static size_t s_nextReadback;
+    static unsigned s_stalls;
+
+    static bool s_sequenceRecording;
+    static std::experimental::filesystem::path s_sequenceDirectory;
+    static ImageFormat s_sequenceFormat;
+    static int s_sequenceFrame;
+    static int s_sequenceFrameCount;
+
+    static std::deque<EncodeJob> s_jobs;
+    static std::mutex s_jobMutex;
+    static std::condition_variable s_jobAdded;
+    static std::condition_variable s_jobTaken;
+    static bool s_stopWorkers;
+    static std::atomic<unsigned> s_encoding;
+    static std::atomic<unsigned> s_written;
+
+    // joins the workers at exit if finish() was not called, so encodings in progress are still written
+    struct WorkerPool
+    {
+        std::vector<std::thread> threads;
+        ~WorkerPool();
+    };
+    static WorkerPool s_workers;
+};
@@ -0,0 +1,233 @@
+#include "GLCallTracker.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <glbinding/Binding.h>
+#include <glbinding/CallbackMask.h>
+#include <glbinding/AbstractFunction.h>
+#include <glbinding/FunctionCall.h>
+#include <glbinding/Value.h>
+#include <glbinding-aux/types_to_string.h>
+
+#include "imgui/imgui.h"
+
+bool GLCallTracker::s_enabled = false;
+std::unordered_map<const glbinding::AbstractFunction*, GLCallTracker::FunctionInfo> GLCallTracker::s_functions;
+std::unordered_map<std::string, std::string> GLCallTracker::s_lastState;
+std::vector<GLCallTracker::FunctionStats> GLCallTracker::s_lastFrameStats;
+unsigned GLCallTracker::s_lastFrameCalls = 0;
+unsigned GLCallTracker::s_lastFrameSyncPoints = 0;
+unsigned GLCallTracker::s_lastFrameRedundant = 0;
+
+std::experimental::filesystem::path GLCallTracker::s_captureFile;
+bool GLCallTracker::s_captureRequested = false;
+std::ofstream GLCallTracker::s_captureStream;
+std::ofstream GLCallTracker::s_captureDataStream;
+
+namespace
+{
+    // state setters and the number of leading parameters that select which state is set (e.g. the target of glBindBuffer)
+    const std::unordered_map<std::string, int> stateSetters = {
+        { "glUseProgram", 0 }, { "glBindVertexArray", 0 }, { "glViewport", 0 }, { "glDepthMask", 0 },
+        { "glDepthFunc", 0 }, { "glCullFace", 0 }, { "glBlendFunc", 0 }, { "glClearColor", 0 },
+        { "glBindBuffer", 1 }, { "glBindFramebuffer", 1 }, { "glBindTexture", 1 }, { "glBindTextureUnit", 1 },
+        { "glBindImageTexture", 1 }, { "glPolygonMode", 1 }, { "glPixelStorei", 1 }, { "glEnable", 1 },
+        { "glDisable", 1 }, { "glBindBufferBase", 2 }
+    };
+
+    // calls that wait for the GPU or at least for the command queue to be processed
+    const std::vector<std::string> syncPoints = {
+        "glFinish", "glReadPixels", "glReadnPixels", "glMapBuffer", "glMapBufferRange", "glMapNamedBuffer",
+        "glMapNamedBufferRange", "glClientWaitSync"
+    };
+
+    // buffer uploads, with the parameter index of the size and of the data pointer
+    const std::unordered_map<std::string, std::pair<size_t, size_t>> bufferUploads = {
+        { "glBufferData", { 1, 2 } }, { "glBufferSubData", { 2, 3 } }, { "glBufferStorage", { 1, 2 } },
+        { "glNamedBufferData", { 1, 2 } }, { "glNamedBufferSubData", { 2, 3 } }, { "glNamedBufferStorage", { 1, 2 } }
+    };
+}
+
+void GLCallTracker::enable()
+{
+    glbinding::Binding::setCallbackMask(glbinding::CallbackMask::After | glbinding::CallbackMask::ParametersAndReturnValue);
+    glbinding::Binding::setAfterCallback(afterCallback);
+    s_lastState.clear();
+    s_enabled = true;
+}
+
+void GLCallTracker::disable()
+{
+    glbinding::Binding::setCallbackMask(glbinding::CallbackMask::None);
+    s_enabled = false;
+    s_captureRequested = false;
+    s_captureStream.close();
+    s_captureDataStream.close();
+}
+
+bool GLCallTracker::isEnabled()
+{
+    return s_enabled;
+}
+
+void GLCallTracker::captureNextFrame(const std::experimental::filesystem::path& file)
+{
+    s_captureFile = file;
+    s_captureRequested = true;
+}
+
+void GLCallTracker::newFrame()
+{
+    s_lastFrameStats.clear();
+    s_lastFrameCalls = 0;
+    s_lastFrameSyncPoints = 0;
+    s_lastFrameRedundant = 0;
+    for (auto& function : s_functions)
+    {
+        auto& info = function.second;
+        if (info.calls == 0)
+            continue;
+        s_lastFrameStats.push_back({ info.name, info.calls, info.redundant, info.syncPoint });
+        s_lastFrameCalls += info.calls;
+        s_lastFrameRedundant += info.redundant;
+        if (info.syncPoint)
+            s_lastFrameSyncPoints += info.calls;
+        info.calls = 0;
+        info.redundant = 0;
+    }
+    std::sort(s_lastFrameStats.begin(), s_lastFrameStats.end(), [](const FunctionStats& a, const FunctionStats& b) { return a.calls > b.calls; });
+
+    if (s_captureStream.is_open())
+    {
+        s_captureStream.close();
+        s_captureDataStream.close();
+        std::cout << "Captured GL calls of one frame to " << s_captureFile.string() << std::endl;
+    }
+    if (s_captureRequested && s_enabled)
+    {
+        s_captureStream.open(s_captureFile);
+        s_captureDataStream.open(s_captureFile.string() + ".bin", std::ios::binary);
+        if (!s_captureStream || !s_captureDataStream)
+            throw std::runtime_error("Could not open GL capture file " + s_captureFile.string());
+    }
+    s_captureRequested = false;
+}
+
+const std::vector<GLCallTracker::FunctionStats>& GLCallTracker::getLastFrameStats()
+{
+    return s_lastFrameStats;
+}
+
+void GLCallTracker::showGUIContent()
+{
+    bool enabled = s_enabled;
+    if (ImGui::Checkbox("Track GL calls (slow)", &enabled))
+    {
+        if (enabled)
+            enable();
+        else
+            disable();
+    }
+    if (!s_enabled)
+        return;
+
+    ImGui::Text("%u calls, %u sync points, %u redundant", s_lastFrameCalls, s_lastFrameSyncPoints, s_lastFrameRedundant);
+    if (ImGui::Button("Capture next frame"))
+        captureNextFrame("gl_capture.txt");
+
+    ImGui::Separator();
+    const size_t shown = std::min<size_t>(s_lastFrameStats.size(), 15);
+    for (size_t i = 0; i < shown; i++)
+    {
+        const auto& stats = s_lastFrameStats[i];
+        const ImVec4 color = stats.syncPoint ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f)
+            : stats.redundant > 0 ? ImVec4(1.0f, 0.8f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+        ImGui::TextColored(color, "%6u %s", stats.calls, stats.name.c_str());
+        if (stats.redundant > 0)
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(%u redundant)", stats.redundant);
+        }
+    }
+}
+
+void GLCallTracker::afterCallback(const glbinding::FunctionCall& call)
+{
+    auto& info = getInfo(call.function);
+    info.calls++;
+
+    // deleting an object unbinds it, the tracked bindings might be stale afterwards
+    if (info.name.compare(0, 8, "glDelete") == 0)
+        s_lastState.clear();
+    else if (isRedundant(info, call))
+        info.redundant++;
+
+    if (s_captureStream.is_open())
+        writeCall(info, call);
+}
+
+GLCallTracker::FunctionInfo& GLCallTracker::getInfo(const glbinding::AbstractFunction* function)
+{
+    const auto search = s_functions.find(function);
+    if (search != s_functions.end())
+        return search->second;
+
+    FunctionInfo info;
+    info.name = function->name();
+    info.syncPoint = info.name.compare(0, 5, "glGet") == 0
+        || std::find(syncPoints.begin(), syncPoints.end(), info.name) != syncPoints.end();
+    const auto setter = stateSetters.find(info.name);
+    info.stateKeyParameters = setter != stateSetters.end() ? setter->second : -1;
+    return s_functions.emplace(function, info).first->second;
+}
+
+bool GLCallTracker::isRedundant(const FunctionInfo& info, const glbinding::FunctionCall& call)
+{
+    if (info.stateKeyParameters < 0)
+        return false;
+
+    // glEnable and glDisable set the same state
+    const bool toggle = info.name == "glEnable" || info.name == "glDisable";
+    std::ostringstream key;
+    std::ostringstream value;
+    key << (toggle ? "glEnable" : info.name);
+    for (size_t i = 0; i < call.parameters.size(); i++)
+        (static_cast<int>(i) < info.stateKeyParameters ? key : value) << ' ' << call.parameters[i].get();
+    if (toggle)
+        value << (info.name == "glEnable");
+
+    const auto [entry, inserted] = s_lastState.try_emplace(key.str(), value.str());
+    if (inserted)
+        return false;
+    if (entry->second == value.str())
+        return true;
+    entry->second = value.str();
+    return false;
+}
+
+void GLCallTracker::writeCall(const FunctionInfo& info, const glbinding::FunctionCall& call)
+{
+    s_captureStream << info.name << '(';
+    for (size_t i = 0; i < call.parameters.size(); i++)
+        s_captureStream << (i > 0 ? ", " : "") << call.parameters[i].get();
+    s_captureStream << ')';
+    if (call.returnValue)
+        s_captureStream << " -> " << call.returnValue.get();
+
+    // uploaded data is appended to the binary file, the text file references it by offset
+    const auto upload = bufferUploads.find(info.name);
+    if (upload != bufferUploads.end() && call.parameters.size() > upload->second.second)
+    {
+        const auto size = dynamic_cast<const glbinding::Value<GLsizeiptr>*>(call.parameters[upload->second.first].get());
+        const auto data = dynamic_cast<const glbinding::Value<const void*>*>(call.parameters[upload->second.second].get());
+        if (size && data && data->value() != nullptr)
+        {
+            s_captureStream << " [data at " << s_captureDataStream.tellp() << ", " << size->value() << " bytes]";
+            s_captureDataStream.write(static_cast<const char*>(data->value()), size->value());
+        }
+    }
+    s_captureStream << '\n';
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+namespace glbinding
+{
+    class AbstractFunction;
+    struct FunctionCall;
+}
+
+/**
+ * \brief opt-in accounting of every OpenGL call through the glbinding after-callbacks.
+ * Counts calls per function and frame, flags redundant state changes (same state set twice in a row)
+ * and sync points (glGet*, glFinish, glReadPixels, mapping, ...), and can record the call stream of one frame
+ * including uploaded buffer data to a file. Every GL call is slowed down considerably while enabled
+ */
+class GLCallTracker
+{
+public:
+    /**
+     * \brief call counters of one function in the last complete frame
+     */
+    struct FunctionStats
+    {
+        std::string name;
+        unsigned calls = 0;
+        unsigned redundant = 0;
+        bool syncPoint = false;
+    };
+
+    /**
+     * \brief registers the glbinding callbacks, call after util::initGL()
+     */
+    static void enable();
+
+    /**
+     * \brief removes the callbacks, GL calls are not slowed down anymore
+     */
+    static void disable();
+
+    static bool isEnabled();
+
+    /**
+     * \brief records the call stream of the next complete frame
+     * \param file text file for the calls, uploaded buffer data goes to the same path with ".bin" appended
+     */
+    static void captureNextFrame(const std::experimental::filesystem::path& file);
+
+    /**
+     * \brief stores the counters of the last frame and resets them, call once per frame
+     */
+    static void newFrame();
+
+    /**
+     * \brief returns the functions called in the last complete frame, most called first
+     */
+    static const std::vector<FunctionStats>& getLastFrameStats();
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    static void showGUIContent();
+
+private:
+    struct FunctionInfo
+    {
+        std::string name;
+        bool syncPoint;
+        int stateKeyParameters;     // number of parameters that select the state, -1 if it is not a state setter
+        unsigned calls = 0;
+        unsigned redundant = 0;
+    };
+
+    static void afterCallback(const glbinding::FunctionCall& call);
+    static FunctionInfo& getInfo(const glbinding::AbstractFunction* function);
+    static bool isRedundant(const FunctionInfo& info, const glbinding::FunctionCall& call);
+    static void writeCall(const FunctionInfo& info, const glbinding::FunctionCall& call);
+
+    static bool s_enabled;
+    static std::unordered_map<const glbinding::AbstractFunction*, FunctionInfo> s_functions;
+    static std::unordered_map<std::string, std::string> s_lastState;   // function + key parameters -> all parameters
+    static std::vector<FunctionStats> s_lastFrameStats;
+    static unsigned s_lastFrameCalls;
+    static unsigned s_lastFrameSyncPoints;
+    static unsigned s_lastFrameRedundant;
+
+    static std::experimental::filesystem::path s_captureFile;
+    static bool s_captureRequested;
+    static std::ofstream s_captureStream;
+    static std::ofstream s_captureDataStream;
+};
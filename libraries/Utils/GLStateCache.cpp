@@ -0,0 +1,239 @@
+#include "GLStateCache.h"
+
+#include "imgui/imgui.h"
+
+std::optional<GLuint> GLStateCache::s_program;
+std::optional<GLuint> GLStateCache::s_vao;
+std::optional<GLuint> GLStateCache::s_framebuffer;
+GLuint GLStateCache::s_defaultFramebuffer = 0U;
+std::optional<std::array<GLint, 4>> GLStateCache::s_viewport;
+std::optional<GLboolean> GLStateCache::s_depthMask;
+std::optional<GLenum> GLStateCache::s_cullFace;
+std::unordered_map<GLenum, bool> GLStateCache::s_capabilities;
+std::unordered_map<GLenum, GLuint> GLStateCache::s_buffers;
+std::map<std::pair<GLenum, GLuint>, GLuint> GLStateCache::s_indexedBuffers;
+
+GLStateCache::Stats GLStateCache::s_frameStats;
+GLStateCache::Stats GLStateCache::s_lastFrameStats;
+
+bool GLStateCache::changed(const bool isDifferent)
+{
+    if (isDifferent)
+        s_frameStats.issued++;
+    else
+        s_frameStats.elided++;
+    return isDifferent;
+}
+
+void GLStateCache::useProgram(const GLuint program)
+{
+    if (changed(s_program != program))
+    {
+        glUseProgram(program);
+        s_program = program;
+    }
+}
+
+void GLStateCache::bindVertexArray(const GLuint vao)
+{
+    if (changed(s_vao != vao))
+    {
+        glBindVertexArray(vao);
+        s_vao = vao;
+    }
+}
+
+void GLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+    if (framebuffer == 0U)
+        framebuffer = s_defaultFramebuffer;
+    if (changed(s_framebuffer != framebuffer))
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        s_framebuffer = framebuffer;
+    }
+}
+
+void GLStateCache::bindBuffer(const GLenum target, const GLuint buffer)
+{
+    const auto search = s_buffers.find(target);
+    if (changed(search == s_buffers.end() || search->second != buffer))
+    {
+        glBindBuffer(target, buffer);
+        s_buffers[target] = buffer;
+    }
+}
+
+void GLStateCache::bindBufferBase(const GLenum target, const GLuint index, const GLuint buffer)
+{
+    const auto search = s_indexedBuffers.find({ target, index });
+    if (changed(search == s_indexedBuffers.end() || search->second != buffer))
+    {
+        glBindBufferBase(target, index, buffer);
+        s_indexedBuffers[{ target, index }] = buffer;
+        // glBindBufferBase also binds to the generic binding point
+        s_buffers[target] = buffer;
+    }
+}
+
+void GLStateCache::viewport(const GLint x, const GLint y, const GLsizei width, const GLsizei height)
+{
+    const std::array<GLint, 4> viewport = { x, y, width, height };
+    if (changed(s_viewport != viewport))
+    {
+        glViewport(x, y, width, height);
+        s_viewport = viewport;
+    }
+}
+
+void GLStateCache::enable(const GLenum capability)
+{
+    const auto search = s_capabilities.find(capability);
+    if (changed(search == s_capabilities.end() || !search->second))
+    {
+        glEnable(capability);
+        s_capabilities[capability] = true;
+    }
+}
+
+void GLStateCache::disable(const GLenum capability)
+{
+    const auto search = s_capabilities.find(capability);
+    if (changed(search == s_capabilities.end() || search->second))
+    {
+        glDisable(capability);
+        s_capabilities[capability] = false;
+    }
+}
+
+void GLStateCache::setEnabled(const GLenum capability, const bool enabled)
+{
+    if (enabled)
+        enable(capability);
+    else
+        disable(capability);
+}
+
+void GLStateCache::depthMask(const GLboolean flag)
+{
+    if (changed(s_depthMask != flag))
+    {
+        glDepthMask(flag);
+        s_depthMask = flag;
+    }
+}
+
+void GLStateCache::cullFace(const GLenum mode)
+{
+    if (changed(s_cullFace != mode))
+    {
+        glCullFace(mode);
+        s_cullFace = mode;
+    }
+}
+
+std::array<GLint, 4> GLStateCache::getViewport()
+{
+    if (!s_viewport)
+    {
+        std::array<GLint, 4> viewport;
+        glGetIntegerv(GL_VIEWPORT, viewport.data());
+        s_viewport = viewport;
+    }
+    return *s_viewport;
+}
+
+bool GLStateCache::isEnabled(const GLenum capability)
+{
+    const auto search = s_capabilities.find(capability);
+    if (search != s_capabilities.end())
+        return search->second;
+    const bool enabled = glIsEnabled(capability) == GL_TRUE;
+    s_capabilities[capability] = enabled;
+    return enabled;
+}
+
+GLboolean GLStateCache::getDepthMask()
+{
+    if (!s_depthMask)
+    {
+        GLboolean flag;
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &flag);
+        s_depthMask = flag;
+    }
+    return *s_depthMask;
+}
+
+void GLStateCache::deleteProgram(const GLuint program)
+{
+    glDeleteProgram(program);
+    // a program in use stays current until another one is used, so the binding is unknown from now on
+    if (s_program == program)
+        s_program.reset();
+}
+
+void GLStateCache::deleteVertexArray(const GLuint vao)
+{
+    glDeleteVertexArrays(1, &vao);
+    if (s_vao == vao)
+        s_vao = 0U;
+}
+
+void GLStateCache::deleteFramebuffer(const GLuint framebuffer)
+{
+    glDeleteFramebuffers(1, &framebuffer);
+    if (s_framebuffer == framebuffer)
+        s_framebuffer = 0U;
+}
+
+void GLStateCache::deleteBuffer(const GLuint buffer)
+{
+    glDeleteBuffers(1, &buffer);
+    for (auto& binding : s_buffers)
+    {
+        if (binding.second == buffer)
+            binding.second = 0U;
+    }
+    for (auto& binding : s_indexedBuffers)
+    {
+        if (binding.second == buffer)
+            binding.second = 0U;
+    }
+}
+
+void GLStateCache::setDefaultFramebuffer(const GLuint framebuffer)
+{
+    s_defaultFramebuffer = framebuffer;
+}
+
+void GLStateCache::invalidate()
+{
+    s_program.reset();
+    s_vao.reset();
+    s_framebuffer.reset();
+    s_viewport.reset();
+    s_depthMask.reset();
+    s_cullFace.reset();
+    s_capabilities.clear();
+    s_buffers.clear();
+    s_indexedBuffers.clear();
+}
+
+void GLStateCache::newFrame()
+{
+    s_lastFrameStats = s_frameStats;
+    s_frameStats = Stats();
+}
+
+const GLStateCache::Stats& GLStateCache::getLastFrameStats()
+{
+    return s_lastFrameStats;
+}
+
+void GLStateCache::showGUIContent()
+{
+    const unsigned total = s_lastFrameStats.issued + s_lastFrameStats.elided;
+    ImGui::Text("GL state calls: %u issued, %u elided", s_lastFrameStats.issued, s_lastFrameStats.elided);
+    if (total > 0)
+        ImGui::Text("%.1f %% redundant", 100.0f * s_lastFrameStats.elided / total);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+/**
+ * \brief tracks the OpenGL state that is set through it and skips calls that would not change anything.
+ * State that has been set through the cache must not be changed with raw GL calls, call invalidate() if that can not be avoided.
+ * State that was never set through the cache is unknown, the first call always gets issued
+ */
+class GLStateCache
+{
+public:
+    /**
+     * \brief number of state calls since the last newFrame()
+     */
+    struct Stats
+    {
+        unsigned issued = 0;
+        unsigned elided = 0;
+    };
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vao);
+    static void bindFramebuffer(GLuint framebuffer);
+    static void bindBuffer(GLenum target, GLuint buffer);
+    static void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+    static void setEnabled(GLenum capability, bool enabled);
+    static void depthMask(GLboolean flag);
+    static void cullFace(GLenum mode);
+
+    /**
+     * \brief returns the current viewport, only queries OpenGL if it has never been set through the cache
+     * \return x, y, width, height
+     */
+    static std::array<GLint, 4> getViewport();
+
+    /**
+     * \brief returns whether a capability is enabled, only queries OpenGL if it has never been set through the cache
+     */
+    static bool isEnabled(GLenum capability);
+
+    /**
+     * \brief returns the current depth mask, only queries OpenGL if it has never been set through the cache
+     */
+    static GLboolean getDepthMask();
+
+    /**
+     * \brief deletes the objects and removes them from the cached bindings, their names may be reused by OpenGL
+     */
+    static void deleteProgram(GLuint program);
+    static void deleteVertexArray(GLuint vao);
+    static void deleteFramebuffer(GLuint framebuffer);
+    static void deleteBuffer(GLuint buffer);
+
+    /**
+     * \brief replaces framebuffer 0 in bindFramebuffer, used for the offscreen framebuffer of headless contexts
+     */
+    static void setDefaultFramebuffer(GLuint framebuffer);
+
+    /**
+     * \brief forgets all cached state, the next call of every kind gets issued
+     */
+    static void invalidate();
+
+    /**
+     * \brief stores the counters of the last frame and resets them, call once per frame
+     */
+    static void newFrame();
+
+    /**
+     * \brief returns the counters of the last complete frame
+     */
+    static const Stats& getLastFrameStats();
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    static void showGUIContent();
+
+private:
+    static bool changed(bool isDifferent);
+
+    static std::optional<GLuint> s_program;
+    static std::optional<GLuint> s_vao;
+    static std::optional<GLuint> s_framebuffer;
+    static GLuint s_defaultFramebuffer;
+    static std::optional<std::array<GLint, 4>> s_viewport;
+    static std::optional<GLboolean> s_depthMask;
+    static std::optional<GLenum> s_cullFace;
+    static std::unordered_map<GLenum, bool> s_capabilities;
+    static std::unordered_map<GLenum, GLuint> s_buffers;
+    static std::map<std::pair<GLenum, GLuint>, GLuint> s_indexedBuffers;
+
+    static Stats s_frameStats;
+    static Stats s_lastFrameStats;
+};
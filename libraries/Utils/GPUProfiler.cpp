@@ -0,0 +1,144 @@
+#include "GPUProfiler.h"
+
+#include <stdexcept>
+
+#include "imgui/imgui.h"
+#include "Tracer.h"
+
+std::array<GPUProfiler::FrameQueries, GPUProfiler::s_frameLatency> GPUProfiler::s_frames;
+size_t GPUProfiler::s_currentFrame = 0;
+std::vector<size_t> GPUProfiler::s_openScopes;
+std::vector<GPUProfiler::Result> GPUProfiler::s_results;
+bool GPUProfiler::s_newResults = false;
+std::unordered_map<std::string, float> GPUProfiler::s_averages;
+unsigned GPUProfiler::s_droppedFrames = 0;
+int64_t GPUProfiler::s_gpuToTracerOffset = 0;
+
+void GPUProfiler::beginScope(const std::string_view name)
+{
+    auto& frame = s_frames[s_currentFrame];
+    const int depth = static_cast<int>(s_openScopes.size());
+    std::string path = s_openScopes.empty() ? std::string() : frame.scopes[s_openScopes.back()].path + "/";
+    path += name;
+
+    frame.scopes.push_back({ std::move(path), std::string(name), depth, timestamp(), 0 });
+    s_openScopes.push_back(frame.scopes.size() - 1);
+}
+
+void GPUProfiler::endScope()
+{
+    if (s_openScopes.empty())
+        throw std::runtime_error("GPUProfiler::endScope called without an open scope");
+
+    s_frames[s_currentFrame].scopes[s_openScopes.back()].endQuery = timestamp();
+    s_openScopes.pop_back();
+}
+
+void GPUProfiler::newFrame()
+{
+    if (!s_openScopes.empty())
+        throw std::runtime_error("GPUProfiler::newFrame called with open scope " + s_frames[s_currentFrame].scopes[s_openScopes.back()].name);
+
+    if (Tracer::isEnabled())
+    {
+        // GL_TIMESTAMP is returned without waiting for the GPU
+        GLint64 gpuNow;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        s_gpuToTracerOffset = Tracer::now() - gpuNow;
+    }
+
+    // the next set of queries was recorded s_frameLatency - 1 frames ago
+    s_currentFrame = (s_currentFrame + 1) % s_frameLatency;
+    s_newResults = collect(s_frames[s_currentFrame]);
+}
+
+const std::vector<GPUProfiler::Result>& GPUProfiler::getResults()
+{
+    return s_results;
+}
+
+bool GPUProfiler::hasNewResults()
+{
+    return s_newResults;
+}
+
+void GPUProfiler::showGUIContent()
+{
+    if (s_results.empty())
+    {
+        ImGui::Text("No GPU scopes recorded");
+        return;
+    }
+
+    for (const auto& result : s_results)
+    {
+        ImGui::Text("%*s%s", result.depth * 2, "", result.name.c_str());
+        ImGui::SameLine(220.0f);
+        ImGui::Text("%7.3f ms", result.averageMs);
+    }
+    if (s_droppedFrames > 0)
+        ImGui::TextDisabled("%u frames dropped, GPU more than %d frames behind", s_droppedFrames, static_cast<int>(s_frameLatency));
+}
+
+GLuint GPUProfiler::timestamp()
+{
+    auto& frame = s_frames[s_currentFrame];
+    if (frame.usedQueries == frame.queries.size())
+    {
+        GLuint query;
+        glCreateQueries(GL_TIMESTAMP, 1, &query);
+        frame.queries.push_back(query);
+    }
+    const GLuint query = frame.queries[frame.usedQueries++];
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+
+bool GPUProfiler::collect(FrameQueries& frame)
+{
+    bool collected = false;
+    if (frame.usedQueries > 0)
+    {
+        // timestamps complete in order, so only the last one has to be checked
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            s_results.clear();
+            for (const auto& scope : frame.scopes)
+            {
+                GLuint64 begin, end;
+                glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+                const float ms = (end - begin) / 1000000.0f;
+
+                const auto search = s_averages.find(scope.path);
+                const float average = search == s_averages.end() ? ms : 0.95f * search->second + 0.05f * ms;
+                s_averages[scope.path] = average;
+                s_results.push_back({ scope.name, scope.path, scope.depth, ms, average });
+
+                if (Tracer::isEnabled())
+                    Tracer::recordGPU(scope.name, static_cast<int64_t>(begin) + s_gpuToTracerOffset, static_cast<int64_t>(end) + s_gpuToTracerOffset);
+            }
+            collected = true;
+        }
+        else
+        {
+            s_droppedFrames++;
+        }
+    }
+
+    frame.scopes.clear();
+    frame.usedQueries = 0;
+    return collected;
+}
+
+GPUProfileScope::GPUProfileScope(const std::string_view name)
+{
+    GPUProfiler::beginScope(name);
+}
+
+GPUProfileScope::~GPUProfileScope()
+{
+    GPUProfiler::endScope();
+}
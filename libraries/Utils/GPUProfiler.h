@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+using namespace gl;
+
+/**
+ * \brief measures named, nestable GPU scopes with GL_TIMESTAMP queries without stalling.
+ * Every frame records into its own set of queries, the results are read when the set is reused
+ * s_frameLatency frames later. If the GPU is even further behind, the results of that frame are dropped instead of waited for.
+ */
+class GPUProfiler
+{
+public:
+    /**
+     * \brief measured time of one scope
+     */
+    struct Result
+    {
+        std::string name;
+        std::string path;   // names of the parents and the scope separated by '/', identifies the scope
+        int depth;          // nesting level, 0 for top level scopes
+        float ms;           // time of the frame the result belongs to
+        float averageMs;    // smoothed over the last frames
+    };
+
+    static constexpr size_t s_frameLatency = 4;
+
+    /**
+     * \brief starts a scope, scopes have to be ended in reverse order
+     * \param name debug name in the GUI, scopes are identified by their name and the names of their parents
+     */
+    static void beginScope(std::string_view name);
+
+    /**
+     * \brief ends the innermost open scope
+     */
+    static void endScope();
+
+    /**
+     * \brief finishes the recording of the current frame and collects the oldest frame, call once per frame outside of any scope
+     */
+    static void newFrame();
+
+    /**
+     * \brief returns the scopes of the latest frame whose results were available, in the order they were begun
+     */
+    static const std::vector<Result>& getResults();
+
+    /**
+     * \brief returns true if the last newFrame() collected a frame. Otherwise getResults() still returns an older frame
+     */
+    static bool hasNewResults();
+
+    /**
+     * \brief returns gui content to use with imgui
+     */
+    static void showGUIContent();
+
+private:
+    struct RecordedScope
+    {
+        std::string path;
+        std::string name;
+        int depth;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<RecordedScope> scopes;
+        std::vector<GLuint> queries;    // query objects are kept and reused
+        size_t usedQueries = 0;
+    };
+
+    static GLuint timestamp();
+    /**
+     * \brief reads the results of the frame if they are available and resets the frame, returns true if s_results was replaced
+     */
+    static bool collect(FrameQueries& frame);
+
+    static std::array<FrameQueries, s_frameLatency> s_frames;
+    static size_t s_currentFrame;
+    static std::vector<size_t> s_openScopes;
+    static std::vector<Result> s_results;
+    static bool s_newResults;
+    static std::unordered_map<std::string, float> s_averages;
+    static unsigned s_droppedFrames;
+    static int64_t s_gpuToTracerOffset;    // GL_TIMESTAMP to Tracer::now()
+};
+
+/**
+ * \brief profiles the GPU commands issued during its lifetime
+ */
+class GPUProfileScope
+{
+public:
+    explicit GPUProfileScope(std::string_view name);
+    ~GPUProfileScope();
+
+    GPUProfileScope(const GPUProfileScope&) = delete;
+    GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+};
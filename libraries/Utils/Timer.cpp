@@ -3,35 +3,45 @@
 
 Timer::Timer()
 {
-    glCreateQueries(GL_TIME_ELAPSED, 1, &m_query);
+    glCreateQueries(GL_TIME_ELAPSED, static_cast<GLsizei>(s_queryCount), m_queries.data());
 }
 
 Timer::~Timer()
 {
     if (glfwGetCurrentContext() != nullptr)
     {
-        glDeleteQueries(1, &m_query);
+        glDeleteQueries(static_cast<GLsizei>(s_queryCount), m_queries.data());
     }
     util::getGLerror(__LINE__, __FUNCTION__);
 }
 
 void Timer::start() const
 {
-    glBeginQuery(GL_TIME_ELAPSED, m_query);
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_current]);
 }
 
 void Timer::stop()
 {
     glEndQuery(GL_TIME_ELAPSED);
-    while (!m_done)
-    {
-        glGetQueryObjectiv(m_query, GL_QUERY_RESULT_AVAILABLE, &m_done);
-    }
-    glGetQueryObjectuiv(m_query, GL_QUERY_RESULT, &m_elapsedTime);
-    m_ftimes.push_back(m_elapsedTime / 1000000.f);
-    if (m_ftimes.size() > 1000)
+    m_issued[m_current] = true;
+    m_current = (m_current + 1) % s_queryCount;
+
+    // the next query was issued s_queryCount - 1 frames ago, skip it instead of waiting if the GPU is further behind
+    if (m_issued[m_current])
     {
-        m_ftimes.erase(m_ftimes.begin());
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[m_current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 elapsedTime;
+            glGetQueryObjectui64v(m_queries[m_current], GL_QUERY_RESULT, &elapsedTime);
+            m_ftimes.push_back(elapsedTime / 1000000.f);
+            if (m_ftimes.size() > 1000)
+            {
+                m_ftimes.erase(m_ftimes.begin());
+            }
+        }
+        m_issued[m_current] = false;
     }
     util::getGLerror(__LINE__, __FUNCTION__);
 }
@@ -74,7 +84,7 @@ void Timer::drawGuiContent(GLFWwindow* window, bool compact)
 			ImGui::EndTooltip();
 		}
 		//don't show plot if not enough space
-		if (availableWidth >= 300)
+		if (availableWidth >= 300 && !m_ftimes.empty())
 		{
 			ImGui::SameLine(ImGui::GetWindowContentRegionWidth() - 230);
 			ImGui::PushItemWidth(240);
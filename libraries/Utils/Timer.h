@@ -1,11 +1,16 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <glbinding/gl/gl.h>
 using namespace gl;
 
 #include "Utils/UtilCollection.h"
 
+/**
+ * \brief measures the GPU time between start() and stop() without waiting for the GPU.
+ * Each frame uses its own query, results are read s_queryCount - 1 frames later
+ */
 class Timer
 {
 public:
@@ -18,7 +23,7 @@ public:
     void start() const;
 
     /**
-     * \brief stops the GPU timer
+     * \brief stops the GPU timer and collects the oldest result if it is available
      */
     void stop();
 
@@ -36,8 +41,10 @@ public:
 	void drawGuiContent(GLFWwindow* window, bool compact = false);
 
 private:
+    static constexpr size_t s_queryCount = 4;
+
     std::vector<float> m_ftimes;
-    GLuint m_query;
-    GLuint m_elapsedTime = 0U;
-    int m_done = false;
+    std::array<GLuint, s_queryCount> m_queries;
+    std::array<bool, s_queryCount> m_issued{};
+    size_t m_current = 0;
 };
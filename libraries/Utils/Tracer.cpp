@@ -0,0 +1,171 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+const std::chrono::steady_clock::time_point Tracer::s_epoch = std::chrono::steady_clock::now();
+std::atomic<bool> Tracer::s_enabled{ false };
+
+std::mutex Tracer::s_registryMutex;
+std::vector<std::unique_ptr<Tracer::ThreadBuffer>> Tracer::s_threadBuffers;
+
+std::mutex Tracer::s_gpuMutex;
+std::vector<Tracer::GPUEvent> Tracer::s_gpuEvents;
+size_t Tracer::s_gpuHead = 0;
+
+int Tracer::s_captureFramesLeft = 0;
+std::experimental::filesystem::path Tracer::s_captureFile;
+
+namespace
+{
+    // the GPU track gets its own thread id in the trace
+    constexpr uint32_t gpuTrackID = 0;
+
+    std::string escapeJSON(const std::string& s)
+    {
+        std::string escaped;
+        escaped.reserve(s.size());
+        for (const char c : s)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeEvent(std::ostream& out, bool& first, const std::string& name, uint32_t tid, int64_t beginNs, int64_t endNs)
+    {
+        out << (first ? "" : ",\n") << R"({"name":")" << escapeJSON(name) << R"(","ph":"X","pid":1,"tid":)" << tid
+            << R"(,"ts":)" << beginNs / 1000.0 << R"(,"dur":)" << (endNs - beginNs) / 1000.0 << "}";
+        first = false;
+    }
+
+    void writeThreadName(std::ostream& out, bool& first, const std::string& name, uint32_t tid)
+    {
+        out << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << tid
+            << R"(,"args":{"name":")" << escapeJSON(name) << R"("}})";
+        first = false;
+    }
+}
+
+void Tracer::setEnabled(const bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(std::string name)
+{
+    auto& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    buffer.name = std::move(name);
+}
+
+void Tracer::record(const char* name, const int64_t beginNs, const int64_t endNs)
+{
+    auto& buffer = getThreadBuffer();
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % s_threadCapacity] = { name, beginNs, endNs };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::recordGPU(std::string name, const int64_t beginNs, const int64_t endNs)
+{
+    std::lock_guard<std::mutex> lock(s_gpuMutex);
+    if (s_gpuEvents.size() < s_gpuCapacity)
+        s_gpuEvents.push_back({ std::move(name), beginNs, endNs });
+    else
+        s_gpuEvents[s_gpuHead % s_gpuCapacity] = { std::move(name), beginNs, endNs };
+    s_gpuHead++;
+}
+
+void Tracer::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (auto& buffer : s_threadBuffers)
+            buffer->tail = buffer->head.load(std::memory_order_acquire);
+    }
+    std::lock_guard<std::mutex> lock(s_gpuMutex);
+    s_gpuEvents.clear();
+    s_gpuHead = 0;
+}
+
+void Tracer::captureFrames(const int frameCount, const std::experimental::filesystem::path& file)
+{
+    clear();
+    s_captureFramesLeft = frameCount;
+    s_captureFile = file;
+    setEnabled(true);
+}
+
+void Tracer::newFrame()
+{
+    if (s_captureFramesLeft > 0 && --s_captureFramesLeft == 0)
+    {
+        setEnabled(false);
+        writeChromeTrace(s_captureFile);
+    }
+}
+
+bool Tracer::isCapturing()
+{
+    return s_captureFramesLeft > 0;
+}
+
+void Tracer::writeChromeTrace(const std::experimental::filesystem::path& file)
+{
+    std::ofstream out(file);
+    if (!out)
+        throw std::runtime_error("Could not open trace file " + file.string());
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    size_t eventCount = 0;
+
+    {
+        // events of other threads may be overwritten while this reads them if their ring wraps around
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (const auto& buffer : s_threadBuffers)
+        {
+            writeThreadName(out, first, buffer->name.empty() ? "Thread " + std::to_string(buffer->id) : buffer->name, buffer->id);
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t begin = std::max(buffer->tail, head > s_threadCapacity ? head - s_threadCapacity : 0);
+            for (uint64_t i = begin; i < head; i++)
+            {
+                const Event& event = buffer->events[i % s_threadCapacity];
+                writeEvent(out, first, event.name, buffer->id, event.beginNs, event.endNs);
+            }
+            eventCount += head - begin;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_gpuMutex);
+        writeThreadName(out, first, "GPU", gpuTrackID);
+        for (const auto& event : s_gpuEvents)
+            writeEvent(out, first, event.name, gpuTrackID, event.beginNs, event.endNs);
+        eventCount += s_gpuEvents.size();
+    }
+
+    out << "\n]}\n";
+    std::cout << "Wrote " << eventCount << " trace events to " << file.string() << std::endl;
+}
+
+Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        // buffers are never freed, so events of finished threads stay available
+        auto newBuffer = std::make_unique<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        newBuffer->id = static_cast<uint32_t>(s_threadBuffers.size() + 1);
+        buffer = newBuffer.get();
+        s_threadBuffers.push_back(std::move(newBuffer));
+    }
+    return *buffer;
+}
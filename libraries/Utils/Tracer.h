@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \brief records CPU scopes of all threads and GPU ranges of the GPUProfiler and writes them as Chrome trace (JSON),
+ * viewable in chrome://tracing or Perfetto.
+ * Every thread writes into its own ring buffer without locking, only the newest s_threadCapacity scopes per thread are kept.
+ * Scopes are placed with the TRACE_SCOPE macro, which compiles to nothing unless G2_TRACING is defined (CMake option G2_ENABLE_TRACING)
+ */
+class Tracer
+{
+public:
+    static constexpr size_t s_threadCapacity = 1 << 16;
+    static constexpr size_t s_gpuCapacity = 1 << 14;
+
+    /**
+     * \brief nanoseconds since the start of the program
+     */
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+    }
+
+    static bool isEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief starts or stops recording, stopping keeps the recorded events
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * \brief names the calling thread in the trace
+     */
+    static void setThreadName(std::string name);
+
+    /**
+     * \brief records a finished scope of the calling thread
+     * \param name has to outlive the tracer, e.g. a string literal
+     */
+    static void record(const char* name, int64_t beginNs, int64_t endNs);
+
+    /**
+     * \brief records a GPU range, times have to be converted to the tracer's clock already
+     */
+    static void recordGPU(std::string name, int64_t beginNs, int64_t endNs);
+
+    /**
+     * \brief drops all recorded events
+     */
+    static void clear();
+
+    /**
+     * \brief clears the recorded events, records the next frameCount frames and writes them to file
+     * \param frameCount number of newFrame() calls to record
+     * \param file output file of the trace
+     */
+    static void captureFrames(int frameCount, const std::experimental::filesystem::path& file);
+
+    /**
+     * \brief counts frames for captureFrames(), call once per frame
+     */
+    static void newFrame();
+
+    /**
+     * \brief returns true while a capture from captureFrames() is running
+     */
+    static bool isCapturing();
+
+    /**
+     * \brief writes all recorded events as Chrome trace JSON
+     * \param file output file of the trace
+     */
+    static void writeChromeTrace(const std::experimental::filesystem::path& file);
+
+private:
+    struct Event
+    {
+        const char* name;
+        int64_t beginNs;
+        int64_t endNs;
+    };
+
+    struct GPUEvent
+    {
+        std::string name;
+        int64_t beginNs;
+        int64_t endNs;
+    };
+
+    // only the owning thread writes, head is published after the event is written
+    struct ThreadBuffer
+    {
+        std::array<Event, s_threadCapacity> events;
+        std::atomic<uint64_t> head{ 0 };
+        uint64_t tail = 0;      // first valid event after clear(), only touched while holding s_registryMutex
+        uint32_t id;
+        std::string name;
+    };
+
+    static ThreadBuffer& getThreadBuffer();
+
+    static const std::chrono::steady_clock::time_point s_epoch;
+    static std::atomic<bool> s_enabled;
+
+    static std::mutex s_registryMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_threadBuffers;
+
+    static std::mutex s_gpuMutex;
+    static std::vector<GPUEvent> s_gpuEvents;
+    static size_t s_gpuHead;
+
+    static int s_captureFramesLeft;
+    static std::experimental::filesystem::path s_captureFile;
+};
+
+/**
+ * \brief records the time between its construction and destruction on the calling thread
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) : m_name(name), m_beginNs(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_beginNs >= 0)
+            Tracer::record(m_name, m_beginNs, Tracer::now());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_beginNs;
+};
+
+#define G2_TRACE_CONCAT_IMPL(a, b) a##b
+#define G2_TRACE_CONCAT(a, b) G2_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef G2_TRACING
+#define TRACE_SCOPE(name) const TraceScope G2_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
@@ -1,16 +1,26 @@
 #include "UtilCollection.h"
+#include "GLStateCache.h"
+#include "FrameCapture.h"
+#include "glsp/glsp.hpp"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
+#include <array>
 #include <ctime>
+#include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <sstream>
-#include <future>
 #include <glbinding/Binding.h>
 #include <glbinding-aux/Meta.h>
 
 namespace util
 {
+    namespace
+    {
+        std::optional<bool> s_headless;
+    }
+
     std::string convertGLubyteToString(const GLubyte* content)
     {
         return std::string(reinterpret_cast<const char*>(content));
@@ -24,9 +34,47 @@ namespace util
         std::cout << "Shading Language Version: " << convertGLubyteToString(glGetString(GL_SHADING_LANGUAGE_VERSION)) << std::endl;
     }
 
+    void setHeadless(bool headless)
+    {
+        s_headless = headless;
+    }
+
+    bool isHeadless()
+    {
+        if (!s_headless)
+        {
+            const char* env = std::getenv("G2_HEADLESS");
+            s_headless = env != nullptr && std::string(env) != "0" && std::string(env) != "";
+        }
+        return *s_headless;
+    }
+
     GLFWwindow* setupGLFWwindow(unsigned int width, unsigned int height, std::string name)
     {
-        glfwInit();
+        if (isHeadless())
+        {
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+            // the null platform needs no display server
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+            if (!glfwInit())
+                throw std::runtime_error("Could not initialize GLFW for a headless context");
+
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#ifdef GLFW_OSMESA_CONTEXT_API
+            const char* env = std::getenv("G2_HEADLESS");
+            if (env != nullptr && std::string(env) == "osmesa")
+                glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        }
+        else
+        {
+            glfwInit();
+        }
 
         if constexpr (debugmode)
             glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, 1);
@@ -39,6 +87,8 @@ namespace util
         glfwWindowHint(GLFW_SAMPLES, 1);
 
         GLFWwindow* window = glfwCreateWindow(width, height, name.c_str(), nullptr, nullptr);
+        if (window == nullptr && isHeadless())
+            throw std::runtime_error("Could not create a headless context, check G2_HEADLESS and the EGL/OSMesa installation");
         glfwMakeContextCurrent(window);
         return window;
     }
@@ -47,6 +97,31 @@ namespace util
     {
         // init glbinding
         glbinding::Binding::initialize(glfwGetProcAddress);
+
+        // the preprocessor evaluates extension macros against this list, it may run on threads without a context
+        glsp::set_extensions(getGLExtenstions());
+
+        if (isHeadless())
+        {
+            // surfaceless contexts have no default framebuffer, everything that targets framebuffer 0 goes here instead
+            int width;
+            int height;
+            glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+
+            GLuint framebuffer;
+            std::array<GLuint, 2> renderbuffers;
+            glCreateFramebuffers(1, &framebuffer);
+            glCreateRenderbuffers(2, renderbuffers.data());
+            glNamedRenderbufferStorage(renderbuffers[0], GL_RGBA8, width, height);
+            glNamedRenderbufferStorage(renderbuffers[1], GL_DEPTH24_STENCIL8, width, height);
+            glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+            glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+            if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                throw std::runtime_error("Offscreen framebuffer of the headless context is incomplete");
+
+            GLStateCache::setDefaultFramebuffer(framebuffer);
+            GLStateCache::bindFramebuffer(0);
+        }
     }
 
     std::vector<std::string> getGLExtenstions()
@@ -112,36 +187,11 @@ namespace util
         }
     }
 
-    void savePNG(std::string name, std::vector<unsigned char>& image, int width, int height)
-    {
-        std::stringstream path;
-        path << (util::gs_resourcesPath) << "../../" << name << "_" << time(nullptr) << ".png";
-
-        stbi_flip_vertically_on_write(true);
-        const auto err = stbi_write_png(path.str().c_str(), width, height, 4, image.data(), 4 * width);
-        if (err == 0)
-            throw std::runtime_error("error writing image");
-    }
-
     void saveFBOtoFile(std::string name, GLFWwindow* window)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        int width;
-        int height;
-        glfwGetFramebufferSize(window, &width, &height);
-        std::vector<unsigned char> image;
-        image.resize(width * height * 4);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
-
-        //Encode the image
-        try
-        {
-            auto future = std::async(std::launch::async, [&]() { savePNG(name, image, width, height); });
-        }
-        catch (std::runtime_error& ex)
-        {
-            std::cout << ex.what() << std::endl;
-        }
+        glfwMakeContextCurrent(window);
+        FrameCapture::captureFrame(gs_resourcesPath / "../.." / (name + "_" + std::to_string(time(nullptr)) + ".png"), ImageFormat::png);
+        // a single screenshot does not wait for FrameCapture::endFrame(), only the encoding runs in the background
+        FrameCapture::waitForReadbacks();
     }
 }
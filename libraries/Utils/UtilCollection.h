@@ -22,6 +22,19 @@ namespace util
      */
     void printOpenGLInfo();
 
+    /**
+     * \brief selects the headless context for setupGLFWwindow, overrides the G2_HEADLESS environment variable.
+     * Headless contexts have no window, the default framebuffer is replaced by an offscreen one
+     * \param headless true to create a headless context
+     */
+    void setHeadless(bool headless);
+
+    /**
+     * \brief returns true if setupGLFWwindow creates a headless context.
+     * Set by setHeadless or by G2_HEADLESS=egl (EGL, surfaceless if available) or G2_HEADLESS=osmesa
+     */
+    bool isHeadless();
+
     /**
      * \brief sets up a GLFW window/context
      * \param width window width in pixels
@@ -32,7 +45,8 @@ namespace util
     GLFWwindow* setupGLFWwindow(unsigned int width, unsigned int height, std::string name);
 
     /**
-     * \brief inits the graphics API
+     * \brief inits the graphics API, passes the extensions of the context to the shader preprocessor and
+     * creates the offscreen default framebuffer of a headless context
      */
     void initGL();
 
@@ -50,7 +64,7 @@ namespace util
     void getGLerror(int line, std::string function);
 
     /**
-     * \brief saves the FBO content to a PNG file (starts a new thread)
+     * \brief saves the FBO content to a PNG file, read back and encoded in the background by FrameCapture
      * \param name output filename
      * \param window glfw window
      */
@@ -0,0 +1,12 @@
+#version 460
+
+in vec3 passNormal;
+in float passViewDepth;
+
+// world space normal facing the camera and view depth for ConeTraceAmbient.comp
+out vec4 gBuffer;
+
+void main()
+{
+    gBuffer = vec4(normalize(passNormal) * (gl_FrontFacing ? 1.f : -1.f), passViewDepth);
+}
@@ -0,0 +1,24 @@
+#version 460
+
+layout (location = VERTEX_LAYOUT) in vec3 vertexPosition;
+layout (location = NORMAL_LAYOUT) in vec3 vertexNormal;
+
+layout (std430, binding = MODELMATRICES_BINDING) buffer ModelMatrixBuffer
+{
+    mat4 modelMatrices[];
+};
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+out vec3 passNormal;
+out float passViewDepth;
+
+void main()
+{
+    mat4 modelMatrix = modelMatrices[gl_DrawID];
+    vec4 viewPos = viewMatrix * modelMatrix * vec4(vertexPosition, 1.0f);
+    passViewDepth = -viewPos.z;
+    gl_Position = projectionMatrix * viewPos;
+    passNormal = mat3(transpose(inverse(modelMatrix))) * vertexNormal;
+}
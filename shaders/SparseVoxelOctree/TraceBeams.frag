@@ -0,0 +1,134 @@
+#version 450
+
+//one fragment per tile of beamTileSize^2 pixels of the full resolution pass
+uniform mat4 inverseViewProjection;
+uniform vec3 camPosition;
+uniform vec2 resolution; //of the full resolution pass
+uniform int beamTileSize;
+
+layout(binding = 2, std430) buffer nodePool_buffer
+{
+    int nodePool[];
+};
+
+layout(binding = 3, std430) buffer nodeColor_buffer
+{
+    uint nodeColor[];
+};
+
+#include "SparseVoxelOctree/nodeColor.glsl"
+#include "SparseVoxelOctree/traversal.glsl"
+
+uniform int maxLevel = 10; //only for level debugging!
+uniform vec3 bmin;
+uniform vec3 bmax;
+
+layout(location = 0) out float beamDistance;
+
+//up to 8 children are pushed for every popped node, 7 per level of depth 10 and the root
+#define BEAM_STACK_SIZE 72
+
+//ray of sfq_rayDir.vert through a position in pixels of the full resolution pass
+vec3 rayDirection(vec2 pixel)
+{
+    vec4 originPlusDir = inverseViewProjection * vec4(pixel / resolution * 2.f - 1.f, 0.f, 1.f);
+    return normalize(originPlusDir.xyz / originPlusDir.w - camPosition);
+}
+
+//interval of the ray in a box grown by the radius of the beam at the box corner farthest from the origin.
+//Every ray of the beam hitting the box hits it behind the returned entry
+bool intersectBeam(vec3 origin, vec3 invDir, float tanAngle, vec3 boxMin, vec3 boxMax, out float tEnter)
+{
+    float radius = tanAngle * length(max(abs(boxMin - origin), abs(boxMax - origin)));
+    vec3 t1 = (boxMin - radius - origin) * invDir;
+    vec3 t2 = (boxMax + radius - origin) * invDir;
+    tEnter = max(compMax(min(t1, t2)), 0.f);
+    return tEnter <= compMin(max(t1, t2));
+}
+
+//smallest distance any ray of the beam can hit a filled node at, negative if there is none.
+//Depth first with the children near the origin first, subtrees starting behind the best distance so far are skipped.
+//Filled nodes smaller than the beam stand for their whole subtree
+float traceBeam(vec3 origin, vec3 dir, float tanAngle)
+{
+    vec3 invDir = 1.f / (max(abs(dir), vec3(1e-7)) * mix(vec3(-1.f), vec3(1.f), greaterThanEqual(dir, vec3(0.f))));
+    int nearChild = (dir.x < 0.f ? 1 : 0) | (dir.y < 0.f ? 2 : 0) | (dir.z < 0.f ? 4 : 0);
+    float rootSize = bmax.x - bmin.x;
+    float best = 3.402823e38f;
+
+    //node, level, position packed with 10 bits per axis, entry distance
+    ivec4 stack[BEAM_STACK_SIZE];
+    int stackPointer = 0;
+    float tEnter;
+    if(intersectBeam(origin, invDir, tanAngle, bmin, bmax, tEnter))
+    {
+        stack[stackPointer++] = ivec4(0, 0, 0, floatBitsToInt(tEnter));
+    }
+
+    while(stackPointer > 0)
+    {
+        ivec4 entry = stack[--stackPointer];
+        float nodeEnter = intBitsToFloat(entry.w);
+        if(nodeEnter >= best)
+        {
+            continue;
+        }
+
+        int node = entry.x;
+        uint mask = nodeChildMask(nodeColor[node]);
+        if(mask == 0u)
+        {
+            continue;
+        }
+
+        int level = entry.y;
+        ivec3 position = (ivec3(entry.z) >> ivec3(0, 10, 20)) & 0x3ff;
+        int children = nodePool[node];
+        float childSize = rootSize / float(1 << (level + 1));
+        vec3 nodeMin = bmin + vec3(position) * 2.f * childSize;
+        float radius = tanAngle * length(max(abs(nodeMin - origin), abs(nodeMin + 2.f * childSize - origin)));
+        if(level >= maxLevel || children <= 0 || childSize <= radius)
+        {
+            best = nodeEnter;
+            continue;
+        }
+
+        for(int i = 7; i >= 0; --i)
+        {
+            int index = i ^ nearChild;
+            if(((mask >> index) & 1u) == 0u)
+            {
+                continue;
+            }
+            ivec3 offset = (ivec3(index) >> ivec3(0, 1, 2)) & 1;
+            vec3 childMin = nodeMin + vec3(offset) * childSize;
+            if(intersectBeam(origin, invDir, tanAngle, childMin, childMin + childSize, tEnter) && tEnter < best)
+            {
+                ivec3 childPosition = position * 2 + offset;
+                stack[stackPointer++] = ivec4(children + index, level + 1, childPosition.x | (childPosition.y << 10) | (childPosition.z << 20), floatBitsToInt(tEnter));
+            }
+        }
+    }
+    return best < 3.402823e38f ? best : -1.f;
+}
+
+void main()
+{
+    //the beam around the ray through the tile center contains the rays through the outermost pixel centers of the tile
+    ivec2 tileMin = ivec2(gl_FragCoord.xy) * beamTileSize;
+    ivec2 tileMax = min(tileMin + beamTileSize, ivec2(resolution));
+    vec2 low = vec2(tileMin) + 0.5f;
+    vec2 high = vec2(tileMax) - 0.5f;
+    vec3 dir = rayDirection(0.5f * (low + high));
+    vec2 corners[4] = vec2[](low, high, vec2(low.x, high.y), vec2(high.x, low.y));
+    float tanAngle = 0.f;
+    for(int i = 0; i < 4; ++i)
+    {
+        vec3 cornerDir = rayDirection(corners[i]);
+        tanAngle = max(tanAngle, length(cross(dir, cornerDir)) / max(dot(dir, cornerDir), 1e-3f));
+    }
+    //slightly wider than needed, the pixel rays are interpolated
+    tanAngle *= 1.05f;
+
+    beamDistance = traceBeam(camPosition, dir, tanAngle);
+}
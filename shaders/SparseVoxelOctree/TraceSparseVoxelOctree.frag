@@ -1,4 +1,5 @@
 #version 450
+#extension GL_ARB_bindless_texture : require
 
 in vec3 passDir;
 uniform vec3 camPosition;
@@ -10,152 +11,160 @@ layout(binding = 2, std430) buffer nodePool_buffer
 
 layout(binding = 3, std430) buffer nodeColor_buffer
 {
-    vec4 nodeColor[];
+    uint nodeColor[];
 };
 
-#define is_leaf (node == -1)
+#include "SparseVoxelOctree/nodeColor.glsl"
+#include "SparseVoxelOctree/traversal.glsl"
+#include "SparseVoxelOctree/brickPool.glsl"
 
-void handleLeaf(in int nodeID, inout vec4 color, inout bool hit)
-{
-    if(nodeColor[nodeID].w > 0.0f)
-    {
-        hit = true;
-        color = nodeColor[nodeID];
-    }
-}
+uniform int maxLevel = 10; //only for level debugging!
+uniform vec3 bmin;
+uniform vec3 bmax;
 
-float compMax(vec3 v)
-{
-    return max(v.x,max(v.y,v.z));
-}
+// distance all rays of a tile of beamTileSize^2 pixels can start at, negative if none of them hits anything, see TraceBeams.frag.
+// A tile size of 0 traces without the beam pass
+uniform int beamTileSize = 0;
+layout(bindless_sampler) uniform sampler2D beamDistances;
 
-float compMin(vec3 v)
-{
-    return min(v.x,min(v.y,v.z));
-}
+// hits are colored with the trilinearly filtered brick pool instead of the color of the node, see brickPool.glsl
+uniform bool filterBricks = false;
+layout(bindless_sampler) uniform sampler3D brickPool;
 
-bool rayBoxIntersect( vec3 rpos, vec3 rdir, vec3 vmin, vec3 vmax, out float tMin, out float tMax)
-{
-   vec3 t1 = (vmin - rpos)/rdir;
-   vec3 t2 = (vmax - rpos)/rdir;
-   tMin = compMax(min(t1,t2));
-   tMax = compMin(max(t1,t2));
-   return tMin < tMax;
-}
+// the short stack keeps the nodes of the last levels, the traversal restarts at the root if it has to go further up
+#define SHORT_STACK_SIZE 4
 
-bool rayInvBoxIntersect( vec3 rpos, vec3 rdir, vec3 vmin, vec3 vmax, out float tMin, out float tMax)
+//front to back traversal of the children of every node, the ray is mirrored so all direction components are positive.
+//Children missing in the occupancy mask of their parent are skipped without reading them
+vec4 trace(vec3 origin, vec3 dir, float tStart)
 {
-   vec3 t1 = (vmin - rpos)*rdir;
-   vec3 t2 = (vmax - rpos)*rdir;
-   tMin = compMax(min(t1,t2));
-   tMax = compMin(max(t1,t2));
-   return tMin < tMax;
-}
+    int mirror = mirrorRay(origin, dir, bmin, bmax);
+    vec3 invDir = 1.f / max(dir, vec3(1e-7));
+    vec3 rootT0 = (bmin - origin) * invDir;
+    vec3 rootT1 = (bmax - origin) * invDir;
+    float tMin = max(compMax(rootT0), tStart);
+    if(tMin > compMin(rootT1))
+    {
+        return vec4(-1);
+    }
 
-uniform int maxLevel = 10; //only for level debugging!
-uniform vec3 bmin;
-uniform vec3 bmax;
+    uint rootColor = nodeColor[0];
+    if(maxLevel <= 0 || nodePool[0] <= 0)
+    {
+        return nodeChildMask(rootColor) != 0u ? unpackNodeColor(rootColor) : vec4(-1);
+    }
 
-//stackless while if
-vec4 trace(vec3 origin, vec3 dir, float tMin, float tMax)
-{
-    if(!rayBoxIntersect(origin,dir,bmin,bmax,tMin,tMax) || tMax < 0.f)
+    //ring buffer of the current node and its parents, t0 and t1 are the ray parameters of the lower and upper planes
+    vec3 stackT0[SHORT_STACK_SIZE];
+    vec3 stackT1[SHORT_STACK_SIZE];
+    int stackChildren[SHORT_STACK_SIZE];
+    int stackNextChild[SHORT_STACK_SIZE]; //in mirrored order, 8 if all children are done
+    uint stackMask[SHORT_STACK_SIZE];
+
+    int top = 0;
+    int stored = 1;
+    int level = 0;
+    stackT0[0] = rootT0;
+    stackT1[0] = rootT1;
+    stackChildren[0] = nodePool[0];
+    stackNextChild[0] = firstChild(rootT0, 0.5f * (rootT0 + rootT1));
+    stackMask[0] = nodeChildMask(rootColor);
+
+    while(level >= 0)
     {
-        return vec4(-1);
+        if(stackNextChild[top] > 7)
+        {
+            //the ray left this node, continue with the next child of the parent
+            float tExit = compMin(stackT1[top]);
+            level--;
+            stored--;
+            top = (top + SHORT_STACK_SIZE - 1) % SHORT_STACK_SIZE;
+            if(level >= 0 && stored == 0)
+            {
+                //the parent is not on the short stack anymore, restart at the root behind the node that was left
+                tMin = tExit;
+                level = 0;
+                stored = 1;
+                top = 0;
+                stackT0[0] = rootT0;
+                stackT1[0] = rootT1;
+                stackChildren[0] = nodePool[0];
+                stackNextChild[0] = firstChild(rootT0, 0.5f * (rootT0 + rootT1));
+                stackMask[0] = nodeChildMask(rootColor);
+            }
+            continue;
+        }
+
+        int child = stackNextChild[top];
+        int index = child ^ mirror;
+        vec3 tm = 0.5f * (stackT0[top] + stackT1[top]);
+        bvec3 upper = bvec3(child & 1, child & 2, child & 4);
+        vec3 childT0 = mix(stackT0[top], tm, upper);
+        vec3 childT1 = mix(tm, stackT1[top], upper);
+
+        //the next sibling is across the plane the ray leaves this child through, there is none if that is the upper plane of the parent
+        int exitBit = 1 << minAxis(childT1);
+        stackNextChild[top] = (child & exitBit) != 0 ? 8 : child | exitBit;
+
+        if(((stackMask[top] >> index) & 1u) == 0u)
+        {
+            continue;
+        }
+        //nodes behind the start, or left before a restart
+        if(compMin(childT1) <= max(compMax(childT0), tMin))
+        {
+            continue;
+        }
+
+        int node = stackChildren[top] + index;
+        int children = nodePool[node];
+        uint color = nodeColor[node];
+        if(level + 1 < maxLevel && children > 0)
+        {
+            level++;
+            stored = min(stored + 1, SHORT_STACK_SIZE);
+            top = (top + 1) % SHORT_STACK_SIZE;
+            stackT0[top] = childT0;
+            stackT1[top] = childT1;
+            stackChildren[top] = children;
+            stackNextChild[top] = firstChild(childT0, 0.5f * (childT0 + childT1));
+            stackMask[top] = nodeChildMask(color);
+        }
+        else if(nodeChildMask(color) != 0u)
+        {
+            if(filterBricks)
+            {
+                //entry point in the parent, the t of each axis maps linearly to the position. The bricks are not mirrored
+                vec3 local = (max(compMax(childT0), tMin) - stackT0[top]) / (stackT1[top] - stackT0[top]);
+                local = mix(local, 1.f - local, bvec3(mirror & 1, mirror & 2, mirror & 4));
+                //the hit node itself has a weight of at least 1/8, so the alpha is never 0
+                vec4 filtered = sampleBrick(brickPool, stackChildren[top] >> 3, local);
+                return vec4(filtered.xyz / max(filtered.w, 1e-4f), 1.f);
+            }
+            return unpackNodeColor(color);
+        }
     }
-    tMin = max(tMin,0.f);
-
-    vec3 rootSize = bmax - bmin;
-    ivec3 nodePosition = ivec3(0,0,0);
-    ivec3 cIndex = ivec3(greaterThanEqual((origin + tMin * dir - bmin), vec3(0.5f * rootSize))); //clamp(ivec3(2.0f * (origin + tMin * dir - bmin) / rootSize),0,1);
-
-    int nodeID = 0;
-    int stackPointer = 0;
-    int voxelSizeFactor = 1;
-
-    bool hit = false;
-
-    dir = max(abs(dir),vec3(1e-7)) * sign(dir);
-    vec3 invDir = 1.f/dir;
-    vec3 step = vec3(dir.x < 0.f ? -1.f : 1.f, dir.y < 0.f ? -1.f : 1.f, dir.z < 0.f ? -1.f : 1.f);
-    int node;
-
-    int stack[10/*MAX_DEPTH*/];
-    stack[0] = 0;
-
-     while(stackPointer >= 0)
-     {
-          node = nodePool[nodeID];
-          //check if current node is not leaf node
-          if(node > 0 && cIndex.x != -1)
-          {
-              stackPointer++;
-              nodeID = node + cIndex.x + (cIndex.y << 1 /* *2 */) + (cIndex.z << 2 /* *2*2 */);
-              stack[stackPointer] = nodeID;
-              nodePosition = (nodePosition << 1 /* *2 */) + cIndex;
-              voxelSizeFactor <<= 1; // *2
-
-              //only for level debugging!
-              if(stackPointer >= maxLevel)
-              {
-                    vec4 tr;
-                    handleLeaf(nodeID,tr,hit);
-                    if(hit)
-                    {
-                        return tr;
-                    }
-              }
-
-              vec3 voxelSize = rootSize / voxelSizeFactor;
-              vec3 minPos = vec3(nodePosition) * voxelSize + bmin;
-              vec3 maxPos = minPos + voxelSize;
-              rayInvBoxIntersect(origin,invDir,minPos,maxPos,tMin,tMax);
-              cIndex = ivec3(greaterThanEqual((origin + max(0.f,tMin) * dir - minPos), vec3(0.5f * voxelSize))); //clamp(ivec3(2.0f * (origin + max(0.f,tMin) * dir - minPos) / voxelSize),0,1);
-
-          }
-          else
-          {
-               if(node == -1)
-               {
-                    vec4 tr;
-                    handleLeaf(nodeID,tr,hit);
-                    if(hit)
-                    {
-                        return tr;
-                    }
-                }
-
-              //this node is not needed on the stack anymore
-              stackPointer--;
-              nodeID = stack[stackPointer];
-              cIndex = nodePosition & 0x1; // %2
-              nodePosition >>= 1; // /2
-              voxelSizeFactor >>= 1; // /2
-
-              //calculate next childIndex.
-              vec3 voxelSize = rootSize / voxelSizeFactor;
-              vec3 position = (vec3(nodePosition) + vec3(cIndex)*0.5f + 0.25f + step * 0.25f) * voxelSize + bmin;
-              vec3 tStep = (position - origin) * invDir;
-              float tMin2 = compMin(tStep);
-              int tStepMinIndex = int(tStep.y == tMin2) + (int(tStep.z == tMin2) << 1 /* *2 */);
-              int cIndexNew = cIndex[tStepMinIndex] += int(step[tStepMinIndex]);
-              if(cIndexNew < 0 || cIndexNew > 1){
-                  cIndex.x = -1;
-              }
-          }
-     }
     return vec4(-1);
 }
 
 void main()
 {
-    ivec2 pixelPos = ivec2(gl_FragCoord.xy);
     vec3 dir = normalize(passDir);
     gl_FragColor = vec4(vec3(0.7f, 0.9f, 1.0f) + dir.y * 0.618f, 1.0f);
 
-    vec4 r = trace(camPosition,dir,0,1000);
+    float tStart = 0.f;
+    if(beamTileSize > 0)
+    {
+        tStart = texelFetch(beamDistances, ivec2(gl_FragCoord.xy) / beamTileSize, 0).x;
+        if(tStart < 0.f)
+        {
+            return;
+        }
+    }
+
+    vec4 r = trace(camPosition, dir, tStart);
     if(r.w >= 0)
     {
         gl_FragColor = r;
     }
-}
\ No newline at end of file
+}
@@ -9,6 +9,7 @@
 //layout(pixel_center_integer) in vec4 gl_FragCoord;
 
 uniform uvec3 res;
+uniform vec3 albedo; //average diffuse color of the material of the mesh
 
 layout(binding = 0, std430) buffer voxelFragmentList_buffer
 {
@@ -182,10 +183,13 @@ void main()
 
             int index = int(atomicCounterIncrement(voxelCounter));
             //index = uint(tc.z * res.y* res.x + tc.y * res.x + tc.x); //only for testing!
-            voxelFragmentList[index] = vec4(tc/vec3(res),1); 
+            //the counter keeps counting if the list is full, so the list can be resized and the voxelization repeated
+            if (index < voxelFragmentList.length())
+            {
+                voxelFragmentList[index] = vec4(tc/vec3(res),1); 
 
-            vec3 color = tc/vec3(res); //TODO put color in here!
-            voxelFragmentColor[index] = vec4(color, 1.0f);
+                voxelFragmentColor[index] = vec4(albedo, 1.0f);
+            }
 
         }
 
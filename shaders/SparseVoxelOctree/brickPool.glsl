@@ -0,0 +1,27 @@
+// brick pool of SparseVoxelOctree::setBrickPool, needs nodeColor.glsl.
+// Every group of 8 sibling nodes owns a brick of BRICK_SIZE^3 texels in a 3D atlas, group g (first node 8 * g) owns brick g - 1.
+// The inner 2^3 texels are the siblings (texel 1 + octant), the border holds their neighbors on the same level,
+// so hardware trilinear filtering anywhere inside the parent node only blends nodes that touch each other.
+// Texels are premultiplied, alpha is the fraction of filled children of a node (1 for filled leaves, 0 for empty nodes)
+
+#define BRICK_SIZE 4
+
+// first texel of a brick, the bricks are stored row by row and slice by slice. poolSize is the size of the atlas in bricks
+ivec3 brickOrigin(int brick, ivec3 poolSize)
+{
+    return ivec3(brick % poolSize.x, (brick / poolSize.x) % poolSize.y, brick / (poolSize.x * poolSize.y)) * BRICK_SIZE;
+}
+
+vec4 brickTexel(uint color)
+{
+    float coverage = float(bitCount(nodeChildMask(color))) / 8.f;
+    return vec4(unpackNodeColor(color).xyz * coverage, coverage);
+}
+
+// filtered premultiplied color inside the parent node of a group, local is the position in the parent in [0, 1]
+vec4 sampleBrick(sampler3D pool, int group, vec3 local)
+{
+    ivec3 size = textureSize(pool, 0);
+    vec3 texel = vec3(brickOrigin(group - 1, size / BRICK_SIZE)) + 1.f + 2.f * clamp(local, 0.f, 1.f);
+    return textureLod(pool, texel / vec3(size), 0);
+}
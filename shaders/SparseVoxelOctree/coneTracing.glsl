@@ -0,0 +1,70 @@
+// cone tracing through the mipmapped levels of a SparseVoxelOctree, needs the node pool and colors (bindings 2 and 3), nodeColor.glsl and brickPool.glsl.
+// Positions are in octree space, the octree covers [0, 1)^3 and a node of level l has the size 2^-l
+
+uniform int octreeDepth;                //deepest level of the octree
+uniform bool useBrickPool = false;      //trilinear filtering inside the parent nodes, otherwise the nodes are sampled nearest
+layout(bindless_sampler) uniform sampler3D brickPool;
+
+//node containing a position on a level, -1 if the path to it ends above that level
+int findNode(vec3 position, int level)
+{
+    ivec3 cell = ivec3(position * float(1 << level));
+    int bufferIndex = 0;
+    for(int l = 1; l <= level; ++l)
+    {
+        int childrenStartIndex = nodePool[bufferIndex];
+        if(childrenStartIndex <= 0) //empty
+            return -1;
+        ivec3 octant = (cell >> (level - l)) & 1;
+        bufferIndex = childrenStartIndex + octant.z * 4 + octant.y * 2 + octant.x;
+    }
+    return bufferIndex;
+}
+
+//premultiplied color and coverage of the nodes of a level at a position, level is at least 1
+vec4 sampleLevel(vec3 position, int level)
+{
+    if(any(lessThan(position, vec3(0.f))) || any(greaterThanEqual(position, vec3(1.f))))
+        return vec4(0.f);
+    if(useBrickPool)
+    {
+        //the brick of a group is filtered inside its parent node
+        int parent = findNode(position, level - 1);
+        if(parent < 0 || nodePool[parent] <= 0)
+            return vec4(0.f);
+        return sampleBrick(brickPool, nodePool[parent] >> 3, fract(position * float(1 << (level - 1))));
+    }
+    int node = findNode(position, level);
+    return node < 0 ? vec4(0.f) : brickTexel(nodeColor[node]);
+}
+
+//blends the two levels around a fractional level
+vec4 sampleOctree(vec3 position, float level)
+{
+    int coarse = int(floor(level));
+    vec4 result = sampleLevel(position, coarse);
+    if(level > float(coarse))
+        result = mix(result, sampleLevel(position, coarse + 1), level - float(coarse));
+    return result;
+}
+
+//accumulates the voxels a cone passes front to back, returns their premultiplied color and the opacity of the cone.
+//The samples are stepFactor times the cone diameter apart, the level of each sample has nodes of about the cone diameter
+vec4 traceCone(vec3 origin, vec3 direction, float tanHalfAngle, float maxDistance, float stepFactor, int maxSteps)
+{
+    float voxelSize = 1.f / float(1 << octreeDepth);
+    vec4 result = vec4(0.f);
+    float t = voxelSize;
+    for(int i = 0; i < maxSteps && t < maxDistance && result.a < 0.99f; ++i)
+    {
+        float diameter = max(voxelSize, 2.f * t * tanHalfAngle);
+        vec4 voxel = sampleOctree(origin + t * direction, clamp(-log2(diameter), 1.f, float(octreeDepth)));
+
+        //the coverage of a sample holds for a step of one diameter, shorter steps are less opaque
+        float alpha = 1.f - pow(1.f - clamp(voxel.a, 0.f, 1.f), stepFactor);
+        vec3 color = voxel.a > 0.f ? voxel.rgb * (alpha / voxel.a) : vec3(0.f);
+        result += (1.f - result.a) * vec4(color, alpha);
+        t += diameter * stepFactor;
+    }
+    return result;
+}
@@ -0,0 +1,36 @@
+// node colors are packed as RGBA8. The alpha of a leaf is 1 if it is filled and 0 if it is empty,
+// inner nodes store the occupancy mask of their children in the alpha byte (bit i for child i), so it is non-zero for filled nodes too.
+// SparseVoxelOctreeBuilder::packColor, unpackColor and mipmapColor do the same on the CPU
+
+uint packNodeColor(vec4 color)
+{
+    return packUnorm4x8(color);
+}
+
+vec4 unpackNodeColor(uint color)
+{
+    return unpackUnorm4x8(color);
+}
+
+uint nodeChildMask(uint color)
+{
+    return color >> 24;
+}
+
+// average of the filled children, color is not affected by empty nodes
+uint mipmapNodeColor(uint childColors[8])
+{
+    vec3 sum = vec3(0.f);
+    uint mask = 0u;
+    for(int i = 0; i < 8; ++i)
+    {
+        if(nodeChildMask(childColors[i]) != 0u)
+        {
+            sum += unpackNodeColor(childColors[i]).xyz;
+            mask |= 1u << i;
+        }
+    }
+    if(mask == 0u)
+        return 0u;
+    return (packNodeColor(vec4(sum * (1.0f / float(bitCount(mask))), 0.0f)) & 0x00ffffffu) | (mask << 24);
+}
@@ -0,0 +1,51 @@
+// helpers of the parametric octree traversal, SparseVoxelOctreeTracer does the same on the CPU
+
+float compMax(vec3 v)
+{
+    return max(v.x,max(v.y,v.z));
+}
+
+float compMin(vec3 v)
+{
+    return min(v.x,min(v.y,v.z));
+}
+
+int minAxis(vec3 v)
+{
+    return v.x <= v.y ? (v.x <= v.z ? 0 : 2) : (v.y <= v.z ? 1 : 2);
+}
+
+int maxAxis(vec3 v)
+{
+    return v.x >= v.y ? (v.x >= v.z ? 0 : 2) : (v.y >= v.z ? 1 : 2);
+}
+
+// mirrors the ray at the center of the box so all direction components are positive,
+// returns the mask that mirrors child indices back
+int mirrorRay(inout vec3 origin, inout vec3 dir, vec3 boxMin, vec3 boxMax)
+{
+    int mirror = 0;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        if(dir[axis] < 0.f)
+        {
+            origin[axis] = boxMin[axis] + boxMax[axis] - origin[axis];
+            dir[axis] = -dir[axis];
+            mirror |= 1 << axis;
+        }
+    }
+    return mirror;
+}
+
+// child of a node the mirrored ray enters first, t0 are the ray parameters of the lower planes of the node and tm of its center planes
+int firstChild(vec3 t0, vec3 tm)
+{
+    int entryAxis = maxAxis(t0);
+    int child = 0;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        if(axis != entryAxis && tm[axis] < t0[entryAxis])
+            child |= 1 << axis;
+    }
+    return child;
+}
@@ -0,0 +1,150 @@
+// triangle voxelization of the compute voxelizer, the same column walk and overlap test as SparseVoxelOctreeBuilder::voxelizeTriangle.
+// Needs the voxel fragment list and color (bindings 0 and 1), the voxel counter and the mesh buffers below
+
+layout(binding = VOXELIZE_VERTICES_BINDING, std430) buffer vertices_buffer
+{
+    float vertices[]; //tightly packed vec3
+};
+
+layout(binding = VOXELIZE_INDICES_BINDING, std430) buffer indices_buffer
+{
+    uint indices[];
+};
+
+uniform uvec3 res;
+uniform mat4 voxelMatrix; //model matrix of the mesh followed by the mapping of the octree bounds to [0, res]
+uniform vec3 albedo; //average diffuse color of the material of the mesh
+
+// triangles covering at most this many voxel columns along their dominant axis are voxelized by a single invocation
+#define MAX_SMALL_TRIANGLE_COLUMNS 64
+// larger triangles are split into tiles of TILE_SIZE^2 columns, one work group each
+#define TILE_SIZE 8
+
+struct Triangle
+{
+    vec3 v0, v1, v2;    //voxel coordinates, one voxel has size 1
+    vec3 normal;
+    ivec3 lo, hi;       //covered voxels
+    int d, a, b;        //dominant axis of the normal and the two axes of the columns
+};
+
+//returns false for degenerate triangles
+bool setupTriangle(uint triangle, out Triangle t)
+{
+    vec3 v[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        uint index = indices[triangle * 3 + i];
+        vec3 p = vec3(vertices[index * 3], vertices[index * 3 + 1], vertices[index * 3 + 2]);
+        v[i] = (voxelMatrix * vec4(p, 1.f)).xyz;
+    }
+    t.v0 = v[0];
+    t.v1 = v[1];
+    t.v2 = v[2];
+    t.normal = cross(t.v1 - t.v0, t.v2 - t.v1);
+    if(t.normal == vec3(0.f))
+        return false;
+
+    ivec3 maxVoxel = ivec3(res) - 1;
+    t.lo = clamp(ivec3(floor(min(t.v0, min(t.v1, t.v2)))), ivec3(0), maxVoxel);
+    t.hi = clamp(ivec3(floor(max(t.v0, max(t.v1, t.v2)))), ivec3(0), maxVoxel);
+
+    vec3 n = abs(t.normal);
+    t.d = n.x > n.y && n.x > n.z ? 0 : n.y > n.z ? 1 : 2;
+    t.a = (t.d + 1) % 3;
+    t.b = (t.d + 2) % 3;
+    return true;
+}
+
+//separating axis test of the triangle and a voxel (Akenine-Moeller), same order of tests as on the CPU
+bool triangleBoxOverlap(Triangle t, vec3 center)
+{
+    const vec3 halfSize = vec3(0.5f);
+    vec3 v[3] = { t.v0 - center, t.v1 - center, t.v2 - center };
+
+    //box normals
+    vec3 minV = min(v[0], min(v[1], v[2]));
+    vec3 maxV = max(v[0], max(v[1], v[2]));
+    if(any(greaterThan(minV, halfSize)) || any(lessThan(maxV, -halfSize)))
+        return false;
+
+    //cross products of the edges with the box normals
+    vec3 edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+    for(int e = 0; e < 3; ++e)
+    {
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            vec3 unit = vec3(0.f);
+            unit[axis] = 1.f;
+            vec3 separatingAxis = cross(unit, edges[e]);
+            float p0 = dot(separatingAxis, v[0]);
+            float p1 = dot(separatingAxis, v[1]);
+            float p2 = dot(separatingAxis, v[2]);
+            float r = dot(halfSize, abs(separatingAxis));
+            if(min(p0, min(p1, p2)) > r || max(p0, max(p1, p2)) < -r)
+                return false;
+        }
+    }
+
+    //triangle plane
+    vec3 normal = cross(edges[0], edges[1]);
+    return abs(dot(normal, v[0])) <= dot(halfSize, abs(normal));
+}
+
+void appendVoxel(ivec3 voxel)
+{
+    uint index = atomicCounterIncrement(voxelCounter);
+    //the counter keeps counting if the list is full, so the list can be resized and the voxelization repeated
+    if(index < voxelFragmentList.length())
+    {
+        voxelFragmentList[index] = vec4(voxel / vec3(res), 1.f);
+        voxelFragmentColor[index] = vec4(albedo, 1.f);
+    }
+}
+
+//tests the voxels of one column along the dominant axis around the plane of the triangle
+void voxelizeColumn(Triangle t, int ia, int ib)
+{
+    float planeDistance = dot(t.normal, t.v0);
+    float minD = 1e30f;
+    float maxD = -1e30f;
+    for(int corner = 0; corner < 4; ++corner)
+    {
+        float xa = float(ia + (corner & 1));
+        float xb = float(ib + (corner >> 1));
+        float xd = (planeDistance - t.normal[t.a] * xa - t.normal[t.b] * xb) / t.normal[t.d];
+        minD = min(minD, xd);
+        maxD = max(maxD, xd);
+    }
+    //one voxel of slack on both sides for voxels that only touch the plane, the overlap test decides
+    int first = max(t.lo[t.d], int(floor(minD)) - 1);
+    int last = min(t.hi[t.d], int(floor(maxD)) + 1);
+    for(int id = first; id <= last; ++id)
+    {
+        ivec3 voxel;
+        voxel[t.a] = ia;
+        voxel[t.b] = ib;
+        voxel[t.d] = id;
+        if(triangleBoxOverlap(t, vec3(voxel) + 0.5f))
+            appendVoxel(voxel);
+    }
+}
+
+ivec2 columnCount(Triangle t)
+{
+    return ivec2(t.hi[t.a] - t.lo[t.a] + 1, t.hi[t.b] - t.lo[t.b] + 1);
+}
+
+ivec2 tileCount(Triangle t)
+{
+    return (columnCount(t) + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+//voxelizes the columns of one tile, the invocation covers the column at offset of the tile
+void voxelizeTileColumn(Triangle t, uint tile, ivec2 offset)
+{
+    ivec2 tiles = tileCount(t);
+    ivec2 column = ivec2(int(tile) % tiles.x, int(tile) / tiles.x) * TILE_SIZE + offset;
+    if(all(lessThan(column, columnCount(t))))
+        voxelizeColumn(t, t.lo[t.a] + column.x, t.lo[t.b] + column.y);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "light.glsl"
+
+// ambient light of SparseVoxelOctreeConeTracer with one texel per pixel, rgb is the cone traced ambient light and a the ambient occlusion.
+// Without it the constant ambient light of light.glsl is used
+uniform bool useAmbientTexture = false;
+layout(bindless_sampler) uniform sampler2D ambientTexture;
+
+vec3 getAmbient()
+{
+    if (useAmbientTexture)
+        return texelFetch(ambientTexture, ivec2(gl_FragCoord.xy), 0).rgb;
+    return ambient;
+}
@@ -21,6 +21,7 @@ layout(std430, binding = LIGHTS_BINDING) readonly buffer LightBuffer
     Light lights[];
 };
 
+// constant ambient light, fragment shaders get the cone traced ambient light instead with getAmbient of ambient.glsl
 uniform vec3 ambient = vec3(0.3f);
 
 struct LightResult
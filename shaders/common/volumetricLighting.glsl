@@ -6,12 +6,24 @@ layout(bindless_sampler) uniform sampler3D voxelGrid;
 uniform float maxRange;
 uniform vec2 screenRes;
 
+// set if voxelGrid only holds the light (r11f_g11f_b10f), the transmittance is in the r channel of transmittanceGrid then
+uniform bool separateTransmittance = false;
+layout(bindless_sampler) uniform sampler3D transmittanceGrid;
+
+vec4 sampleVoxelGrid(in vec3 texCoord)
+{
+    vec4 texEntry = texture(voxelGrid, texCoord);
+    if (separateTransmittance)
+        texEntry.w = texture(transmittanceGrid, texCoord).r;
+    return texEntry;
+}
+
 vec3 applyVolumetricLightingManual(in vec3 colorWithoutVolumetric, in float viewZ)
 {
     float zDist = -viewZ / maxRange;
     zDist /= exp(-1.f+zDist); //use exponential depth
     vec3 texCoord = vec3(gl_FragCoord.xy / screenRes, zDist);
-    vec4 texEntry = texture(voxelGrid, texCoord);
+    vec4 texEntry = sampleVoxelGrid(texCoord);
     return colorWithoutVolumetric * texEntry.w + texEntry.xyz;
 }
 
@@ -21,5 +33,5 @@ vec4 getVolumetricLighting(in float viewZ)
     float zDist = -viewZ / maxRange;
     zDist /= exp(-1.f + zDist); //use exponential depth
     vec3 texCoord = vec3(gl_FragCoord.xy / screenRes, zDist);
-    return texture(voxelGrid, texCoord);
+    return sampleVoxelGrid(texCoord);
 }
@@ -3,7 +3,14 @@ layout (location = VERTEX_LAYOUT) in vec3 vertexPosition;
 layout (location = TEXCOORD_LAYOUT) in vec3 vertexTexCoord;
 
 uniform mat4 lightSpaceMatrix;
+
+#ifndef MULTIDRAW
+#define MULTIDRAW 1
+#endif
+
+#if !MULTIDRAW
 uniform mat4 ModelMatrix = mat4(1.0f);
+#endif
 
 flat out uint passDrawID;
 out vec3 passTexCoord;
@@ -13,23 +20,13 @@ layout(std430, binding = MODELMATRICES_BINDING) buffer ModelMatrixBuffer
     mat4 modelMatrices[];
 };
 
-subroutine mat4 getModelMatrix();
-
-layout(index = 0) subroutine(getModelMatrix) mat4 bufferModelMatrix()
-{
-    return modelMatrices[gl_DrawID];
-}
-
-layout(index = 1) subroutine(getModelMatrix) mat4 uniformModelMatrix()
-{
-    return ModelMatrix;
-}
-
-layout(location = 0) subroutine uniform getModelMatrix drawMode;
-
 void main()
 {
-    mat4 modelMatrix = drawMode();
+#if MULTIDRAW
+    mat4 modelMatrix = modelMatrices[gl_DrawID];
+#else
+    mat4 modelMatrix = ModelMatrix;
+#endif
     gl_Position = lightSpaceMatrix * modelMatrix * vec4(vertexPosition, 1.0);
 	passDrawID = gl_DrawID;
 	passTexCoord = vertexTexCoord;
@@ -20,6 +20,7 @@ in vec3 passViewPos;
 #include "common/material.glsl"
 #include "common/shadowMapping.glsl"
 #include "common/volumetricLighting.glsl"
+#include "common/ambient.glsl"
 
 out vec4 fragColor;
 
@@ -33,7 +34,7 @@ void main()
     vec3 normal = normalize(passNormal);
     vec3 viewDir = normalize(camPos - passWorldPos);
 
-    vec3 lightingColor = ambient;
+    vec3 lightingColor = getAmbient();
 
     for (int i = 0; i < lights.length(); i++)
     {
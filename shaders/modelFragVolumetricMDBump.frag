@@ -3,6 +3,14 @@
 //#extension GL_ARB_gpu_shader_int64 : require
 layout(early_fragment_tests) in;
 
+// material permutations, -1 reads the value from the material at runtime
+#ifndef BUMP_TYPE
+#define BUMP_TYPE -1 // 0 = none, 1 = normal map, 2 = height map
+#endif
+#ifndef OPACITY_MODE
+#define OPACITY_MODE -1 // 0 = constant opacity, 1 = opacity texture, 2 = alpha of diffuse texture
+#endif
+
 layout(binding = CAMERA_BINDING, std430) buffer cameraBuffer
 {
     mat4 viewMatrix;
@@ -22,6 +30,7 @@ layout(location = 6) in vec3 bitangent;
 #include "common/material.glsl"
 #include "common/shadowMapping.glsl"
 #include "common/volumetricLighting.glsl"
+#include "common/ambient.glsl"
 
 layout(bindless_sampler) uniform samplerCube skybox;
 
@@ -37,15 +46,21 @@ void main()
 
     vec3 viewDir = normalize(camPos - passWorldPos);
 
+#if BUMP_TYPE < 0
+    const int bumpType = currentMaterial.bumpType;
+#else
+    const int bumpType = BUMP_TYPE;
+#endif
+
 	vec3 normal;
-	if(currentMaterial.bumpType == 1)
+	if(bumpType == 1)
 	{
 		mat3 TBN = mat3(tangent, bitangent, passNormal);
 		normal = texture(currentMaterial.bumpTexture, passTexCoord.rg).rgb;
 		normal = normalize(normal * 2.0 - 1.0);   
 		normal = normalize(TBN * normal);
 	}
-	else if(currentMaterial.bumpType == 2)
+	else if(bumpType == 2)
 	{
 		vec2 size = vec2(0.5,0.0); //"strength" of bump-mapping
 		ivec3 off = ivec3(-1,0,1);
@@ -66,7 +81,7 @@ void main()
 		normal = normalize(passNormal);
 	}
 
-    vec3 lightingColor = ambient * diffCol;
+    vec3 lightingColor = getAmbient() * diffCol;
 	vec3 reflection = 2.0f * textureLod(skybox, reflect(-viewDir, normal), 5).rgb;
 
     for (int i = 0; i < lights.length(); i++)
@@ -80,9 +95,15 @@ void main()
     lightingColor = applyVolumetricLightingManual(lightingColor, passViewPos.z);
     vec4 col = vec4(lightingColor, 1.0);
 
-    if (currentMaterial.opacity == -1.0f) // has opacity texture instead of opacity
+#if OPACITY_MODE < 0
+    const int opacityMode = currentMaterial.opacity == -1.0f ? 1 : (currentMaterial.opacity == -2.0f ? 2 : 0);
+#else
+    const int opacityMode = OPACITY_MODE;
+#endif
+
+    if (opacityMode == 1) // has opacity texture instead of opacity
         col.a = texture(currentMaterial.opacityTexture, passTexCoord.rg).r;
-    else if (currentMaterial.opacity == -2.0f)
+    else if (opacityMode == 2)
         col.a = getDiffTextureAlpha(materialIndex);
     else
         col.a = currentMaterial.opacity;
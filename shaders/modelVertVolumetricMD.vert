@@ -22,10 +22,14 @@ layout (std430, binding = MODELMATRICES_BINDING) buffer ModelMatrixBuffer
     mat4 modelMatrices[];
 };
 
+// index of the first draw when the multi-draw is split into several material buckets
+uniform int drawIDOffset = 0;
+
 void main()
 {
-    mat4 modelMatrix = modelMatrices[gl_DrawID];
-    passDrawID = gl_DrawID;
+    const uint drawID = uint(gl_DrawID + drawIDOffset);
+    mat4 modelMatrix = modelMatrices[drawID];
+    passDrawID = drawID;
 
     vec4 worldPos = modelMatrix * vec4(vertexPosition, 1.0f);
     passFragPos = worldPos.xyz;
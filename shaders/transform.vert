@@ -1,9 +1,24 @@
-#version 430
+#version 460
 layout (location = 0) in vec3 vertexPosition;
 
+#ifndef MULTIDRAW
+#define MULTIDRAW 0
+#endif
+
+#if MULTIDRAW
+layout(std430, binding = MODELMATRICES_BINDING) buffer ModelMatrixBuffer
+{
+    mat4 modelMatrices[];
+};
+#else
 uniform mat4 ModelMatrix;
+#endif
 
 void main()
 {
+#if MULTIDRAW
+    gl_Position = modelMatrices[gl_DrawID] * vec4(vertexPosition, 1.0);
+#else
     gl_Position = ModelMatrix * vec4(vertexPosition, 1.0);
+#endif
 }  
\ No newline at end of file